@@ -1,4 +1,5 @@
 #include <SDL/SDL.h>
+#include "../common/pack.h"
 
 #define FAIL(msg)					\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -12,7 +13,7 @@ int main(int argc, char** argv)
   SDL_Init( SDL_INIT_EVERYTHING );
 
   screen = SDL_SetVideoMode( 640, 480, 32, SDL_SWSURFACE );
-  hello = SDL_LoadBMP("helloworld.bmp");
+  hello = SDL_LoadBMP_RW( asset_rw( "helloworld.bmp" ), 1 );
 
   if(hello == NULL) {
     FAIL("Result of LoadBMP is null!\n");
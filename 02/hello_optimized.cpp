@@ -1,6 +1,7 @@
 #include <SDL/SDL.h>
 #include <stdlib.h>
 #include <string>
+#include "../common/pack.h"
 
 #define FAIL(msg)					\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -17,7 +18,7 @@ SDL_Surface *load_image(std::string filename)
   SDL_Surface* loadedImage = NULL;
   SDL_Surface* optimizedImage = NULL;
 
-  loadedImage = SDL_LoadBMP( filename.c_str() );
+  loadedImage = SDL_LoadBMP_RW( asset_rw( filename ), 1 );
 
   if( loadedImage == NULL ) {
     FAIL("Error loading image.\n");
@@ -2,6 +2,7 @@
 #include <SDL/SDL_image.h>
 #include <stdlib.h>
 #include <string>
+#include "../common/pack.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -23,7 +24,7 @@ SDL_Surface *load_image(std::string filename)
   SDL_Surface* loadedImage = NULL;
   SDL_Surface* optimizedImage = NULL;
 
-  loadedImage = IMG_Load( filename.c_str() );
+  loadedImage = IMG_Load_RW( asset_rw( filename ), 1 );
 
   if( loadedImage == NULL ) {
     FAIL_IMG("Error loading image.\n");
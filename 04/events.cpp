@@ -2,7 +2,7 @@
 #include <SDL/SDL_image.h>
 #include <stdlib.h>
 #include <string>
-#include <cstdarg>
+#include "../common/assetcache.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -18,23 +18,6 @@ const int SCREEN_BPP = 32;
 
 //using namespace std;
 
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  SDL_FreeSurface( loadedImage );
-
-  return optimizedImage;
-}
-
 void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination)
 {
   SDL_Rect offset;
@@ -66,35 +49,20 @@ bool init(SDL_Surface** screen, std::string title)
   return true;
 }
 
-bool cleanup(int count, ...)
-{
-  va_list stuff_to_free;
-  va_start(stuff_to_free, count);
-
-  /*for(SDL_Surface* free_me : stuff_to_free) {
-    SDL_FreeSurface( free_me );
-  }*/
-  int j;
-  for(j = 0; j < count; ++j) {
-    SDL_Surface* to_free = va_arg(stuff_to_free, SDL_Surface*);
-    SDL_FreeSurface(to_free);
-  }
-
-  va_end(stuff_to_free);
-
-  SDL_Quit();
-}
-
 int main(int argc, char** argv)
 {  
   SDL_Surface* screen = NULL;
   SDL_Surface* image = NULL;
   SDL_Event event;
   bool quit = false;
+  AssetCache assets;
 
   init(&screen, "Event driven programming");
 
-  image = load_image( "image.png" );
+  image = assets.image( "image.png", false );
+  if( image == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
  
   apply_surface( 0, 0, image, screen);
 
@@ -112,7 +80,10 @@ int main(int argc, char** argv)
     }
   }
 
-  cleanup(1, screen);
+  // The screen belongs to SDL, SDL_Quit frees it
+  assets.report();
+  assets.clear();
+  SDL_Quit();
 
   return 0;
 }
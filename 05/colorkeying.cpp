@@ -2,7 +2,8 @@
 #include <SDL/SDL_image.h>
 #include <stdlib.h>
 #include <string>
-#include <cstdarg>
+#include "../common/assetcache.h"
+#include "sprites_atlas.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -18,39 +19,6 @@ const int SCREEN_BPP = 32;
 
 //using namespace std;
 
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  if( optimizedImage == NULL) {
-    FAIL_IMG("Error optimizing image\n");
-  }
-  SDL_FreeSurface( loadedImage );
-  
-  Uint32 colorkey = SDL_MapRGB( optimizedImage->format, 200, 191, 231 );
-  SDL_SetColorKey( optimizedImage , SDL_SRCCOLORKEY, colorkey );
-
-  return optimizedImage;
-}
-
-void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination)
-{
-  SDL_Rect offset;
-  offset.x = x;
-  offset.y = y;
-
-  SDL_BlitSurface( source, NULL, destination, &offset );
-  
-}
-
 bool init(SDL_Surface** screen, std::string title)
 {
   // Init SDL Stuff
@@ -72,40 +40,26 @@ bool init(SDL_Surface** screen, std::string title)
   return true;
 }
 
-bool cleanup(int count, ...)
-{
-  va_list stuff_to_free;
-  va_start(stuff_to_free, count);
-
-  /*for(SDL_Surface* free_me : stuff_to_free) {
-    SDL_FreeSurface( free_me );
-  }*/
-  int j;
-  for(j = 0; j < count; ++j) {
-    SDL_Surface* to_free = va_arg(stuff_to_free, SDL_Surface*);
-    SDL_FreeSurface(to_free);
-  }
-
-  va_end(stuff_to_free);
-
-  SDL_Quit();
-}
-
 int main(int argc, char** argv)
 {  
   SDL_Surface* screen = NULL;
-  SDL_Surface* background = NULL;
-  SDL_Surface* dude = NULL;
+  SDL_Surface* sprites = NULL;
   SDL_Event event;
   bool quit = false;
+  AssetCache assets;
 
   init(&screen, "Color keying");
 
-  background = load_image( "background.png" );
-  dude = load_image( "dude.png" );
+  // Background and dude packed into one image at build time, see
+  // sprites_atlas.h. Find the opaque runs once, blits then copy them
+  // with memcpy
+  sprites = assets.image( SPRITES_ATLAS, true, true );
+  if( sprites == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
  
-  apply_surface(   0,   0, background, screen);
-  apply_surface( 140, 200,       dude, screen);
+  apply_sprite(   0,   0, sprites, SPRITES_SPRITES[0], screen);
+  apply_sprite( 140, 200, sprites, SPRITES_SPRITES[1], screen);
 
   if(SDL_Flip( screen ) == -1)
     {
@@ -121,7 +75,10 @@ int main(int argc, char** argv)
     }
   }
 
-  cleanup(3, background, dude, screen);
+  // The screen belongs to SDL, SDL_Quit frees it
+  assets.report();
+  assets.clear();
+  SDL_Quit();
 
   return 0;
 }
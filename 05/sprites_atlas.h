@@ -0,0 +1,17 @@
+// Generated by tools/atlas from background.png, dude.png, do not edit.
+#ifndef SPRITES_ATLAS_H
+#define SPRITES_ATLAS_H
+
+#include "../common/atlas.h"
+
+constexpr const char* SPRITES_ATLAS = "sprites_atlas.bmp";
+
+constexpr int SPRITES_SPRITE_COUNT = 2;
+
+// x, y, w, h in the atlas; offset and size of the original cell
+constexpr AtlasSprite SPRITES_SPRITES[ SPRITES_SPRITE_COUNT ] = {
+  {    0,    0,  397,  303,    0,    0,  397,  303 },
+  {  397,    0,   32,   55,    1,    7,   37,   72 },
+};
+
+#endif
@@ -2,7 +2,8 @@
 #include <SDL/SDL_image.h>
 #include <stdlib.h>
 #include <string>
-#include <cstdarg>
+#include "../common/spansprite.h"
+#include "../common/assetcache.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -18,29 +19,6 @@ const int SCREEN_BPP = 32;
 
 //using namespace std;
 
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  if( optimizedImage == NULL) {
-    FAIL_IMG("Error optimizing image\n");
-  }
-  SDL_FreeSurface( loadedImage );
-  
-  Uint32 colorkey = SDL_MapRGB( optimizedImage->format, 200, 191, 231 );
-  SDL_SetColorKey( optimizedImage , SDL_SRCCOLORKEY, colorkey );
-
-  return optimizedImage;
-}
-
 void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination, SDL_Rect* clip = NULL)
 {
   SDL_Rect offset;
@@ -48,7 +26,7 @@ void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination,
   offset.x = x;
   offset.y = y;
 
-  SDL_BlitSurface( source, clip, destination, &offset );
+  span_blit( source, clip, destination, &offset );
 }
 
 bool init(SDL_Surface** screen, std::string title)
@@ -72,25 +50,6 @@ bool init(SDL_Surface** screen, std::string title)
   return true;
 }
 
-bool cleanup(int count, ...)
-{
-  va_list stuff_to_free;
-  va_start(stuff_to_free, count);
-
-  /*for(SDL_Surface* free_me : stuff_to_free) {
-    SDL_FreeSurface( free_me );
-  }*/
-  int j;
-  for(j = 0; j < count; ++j) {
-    SDL_Surface* to_free = va_arg(stuff_to_free, SDL_Surface*);
-    SDL_FreeSurface(to_free);
-  }
-
-  va_end(stuff_to_free);
-
-  SDL_Quit();
-}
-
 int main(int argc, char** argv)
 {  
   SDL_Surface* screen = NULL;
@@ -99,10 +58,15 @@ int main(int argc, char** argv)
   SDL_Rect clip[4];
 
   bool quit = false;
+  AssetCache assets;
 
   init(&screen, "Sprites");
 
-  dots = load_image( "dots.png" );
+  // Find the opaque runs once, blits then copy them with memcpy
+  dots = assets.image( "dots.png", true, true );
+  if( dots == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
 
   clip[0].x = 0;
   clip[0].y = 0;
@@ -146,7 +110,10 @@ int main(int argc, char** argv)
     }
   }
 
-  cleanup(2, dots, screen);
+  // The screen belongs to SDL, SDL_Quit frees it
+  assets.report();
+  assets.clear();
+  SDL_Quit();
 
   return 0;
 }
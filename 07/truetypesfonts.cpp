@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string>
 #include <cstdarg>
+#include "../common/assetloader.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -24,38 +25,6 @@ const int SCREEN_BPP = 32;
 
 //using namespace std;
 
-TTF_Font *load_font(std::string fontname, int size)
-{
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
-  if(font == NULL) {
-    FAIL_TTF("Error loading font.\n");
-  }
-  return font;
-}
-
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  if( optimizedImage == NULL) {
-    FAIL_IMG("Error optimizing image\n");
-  }
-  SDL_FreeSurface( loadedImage );
-  
-  Uint32 colorkey = SDL_MapRGB( optimizedImage->format, 200, 191, 231 );
-  SDL_SetColorKey( optimizedImage , SDL_SRCCOLORKEY, colorkey );
-
-  return optimizedImage;
-}
-
 void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination, SDL_Rect* clip = NULL)
 {
   SDL_Rect offset;
@@ -126,8 +95,17 @@ int main(int argc, char** argv)
 
   init(&screen, "True Types Fonts");
 
-  background = load_image( "background.png" );
-  font = load_font("DejaVuSans.ttf", 27);
+  // Decoded side by side on a pool for the load
+  AssetLoader loader;
+  ImageHandle backgroundImage = loader.image( "background.png" );
+  FontHandle fontHandle = loader.font( "DejaVuSans.ttf", 27 );
+
+  if( !loader.load() ) {
+    fprintf( stderr, "Error loading %s.\n", loader.get_failed().c_str() );
+    exit( -1 );
+  }
+  background = loader.get( backgroundImage );
+  font = loader.get( fontHandle );
 
   message = TTF_RenderText_Solid(font, "The quick brown foz jumps over the lazy dog.", textColor);
   if(message == NULL) {
@@ -151,7 +129,7 @@ int main(int argc, char** argv)
     }
   }
 
-  SDL_FreeSurface( background );
+  free_blob( background );
   SDL_FreeSurface( message );
 
   TTF_CloseFont( font );
@@ -4,6 +4,8 @@
 #include <stdlib.h>
 #include <string>
 #include <cstdarg>
+#include "../common/pack.h"
+#include "../common/assetcache.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -26,36 +28,13 @@ const int SCREEN_BPP = 32;
 
 TTF_Font *load_font(std::string fontname, int size)
 {
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
+  TTF_Font* font = TTF_OpenFontRW( asset_rw( fontname ), 1, size );
   if(font == NULL) {
     FAIL_TTF("Error loading font.\n");
   }
   return font;
 }
 
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  if( optimizedImage == NULL) {
-    FAIL_IMG("Error optimizing image\n");
-  }
-  SDL_FreeSurface( loadedImage );
-  
-  Uint32 colorkey = SDL_MapRGB( optimizedImage->format, 200, 191, 231 );
-  SDL_SetColorKey( optimizedImage , SDL_SRCCOLORKEY, colorkey );
-
-  return optimizedImage;
-}
-
 void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination, SDL_Rect* clip = NULL)
 {
   SDL_Rect offset;
@@ -189,10 +168,16 @@ int main(int argc, char** argv)
   SDL_Rect clips[4];
 
   bool quit = false;
+  AssetCache assets;
 
   init( &screen, "Mouse events" );
 
-  stuff = load_image( "button.png" );
+  // The Makefile bakes the image already in display format, colorkey
+  // set; mapping it skips decoding and converting
+  stuff = assets.image( "button.png" );
+  if( stuff == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
 
   clips[ Button::CLIP_MOUSEOVER ].x = 0;
   clips[ Button::CLIP_MOUSEOVER ].y = 0;
@@ -252,7 +237,10 @@ int main(int argc, char** argv)
 
     }
   }
-    
+
+  // The screen belongs to SDL, SDL_Quit frees it
+  assets.report();
+  assets.clear();
   SDL_Quit();
 
   return 0;
@@ -4,6 +4,7 @@
 #include <stdlib.h>
 #include <string>
 #include <iostream>
+#include "../common/pack.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -26,7 +27,7 @@ const int SCREEN_BPP = 32;
 
 TTF_Font *load_font(std::string fontname, int size)
 {
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
+  TTF_Font* font = TTF_OpenFontRW( asset_rw( fontname ), 1, size );
   if(font == NULL) {
     FAIL_TTF("Error loading font.\n");
   }
@@ -38,7 +39,7 @@ SDL_Surface *load_image(std::string filename)
   SDL_Surface* loadedImage = NULL;
   SDL_Surface* optimizedImage = NULL;
 
-  loadedImage = IMG_Load( filename.c_str() );
+  loadedImage = IMG_Load_RW( asset_rw( filename ), 1 );
 
   if( loadedImage == NULL ) {
     FAIL_IMG("Error loading image.\n");
@@ -5,6 +5,7 @@
 #include <stdlib.h>
 #include <string>
 #include <iostream>
+#include "../common/assetloader.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -29,38 +30,6 @@ const int SCREEN_BPP = 32;
 
 //using namespace std;
 
-TTF_Font *load_font(std::string fontname, int size)
-{
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
-  if(font == NULL) {
-    FAIL_TTF("Error loading font.\n");
-  }
-  return font;
-}
-
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  if( optimizedImage == NULL) {
-    FAIL_IMG("Error optimizing image\n");
-  }
-  SDL_FreeSurface( loadedImage );
-  
-  Uint32 colorkey = SDL_MapRGB( optimizedImage->format, 200, 191, 231 );
-  SDL_SetColorKey( optimizedImage , SDL_SRCCOLORKEY, colorkey );
-
-  return optimizedImage;
-}
-
 void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination, SDL_Rect* clip = NULL)
 {
   SDL_Rect offset;
@@ -117,32 +86,25 @@ int main(int argc, char** argv)
 
   init(&screen, "Sounds");
 
-  background = load_image( "background.png" );
- 
-  music = Mix_LoadMUS( "music.wav" );
-  if(music == NULL) {
-    FAIL_MIX("Error loading music.\n");
-  }
-
-  scratch = Mix_LoadWAV( "scratch.wav" );
-  if(scratch == NULL) {
-    FAIL_MIX("Error loading scratch.\n");
-  }
-
-  high = Mix_LoadWAV( "high.wav" );
-  if(high == NULL) {
-    FAIL_MIX("Error loading high.\n");
-  }
-
-  med = Mix_LoadWAV( "med.wav" );
-  if(med == NULL) {
-    FAIL_MIX("Error loading med.\n");
-  }
-
-  low = Mix_LoadWAV( "low.wav" );
-  if(low == NULL) {
-    FAIL_MIX("Error loading low.\n");
+  // Decoded side by side on a pool for the load
+  AssetLoader loader;
+  ImageHandle backgroundImage = loader.image( "background.png" );
+  MusicHandle musicHandle = loader.music( "music.wav" );
+  SoundHandle scratchSound = loader.sound( "scratch.wav" );
+  SoundHandle highSound = loader.sound( "high.wav" );
+  SoundHandle medSound = loader.sound( "med.wav" );
+  SoundHandle lowSound = loader.sound( "low.wav" );
+
+  if( !loader.load() ) {
+    fprintf( stderr, "Error loading %s.\n", loader.get_failed().c_str() );
+    exit( -1 );
   }
+  background = loader.get( backgroundImage );
+  music = loader.get( musicHandle );
+  scratch = loader.get( scratchSound );
+  high = loader.get( highSound );
+  med = loader.get( medSound );
+  low = loader.get( lowSound );
 
   apply_surface( 0, 0, background, screen );
 
@@ -203,7 +165,7 @@ int main(int argc, char** argv)
     } // while (poll event)
   } // while (not quit)
 
-  SDL_FreeSurface( background );
+  free_blob( background );
 
   Mix_FreeChunk( scratch );
   Mix_FreeChunk( high );
@@ -5,6 +5,9 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include "../common/dirtyrects.h"
+#include "../common/headless.h"
+#include "../common/pack.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -28,7 +31,7 @@ const int SCREEN_BPP = 32;
 
 TTF_Font *load_font(std::string fontname, int size)
 {
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
+  TTF_Font* font = TTF_OpenFontRW( asset_rw( fontname ), 1, size );
   if(font == NULL) {
     FAIL_TTF("Error loading font.\n");
   }
@@ -40,7 +43,7 @@ SDL_Surface *load_image(std::string filename)
   SDL_Surface* loadedImage = NULL;
   SDL_Surface* optimizedImage = NULL;
 
-  loadedImage = IMG_Load( filename.c_str() );
+  loadedImage = IMG_Load_RW( asset_rw( filename ), 1 );
 
   if( loadedImage == NULL ) {
     FAIL_IMG("Error loading image.\n");
@@ -70,6 +73,9 @@ void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination,
 
 bool init(SDL_Surface** screen, std::string title)
 {
+  // Memory surface instead of a window with -headless
+  headless().setup();
+
   // Init SDL Stuff
   if(SDL_Init( SDL_INIT_EVERYTHING ) == -1)
     {
@@ -177,6 +183,7 @@ int main(int argc, char** argv)
   // The frame rate regulator
   Timer fps;
 
+  headless().parse( argc, argv );
   init(&screen, "Regulating Frame Rate");
 
   font = load_font("DejaVuSans.ttf", 27);
@@ -189,6 +196,10 @@ int main(int argc, char** argv)
     FAIL_SDL("Error fliping screen.\n");
   }
 
+  DirtyRects renderer( screen );
+
+  headless().start();
+
   // wait for user exit
   while(quit == false) {
     // Start the frame timer
@@ -205,28 +216,40 @@ int main(int argc, char** argv)
 
       }
     } // while(poll event)
+    headless().mark( HEADLESS_INPUT );
     
-    SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
+    headless().mark( HEADLESS_UPDATE );
+
+    renderer.begin_frame();
 
-    apply_surface( (SCREEN_WIDTH - message->w) / 2 , 
+    renderer.blit( (SCREEN_WIDTH - message->w) / 2 , 
 		   ((SCREEN_HEIGHT - message->h * 2) / FRAMES_PER_SECOND) * 
 		   (frame % FRAMES_PER_SECOND) - message->h, 
-		   message, screen);
+		   message );
 
-    // update screen
-    if(SDL_Flip( screen ) == -1) {
-      FAIL_SDL("Error fliping screen.\n");        
+    headless().mark( HEADLESS_DRAW );
+
+    // Send only what changed to the display
+    renderer.present();
+    headless().mark( HEADLESS_PRESENT );
+
+    if( headless().end_frame( screen ) ) {
+      quit = true;
     }
 
     frame++;
 
-    if( cap && fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
+    if( cap && !headless().is_enabled() && fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
       SDL_Delay( 1000 / FRAMES_PER_SECOND - fps.get_ticks() );
     }
 
   } // while(not quit)
 
+  headless().report();
+  renderer.report();
+
   //  SDL_FreeSurface( <the_surface> );
+  SDL_FreeSurface( message );
 
   TTF_CloseFont( font );
   
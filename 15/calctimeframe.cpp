@@ -5,6 +5,9 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include "../common/dirtyrects.h"
+#include "../common/headless.h"
+#include "../common/pack.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -28,7 +31,7 @@ const int SCREEN_BPP = 32;
 
 TTF_Font *load_font(std::string fontname, int size)
 {
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
+  TTF_Font* font = TTF_OpenFontRW( asset_rw( fontname ), 1, size );
   if(font == NULL) {
     FAIL_TTF("Error loading font.\n");
   }
@@ -40,7 +43,7 @@ SDL_Surface *load_image(std::string filename)
   SDL_Surface* loadedImage = NULL;
   SDL_Surface* optimizedImage = NULL;
 
-  loadedImage = IMG_Load( filename.c_str() );
+  loadedImage = IMG_Load_RW( asset_rw( filename ), 1 );
 
   if( loadedImage == NULL ) {
     FAIL_IMG("Error loading image.\n");
@@ -70,6 +73,9 @@ void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination,
 
 bool init(SDL_Surface** screen, std::string title)
 {
+  // Memory surface instead of a window with -headless
+  headless().setup();
+
   // Init SDL Stuff
   if(SDL_Init( SDL_INIT_EVERYTHING ) == -1)
     {
@@ -177,6 +183,7 @@ int main(int argc, char** argv)
   // Timer used to update caption
   Timer update;
 
+  headless().parse( argc, argv );
   init(&screen, "Calculate Frame Rate");
 
   font = load_font("DejaVuSans.ttf", 27);
@@ -189,9 +196,13 @@ int main(int argc, char** argv)
     FAIL_SDL("Error fliping screen.\n");
   }
 
+  DirtyRects renderer( screen );
+
   update.start();
   fps.start();
 
+  headless().start();
+
   // wait for user exit
   while(quit == false) {
 
@@ -200,14 +211,22 @@ int main(int argc, char** argv)
 	quit = true;
       }
     } // while(poll event)
+    headless().mark( HEADLESS_INPUT );
     
-    SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
+    headless().mark( HEADLESS_UPDATE );
+
+    renderer.begin_frame();
     
-    apply_surface( (SCREEN_WIDTH / 2) - (message->w / 2), (SCREEN_HEIGHT / 2) - (message->h / 2), message, screen );
+    renderer.blit( (SCREEN_WIDTH / 2) - (message->w / 2), (SCREEN_HEIGHT / 2) - (message->h / 2), message );
 
-    // update screen
-    if(SDL_Flip( screen ) == -1) {
-      FAIL_SDL("Error fliping screen.\n");        
+    headless().mark( HEADLESS_DRAW );
+
+    // Send only what changed to the display
+    renderer.present();
+    headless().mark( HEADLESS_PRESENT );
+
+    if( headless().end_frame( screen ) ) {
+      quit = true;
     }
 
     frame++;
@@ -215,7 +234,9 @@ int main(int argc, char** argv)
     if( update.get_ticks() > 1000 ) {
       std::stringstream caption;
       
-      caption << "Average Frames Per Second " << frame / ( fps.get_ticks() / 1000.f );
+      caption << "Average Frames Per Second " << frame / ( fps.get_ticks() / 1000.f )
+	      << ", KB presented per frame " << renderer.get_mean_bytes_presented() / 1024.f
+	      << " (full flip " << renderer.get_bytes_full() / 1024.f << ")";
       
       SDL_WM_SetCaption( caption.str().c_str(), NULL );
       
@@ -225,7 +246,11 @@ int main(int argc, char** argv)
 
   } // while(not quit)
 
+  headless().report();
+  renderer.report();
+
   //  SDL_FreeSurface( <the_surface> );
+  SDL_FreeSurface( message );
 
   TTF_CloseFont( font );
   
@@ -5,6 +5,12 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include "../common/clock.h"
+#include "../common/dirtyrects.h"
+#include "../common/presenter.h"
+#include "../common/headless.h"
+#include "../common/assetloader.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -26,38 +32,6 @@ const int SCREEN_BPP = 32;
 
 //using namespace std;
 
-TTF_Font *load_font(std::string fontname, int size)
-{
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
-  if(font == NULL) {
-    FAIL_TTF("Error loading font.\n");
-  }
-  return font;
-}
-
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  if( optimizedImage == NULL) {
-    FAIL_IMG("Error optimizing image\n");
-  }
-  SDL_FreeSurface( loadedImage );
-  
-  Uint32 colorkey = SDL_MapRGB( optimizedImage->format, 200, 191, 231 );
-  SDL_SetColorKey( optimizedImage , SDL_SRCCOLORKEY, colorkey );
-
-  return optimizedImage;
-}
-
 void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination, SDL_Rect* clip = NULL)
 {
   SDL_Rect offset;
@@ -70,6 +44,9 @@ void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination,
 
 bool init(SDL_Surface** screen, std::string title)
 {
+  // Memory surface instead of a window with -headless
+  headless().setup();
+
   // Init SDL Stuff
   if(SDL_Init( SDL_INIT_EVERYTHING ) == -1)
     {
@@ -145,8 +122,18 @@ public:
     }
   }
 
-  void show(SDL_Surface* dot, SDL_Surface* screen) {
-    apply_surface(x, y, dot, screen);
+  void show(SDL_Surface* dot, DirtyRects& renderer) {
+    renderer.blit(x, y, dot);
+  }
+
+  void show(SDL_Surface* dot, SDL_Surface* frame, std::vector<SDL_Rect>& drawn) {
+    SDL_Rect offset;
+
+    offset.x = x;
+    offset.y = y;
+
+    span_blit( dot, NULL, frame, &offset );
+    drawn.push_back( offset );
   }
 
   static const int DOT_HEIGHT = 36;
@@ -227,6 +214,15 @@ int main(int argc, char** argv)
 
   bool quit = false;
 
+  // -buffers N: draw frames into N back buffers on a thread of their
+  // own, 0 to draw them on the screen
+  int buffers = 0;
+  for( int a = 1; a + 1 < argc; ++a ) {
+    if( std::string( argv[ a ] ) == "-buffers" ) {
+      buffers = atoi( argv[ a + 1 ] );
+    }
+  }
+
   // Current frame
   //  int frame = 0;
 
@@ -236,11 +232,24 @@ int main(int argc, char** argv)
   // Timer used to update caption
   //Timer update;
 
+  headless().parse( argc, argv );
   init( &screen, "Move the dot (up, left, down, right)" );
 
-  font = load_font( "DejaVuSans.ttf", 27 );
+  // Decoded side by side on a pool for the load
+  AssetLoader loader;
+  FontHandle fontHandle = loader.font( "DejaVuSans.ttf", 27 );
+  ImageHandle dotImage = loader.image( "dot.png" );
+
+  if( !loader.load() ) {
+    fprintf( stderr, "Error loading %s.\n", loader.get_failed().c_str() );
+    exit( -1 );
+  }
+  font = loader.get( fontHandle );
   //message = TTF_RenderText_Solid( font, "Bla Bla", textColor );
-  dot = load_image( "dot.png" );
+  dot = loader.get( dotImage );
+
+  // Find the opaque runs once, blits then copy them with memcpy
+  span_encode( dot );
 
   SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
 
@@ -249,9 +258,23 @@ int main(int argc, char** argv)
     FAIL_SDL("Error fliping screen.\n");
   }
 
+  DirtyRects renderer( screen );
+
   //  update.start();
   Dot theDot;
 
+  // The dot as it was for each frame in the presenter's buffers, the draw
+  // thread draws from these while theDot moves on
+  std::vector<Dot> drawnDots( PRESENTER_MAX_DEPTH );
+  Presenter* presenter = NULL;
+  if( buffers > 0 ) {
+    presenter = new Presenter( screen, buffers, [&]( SDL_Surface* frame, int index, std::vector<SDL_Rect>& drawn ) {
+	drawnDots[ index ].show( dot, frame, drawn );
+      } );
+  }
+
+
+  headless().start();
 
   // wait for user exit
   while(quit == false) {
@@ -264,23 +287,42 @@ int main(int argc, char** argv)
 
       theDot.handle_input( event );
     } // while(poll event)
-    
+    headless().mark( HEADLESS_INPUT );
+    double input = now_ms();
 
     theDot.move();
 
-    SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
+    headless().mark( HEADLESS_UPDATE );
+
+    if( presenter ) {
+      // The frame is drawn on the draw thread while the next one is made,
+      // and what changed is shown here once it is done
+      int index = presenter->begin_frame();
+      drawnDots[ index ] = theDot;
+      presenter->submit( index, input );
+      headless().mark( HEADLESS_DRAW );
+
+      presenter->present();
+      headless().mark( HEADLESS_PRESENT );
+    } else {
+      renderer.begin_frame();
     
-    //apply_surface( (SCREEN_WIDTH / 2) - (message->w / 2), (SCREEN_HEIGHT / 2) - (message->h / 2), message, screen );
-    theDot.show( dot, screen );
+      //apply_surface( (SCREEN_WIDTH / 2) - (message->w / 2), (SCREEN_HEIGHT / 2) - (message->h / 2), message, screen );
+      theDot.show( dot, renderer );
+      headless().mark( HEADLESS_DRAW );
     
-    // update screen
-    if(SDL_Flip( screen ) == -1) {
-      FAIL_SDL("Error fliping screen.\n");        
+      // Send only what changed to the display
+      renderer.present();
+      headless().mark( HEADLESS_PRESENT );
+    }
+
+    if( headless().end_frame( screen ) ) {
+      quit = true;
     }
 
     //    frame++;
 
-    if( fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
+    if( !headless().is_enabled() && fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
       SDL_Delay( (1000 / FRAMES_PER_SECOND) - fps.get_ticks() );
     }
 
@@ -297,7 +339,21 @@ int main(int argc, char** argv)
 
   } // while(not quit)
 
+  headless().report();
+  renderer.report();
+
+  if( presenter ) {
+    presenter->finish();
+    printf( "%d buffers: %d frames, %.1f fps, input to present %.2f ms (max %.2f ms)\n",
+	    presenter->get_depth(), presenter->get_frames(), presenter->get_fps(),
+	    presenter->get_mean_latency_ms(), presenter->get_max_latency_ms() );
+    presenter->get_renderer().report();
+    delete presenter;
+  }
+
   //  SDL_FreeSurface( <the_surface> );
+  span_release( dot );
+  free_blob( dot );
 
   TTF_CloseFont( font );
   
@@ -5,6 +5,14 @@
 #include <string>
 #include <iostream>
 #include <sstream>
+#include <vector>
+#include "../common/collision.h"
+#include "../common/swept.h"
+#include "../common/aabbtree.h"
+#include "../common/dirtyrects.h"
+#include "../common/presenter.h"
+#include "../common/headless.h"
+#include "../common/pack.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -28,7 +36,7 @@ const int SCREEN_BPP = 32;
 
 TTF_Font *load_font(std::string fontname, int size)
 {
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
+  TTF_Font* font = TTF_OpenFontRW( asset_rw( fontname ), 1, size );
   if(font == NULL) {
     FAIL_TTF("Error loading font.\n");
   }
@@ -40,7 +48,7 @@ SDL_Surface *load_image(std::string filename)
   SDL_Surface* loadedImage = NULL;
   SDL_Surface* optimizedImage = NULL;
 
-  loadedImage = IMG_Load( filename.c_str() );
+  loadedImage = IMG_Load_RW( asset_rw( filename ), 1 );
 
   if( loadedImage == NULL ) {
     FAIL_IMG("Error loading image.\n");
@@ -70,6 +78,9 @@ void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination,
 
 bool init(SDL_Surface** screen, std::string title)
 {
+  // Memory surface instead of a window with -headless
+  headless().setup();
+
   // Init SDL Stuff
   if(SDL_Init( SDL_INIT_EVERYTHING ) == -1)
     {
@@ -94,58 +105,20 @@ bool init(SDL_Surface** screen, std::string title)
   return true;
 }
 
-bool check_collision( SDL_Rect a, SDL_Rect b ) {
-  // The sides of the rectangles
-  int left_a, left_b;
-  int top_a, top_b;
-  int right_a, right_b;
-  int bottom_a, bottom_b;
-
-  // Calc sides a
-  left_a = a.x;
-  right_a = a.x + a.w;
-  top_a = a.y; 
-  bottom_a = a.y + a.h;
-
-  // Calc sides b
-  left_b = b.x;
-  right_b = b.x + b.w;
-  top_b = b.y; 
-  bottom_b = b.y + b.h;
-
-  if( bottom_a <= top_b ) {
-    return false;
-  }
-
-  if( top_a >= bottom_b ) {
-    return false;
-  }
-
-  if( right_a <= left_b ) {
-    return false;
-  }
-
-  if( left_a >= right_b ) {
-    return false;
-  }
-  
-  return true;
-}
-
 class Square {
 private:
   SDL_Rect box;
-  SDL_Rect* wall;
+  AABBTree* walls;
   int xVel, yVel;
   
 public:
-  Square(SDL_Rect* theWall) {
+  Square(AABBTree* theWalls) {
     box.x = box.y = 0;
     
     box.w = Square::SQUARE_WIDTH;
     box.h = Square::SQUARE_HEIGHT;
     
-    wall = theWall;
+    walls = theWalls;
 
     yVel = xVel = 0;    
   }
@@ -179,23 +152,40 @@ public:
     }   
   }
 
+  // Sweeps the whole step, so the square stops right at the wall however
+  // fast it goes, and slides along it instead of stopping dead
   void move() {
-    box.x += xVel;
-
-    if( box.x < 0 || box.x + Square::SQUARE_WIDTH > SCREEN_WIDTH || check_collision( box , *wall ) ) {
-      box.x -= xVel;
+    std::vector<SDL_Rect> boxes( 1, box ), near;
+    std::vector<int> proxies;
+    SDL_Rect reach;
+    int dx, dy;
+
+    // Only the walls the square could reach this step
+    reach.x = box.x + ( xVel < 0 ? xVel : 0 );
+    reach.y = box.y + ( yVel < 0 ? yVel : 0 );
+    reach.w = box.w + abs( xVel );
+    reach.h = box.h + abs( yVel );
+
+    walls->query( reach, proxies );
+    for( int p = 0; p < proxies.size(); ++p ) {
+      near.push_back( walls->get_rect( proxies[ p ] ) );
     }
+    add_border_walls( near, SCREEN_WIDTH, SCREEN_HEIGHT );
 
-    box.y += yVel;
+    move_and_slide( boxes, xVel, yVel, near, dx, dy );
 
-    if( box.y < 0 || box.y + Square::SQUARE_HEIGHT > SCREEN_HEIGHT || check_collision( box , *wall ) ) {
-      box.y -= yVel;
-    }
+    box = boxes[ 0 ];
+  }
 
+  void show(SDL_Surface* screen, DirtyRects& renderer) {
+    renderer.fill( box, SDL_MapRGB(screen->format, 0xFF, 0xFF, 0xFF));
   }
 
-  void show(SDL_Surface* screen) {
-    SDL_FillRect( screen, &box, SDL_MapRGB(screen->format, 0xFF, 0xFF, 0xFF));
+  void show(SDL_Surface* frame, std::vector<SDL_Rect>& drawn) {
+    SDL_Rect target = box;
+
+    SDL_FillRect( frame, &target, SDL_MapRGB(frame->format, 0xFF, 0xFF, 0xFF));
+    drawn.push_back( box );
   }
 };
 
@@ -275,22 +265,54 @@ int main(int argc, char** argv)
   wall.w = 40;
   wall.h = 400;
 
-  Square theSquare(&wall);
+  // Walls never move, so they live in a tree with no margin that is
+  // never refit
+  AABBTree walls( 0 );
+  walls.create_proxy( wall, 0 );
+
+  Square theSquare(&walls);
 
   bool quit = false;
 
+  // -buffers N: draw frames into N back buffers on a thread of their
+  // own, 0 to draw them on the screen
+  int buffers = 0;
+  for( int a = 1; a + 1 < argc; ++a ) {
+    if( std::string( argv[ a ] ) == "-buffers" ) {
+      buffers = atoi( argv[ a + 1 ] );
+    }
+  }
+
   // The frame rate regulator
   Timer fps;
 
+  headless().parse( argc, argv );
   init( &screen, "Move the square (with collision detection) (up, left, down, right)" );
 
   SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
 
+  // The wall never moves, so it is part of the background
+  SDL_FillRect( screen, &wall, SDL_MapRGB(screen->format, 0x77, 0x77, 0x77));
+
   // update screen
   if(SDL_Flip( screen ) == -1) {
     FAIL_SDL("Error fliping screen.\n");
   }
 
+  DirtyRects renderer( screen );
+
+  // The square as it was for each frame in the presenter's buffers, the
+  // draw thread draws from these while theSquare moves on
+  std::vector<Square> drawnSquares( PRESENTER_MAX_DEPTH, theSquare );
+  Presenter* presenter = NULL;
+  if( buffers > 0 ) {
+    presenter = new Presenter( screen, buffers, [&]( SDL_Surface* frame, int index, std::vector<SDL_Rect>& drawn ) {
+	drawnSquares[ index ].show( frame, drawn );
+      } );
+  }
+
+  headless().start();
+
   // wait for user exit
   while(quit == false) {
     fps.start();
@@ -302,27 +324,57 @@ int main(int argc, char** argv)
 
       theSquare.handle_input( event );
     } // while(poll event)
-    
+    headless().mark( HEADLESS_INPUT );
+    double input = now_ms();
 
     theSquare.move();
 
-    SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
+    headless().mark( HEADLESS_UPDATE );
+
+    if( presenter ) {
+      // The frame is drawn on the draw thread while the next one is made,
+      // and what changed is shown here once it is done
+      int index = presenter->begin_frame();
+      drawnSquares[ index ] = theSquare;
+      presenter->submit( index, input );
+      headless().mark( HEADLESS_DRAW );
 
-    SDL_FillRect( screen, &wall, SDL_MapRGB(screen->format, 0x77, 0x77, 0x77));
+      presenter->present();
+      headless().mark( HEADLESS_PRESENT );
+    } else {
+      renderer.begin_frame();
     
-    theSquare.show( screen );
+      theSquare.show( screen, renderer );
+
+      headless().mark( HEADLESS_DRAW );
+
+      // Send only what changed to the display
+      renderer.present();
+      headless().mark( HEADLESS_PRESENT );
+    }
 
-    // update screen
-    if(SDL_Flip( screen ) == -1) {
-      FAIL_SDL("Error fliping screen.\n");        
+    if( headless().end_frame( screen ) ) {
+      quit = true;
     }
 
-    if( fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
+    if( !headless().is_enabled() && fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
       SDL_Delay( (1000 / FRAMES_PER_SECOND) - fps.get_ticks() );
     }
 
   } // while(not quit)
 
+  headless().report();
+  renderer.report();
+
+  if( presenter ) {
+    presenter->finish();
+    printf( "%d buffers: %d frames, %.1f fps, input to present %.2f ms (max %.2f ms)\n",
+	    presenter->get_depth(), presenter->get_frames(), presenter->get_fps(),
+	    presenter->get_mean_latency_ms(), presenter->get_max_latency_ms() );
+    presenter->get_renderer().report();
+    delete presenter;
+  }
+
   // SDL_FreeSurface( <the_surface> );
 
   // TTF_CloseFont( <the_font> );
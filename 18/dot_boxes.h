@@ -0,0 +1,24 @@
+// Generated by tools/boxgen from dot.png, do not edit.
+#ifndef DOT_BOXES_H
+#define DOT_BOXES_H
+
+#include "../common/boxtable.h"
+
+constexpr int DOT_BOX_COUNT = 12;
+
+constexpr BoxTableEntry DOT_BOXES[ DOT_BOX_COUNT ] = {
+  {   7,   0,   6,   1 },
+  {   5,   1,  10,   1 },
+  {   4,   2,  12,   1 },
+  {   3,   3,  14,   1 },
+  {   2,   4,  16,   1 },
+  {   1,   5,  18,   2 },
+  {   0,   7,  20,   6 },
+  {   1,  13,  18,   2 },
+  {   2,  15,  16,   2 },
+  {   3,  17,  14,   1 },
+  {   5,  18,  10,   1 },
+  {   7,  19,   6,   1 },
+};
+
+#endif
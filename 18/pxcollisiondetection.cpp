@@ -6,6 +6,16 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
+#include "../common/collision.h"
+#include "../common/spatialhash.h"
+#include "../common/swept.h"
+#include "../common/dirtyrects.h"
+#include "../common/presenter.h"
+#include "../common/rendercommands.h"
+#include "../common/headless.h"
+#include "../common/assetcache.h"
+#include "../common/pack.h"
+#include "dot_boxes.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -25,40 +35,20 @@ const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 const int SCREEN_BPP = 32;
 
+// Draw order, see common/rendercommands.h
+const int LAYER_DOTS = 1;
+
 //using namespace std;
 
 TTF_Font *load_font(std::string fontname, int size)
 {
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
+  TTF_Font* font = TTF_OpenFontRW( asset_rw( fontname ), 1, size );
   if(font == NULL) {
     FAIL_TTF("Error loading font.\n");
   }
   return font;
 }
 
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  if( optimizedImage == NULL) {
-    FAIL_IMG("Error optimizing image\n");
-  }
-  SDL_FreeSurface( loadedImage );
-  
-  Uint32 colorkey = SDL_MapRGB( optimizedImage->format, 200, 191, 231 );
-  SDL_SetColorKey( optimizedImage , SDL_SRCCOLORKEY, colorkey );
-
-  return optimizedImage;
-}
-
 void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination, SDL_Rect* clip = NULL)
 {
   SDL_Rect offset;
@@ -71,6 +61,9 @@ void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination,
 
 bool init(SDL_Surface** screen, std::string title)
 {
+  // Memory surface instead of a window with -headless
+  headless().setup();
+
   // Init SDL Stuff
   if(SDL_Init( SDL_INIT_EVERYTHING ) == -1)
     {
@@ -95,93 +88,53 @@ bool init(SDL_Surface** screen, std::string title)
   return true;
 }
 
-bool check_collision( std::vector<SDL_Rect> &a, std::vector<SDL_Rect> &b ) {
-  // The sides of the rectangles
-  int left_a, left_b;
-  int top_a, top_b;
-  int right_a, right_b;
-  int bottom_a, bottom_b;
-
-  for( int aBox = 0; aBox < a.size(); ++aBox ) {
-
-    // Calc sides a
-    left_a = a[ aBox ].x;
-    right_a = a[ aBox ].x + a[ aBox ].w;
-    top_a = a[ aBox ].y; 
-    bottom_a = a[ aBox ].y + a[ aBox ].h;  
-
-    for( int bBox = 0; bBox < b.size(); ++bBox ) {
-
-      // Calc sides b
-      left_b = b[ bBox ].x;
-      right_b = b[ bBox ].x + b[ bBox ].w;
-      top_b = b[ bBox ].y; 
-      bottom_b = b[ bBox ].y + b[ bBox ].h;
-
-      if( (bottom_a <= top_b || 
-	   top_a >= bottom_b || 
-	   right_a <= left_b || 
-	   left_a >= right_b) == false ) {
-	return true;
-      }
-    }
-  }
-  
-  return false;
-}
-
 class Dot {
 private:
+  // Where the collision boxes are, they are relative to it
   int x, y;
 
-  std::vector<SDL_Rect> box;
-
   int xVel, yVel;
 
-  // Moves collision boxes relative to box's offset
-  void shift_boxes() {
-    int r = 0;
-
-    for( int set = 0; set < box.size(); set++ ) {
-      box[ set ].x = x + (Dot::DOT_WIDTH - box[ set ].w ) / 2;
-      box[ set ].y = y + r;
-      
-      r += box[ set ].h;
-    }
-  }
-
 public:
   static const int DOT_WIDTH = 20;
   static const int DOT_HEIGHT = 20;
+  static const int DOT_STRIP = 5;
 
   Dot(int theX, int theY) {
     x = theX;
     y = theY;
     
     xVel = yVel = 0;
+  }
 
-    box.resize( 11 );
+  // Collision shape in the dot's own space, shared by every dot. Moving
+  // only changes x and y. The boxes are generated from dot.png at build
+  // time, see dot_boxes.h, and grouped in strips of DOT_STRIP rows
+  static const BoxShape& get_shape() {
+    static BoxShape shape;
 
-#define SET_BOX(index, width, height) \
-    box[ (index) ].w = (width);	      \
-    box[ (index) ].h = (height)
+    if( shape.get_boxes().empty() ) {
+      std::vector<SDL_Rect> box( DOT_BOX_COUNT );
 
-    SET_BOX( 0,  6,  1);
-    SET_BOX( 1, 10,  1);
-    SET_BOX( 2, 14,  1);
-    SET_BOX( 3, 16,  2);
-    SET_BOX( 4, 18,  2);
-    SET_BOX( 5, 20,  6);
-    SET_BOX( 6, 18,  2);
-    SET_BOX( 7, 16,  2);
-    SET_BOX( 8, 14,  1);
-    SET_BOX( 9, 10,  1);
-    SET_BOX(10,  6,  1);
+      for( int set = 0; set < box.size(); set++ ) {
+	box[ set ].x = DOT_BOXES[ set ].x;
+	box[ set ].y = DOT_BOXES[ set ].y;
+	box[ set ].w = DOT_BOXES[ set ].w;
+	box[ set ].h = DOT_BOXES[ set ].h;
+      }
 
-#undef SET_BOX
+      shape.assign( box, DOT_STRIP );
+    }
 
-    shift_boxes();
+    return shape;
+  }
+
+  int get_x() {
+    return x;
+  }
 
+  int get_y() {
+    return y;
   }
 
   void handle_input(SDL_Event& event) {
@@ -221,38 +174,48 @@ public:
     }
   }
 
-  // Move the dot
-  void move( std::vector<SDL_Rect>& rects ) {
-    x += xVel;
+  // Walls just outside the screen, the same for every dot
+  static const std::vector<SDL_Rect>& get_border() {
+    static std::vector<SDL_Rect> border;
 
-    shift_boxes();
-
-    if( x < 0 || x + Dot::DOT_WIDTH > SCREEN_WIDTH || 
-	check_collision( box, rects )) {
-      x -= xVel;
-      shift_boxes();
+    if( border.empty() ) {
+      add_border_walls( border, SCREEN_WIDTH, SCREEN_HEIGHT );
     }
 
-    y += yVel;
+    return border;
+  }
+
+  // Move the dot, stopping at the first box in the way and sliding along
+  // it. Only the dots near its path in grid, which holds others in order,
+  // are in the way. They are passed as the shared shape at their own
+  // positions, their boxes stay in local space.
+  void move( SpatialHash& grid, std::vector<Dot*>& others ) {
+    std::vector<SDL_Rect> reach( 1 );
+    std::vector<int> near;
+    std::vector<PlacedShape> shapes;
+
+    reach[ 0 ].x = x + ( xVel < 0 ? xVel : 0 );
+    reach[ 0 ].y = y + ( yVel < 0 ? yVel : 0 );
+    reach[ 0 ].w = Dot::DOT_WIDTH + abs( xVel );
+    reach[ 0 ].h = Dot::DOT_HEIGHT + abs( yVel );
 
-    shift_boxes();
+    grid.query( reach, near );
 
-    if( y < 0 || y + Dot::DOT_HEIGHT > SCREEN_HEIGHT || 
-	check_collision( box, rects )) {
-      y -= yVel;
-      shift_boxes();
+    for( int n = 0; n < near.size(); ++n ) {
+      Dot* other = others[ near[ n ] ];
+
+      if( other != this ) {
+	PlacedShape shape = { &get_shape(), other->x, other->y };
+	shapes.push_back( shape );
+      }
     }
 
+    move_and_slide( get_shape(), x, y, xVel, yVel, shapes, get_border() );
   }
 
   // Show dot on the screen
-  void show(SDL_Surface* dot, SDL_Surface* screen) {
-    apply_surface( x, y, dot, screen );
-  }
-
-  // Get collision boxes
-  std::vector<SDL_Rect>& get_rects() {
-    return box;
+  void show(SDL_Surface* dot, RenderQueue& queue) {
+    queue.blit( LAYER_DOTS, x, y, dot );
   }
 };
 
@@ -396,10 +359,21 @@ int main(int argc, char** argv)
   SDL_Color textColor = { 255, 255, 255};
 
   bool quit = false;
+  AssetCache assets;
+
+  // -buffers N: draw frames into N back buffers on a thread of their
+  // own, 0 to draw them on the screen
+  int buffers = 0;
+  for( int a = 1; a + 1 < argc; ++a ) {
+    if( std::string( argv[ a ] ) == "-buffers" ) {
+      buffers = atoi( argv[ a + 1 ] );
+    }
+  }
 
   // The frame rate regulator
   Timer fps;
 
+  headless().parse( argc, argv );
   init( &screen, "Move the dot (with pixel collision detection) (up, left, down, right)" );
 
   SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
@@ -409,10 +383,45 @@ int main(int argc, char** argv)
     FAIL_SDL("Error fliping screen.\n");
   }
 
-  dot = load_image( "dot.png" );
+  DirtyRects renderer( screen );
+
+  // Draws are recorded here and done together at the end of the frame
+  RenderQueue queue( SCREEN_WIDTH, SCREEN_HEIGHT );
+
+  // The Makefile bakes the image already in display format, colorkey
+  // set; mapping it skips decoding and converting. Find the opaque runs
+  // once, blits then copy them with memcpy
+  dot = assets.image( "dot.png", true, true );
+  if( dot == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
 
   Dot theDot( 0, 0 ), otherDot( 20, 20 );
 
+  // otherDot never moves, so the grid only needs building once
+  SpatialHash grid( Dot::DOT_WIDTH * 2 );
+  std::vector<Dot*> obstacles;
+
+  obstacles.push_back( &otherDot );
+  grid.insert( Dot::get_shape().get_boxes(), otherDot.get_x(), otherDot.get_y() );
+
+  // Each buffer's frame, recorded and prepared here, drawn on the draw
+  // thread through a queue of its own
+  std::vector< std::vector<RenderCommand> > drawnFrames( PRESENTER_MAX_DEPTH );
+  RenderQueue drawQueue( SCREEN_WIDTH, SCREEN_HEIGHT );
+  Presenter* presenter = NULL;
+  if( buffers > 0 ) {
+    presenter = new Presenter( screen, buffers, [&]( SDL_Surface* frame, int index, std::vector<SDL_Rect>& drawn ) {
+	for( int c = 0; c < drawnFrames[ index ].size(); ++c ) {
+	  drawn.push_back( drawnFrames[ index ][ c ].rect );
+	}
+	drawQueue.replay( drawnFrames[ index ] );
+	drawQueue.draw( frame );
+      } );
+  }
+
+  headless().start();
+
   // wait for user exit
   while(quit == false) {
     fps.start();
@@ -424,25 +433,65 @@ int main(int argc, char** argv)
 
       theDot.handle_input( event );
     } // while(poll event)
-    
+    headless().mark( HEADLESS_INPUT );
+    double input = now_ms();
 
-    theDot.move( otherDot.get_rects()  );
+    theDot.move( grid, obstacles );
 
-    SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
-    
-    otherDot.show(dot, screen);
-    theDot.show(dot, screen);
+    headless().mark( HEADLESS_UPDATE );
+
+    otherDot.show(dot, queue);
+    theDot.show(dot, queue);
+
+    if( presenter ) {
+      // The frame is drawn on the draw thread while the next one is made,
+      // and what changed is shown here once it is done
+      int index = presenter->begin_frame();
+      queue.prepare();
+      drawnFrames[ index ] = queue.get_commands();
+      queue.clear();
+      presenter->submit( index, input );
+      headless().mark( HEADLESS_DRAW );
+
+      presenter->present();
+      headless().mark( HEADLESS_PRESENT );
+    } else {
+      renderer.begin_frame();
+
+      queue.execute( renderer );
 
-    // update screen
-    if(SDL_Flip( screen ) == -1) {
-      FAIL_SDL("Error fliping screen.\n");        
+      headless().mark( HEADLESS_DRAW );
+
+      // Send only what changed to the display
+      renderer.present();
+      headless().mark( HEADLESS_PRESENT );
+    }
+
+    if( headless().end_frame( screen ) ) {
+      quit = true;
     }
 
-    if( fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
+    if( !headless().is_enabled() && fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
       SDL_Delay( (1000 / FRAMES_PER_SECOND) - fps.get_ticks() );
     }
 
   } // while(not quit)
+
+  headless().report();
+  renderer.report();
+
+  if( presenter ) {
+    presenter->finish();
+    printf( "%d buffers: %d frames, %.1f fps, input to present %.2f ms (max %.2f ms)\n",
+	    presenter->get_depth(), presenter->get_frames(), presenter->get_fps(),
+	    presenter->get_mean_latency_ms(), presenter->get_max_latency_ms() );
+    presenter->get_renderer().report();
+    delete presenter;
+  }
+
+  // After the presenter, its draw thread blits the dot
+  assets.report();
+  assets.clear();
   
   TTF_Quit();
   
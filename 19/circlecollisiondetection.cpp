@@ -6,7 +6,15 @@
 #include <iostream>
 #include <sstream>
 #include <vector>
-#include <cmath>
+#include "../common/collision.h"
+#include "../common/circleset.h"
+#include "../common/swept.h"
+#include "../common/dirtyrects.h"
+#include "../common/presenter.h"
+#include "../common/rendercommands.h"
+#include "../common/headless.h"
+#include "../common/assetcache.h"
+#include "../common/pack.h"
 
 #define FAIL_SDL(msg)						\
   fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
@@ -26,40 +34,20 @@ const int SCREEN_WIDTH = 640;
 const int SCREEN_HEIGHT = 480;
 const int SCREEN_BPP = 32;
 
+// Draw order, see common/rendercommands.h
+const int LAYER_DOTS = 1;
+
 //using namespace std;
 
 TTF_Font *load_font(std::string fontname, int size)
 {
-  TTF_Font* font = TTF_OpenFont(fontname.c_str(), size);
+  TTF_Font* font = TTF_OpenFontRW( asset_rw( fontname ), 1, size );
   if(font == NULL) {
     FAIL_TTF("Error loading font.\n");
   }
   return font;
 }
 
-SDL_Surface *load_image(std::string filename)
-{
-  SDL_Surface* loadedImage = NULL;
-  SDL_Surface* optimizedImage = NULL;
-
-  loadedImage = IMG_Load( filename.c_str() );
-
-  if( loadedImage == NULL ) {
-    FAIL_IMG("Error loading image.\n");
-  }
-
-  optimizedImage = SDL_DisplayFormat( loadedImage );
-  if( optimizedImage == NULL) {
-    FAIL_IMG("Error optimizing image\n");
-  }
-  SDL_FreeSurface( loadedImage );
-  
-  Uint32 colorkey = SDL_MapRGB( optimizedImage->format, 200, 191, 231 );
-  SDL_SetColorKey( optimizedImage , SDL_SRCCOLORKEY, colorkey );
-
-  return optimizedImage;
-}
-
 void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination, SDL_Rect* clip = NULL)
 {
   SDL_Rect offset;
@@ -72,6 +60,9 @@ void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination,
 
 bool init(SDL_Surface** screen, std::string title)
 {
+  // Memory surface instead of a window with -headless
+  headless().setup();
+
   // Init SDL Stuff
   if(SDL_Init( SDL_INIT_EVERYTHING ) == -1)
     {
@@ -96,88 +87,6 @@ bool init(SDL_Surface** screen, std::string title)
   return true;
 }
 
-
-struct Circle {
-  int x, y;
-  int r;
-};
-
-double distance( int x1, int y1, int x2, int y2 )
-{
-  return sqrt( pow( x2 - x1, 2 ) + pow( y2 - y1, 2 ) );
-}
-
-bool check_collision( Circle& a, Circle& b)
-{
-  if( distance( a.x, a.y, b.x, b.y ) < (a.r + b.r) ) {
-    return true;
-  }
-  return false;
-}
-
-bool check_collision( Circle& a, std::vector<SDL_Rect>& b ) {
-  int cx, cy;
-
-  for(int bBox = 0; bBox < b.size(); ++bBox ) {
-    if( a.x < b[ bBox ].x ) {
-      cx = b[ bBox ].x;
-    } else if( a.x > b[ bBox ].x + b[ bBox ].w ) {
-      cx = b[ bBox ].x + b[ bBox ].w;
-    } else {
-      cx = a.x;
-    }
-
-    if( a.y < b[ bBox ].y ) {
-      cy = b[ bBox ].y;
-    } else if( a.y > b[ bBox ].y + b[ bBox ].h ) {
-      cy = b[ bBox ].y + b[ bBox ].h;
-    } else {
-      cy = a.y;
-    }
-    
-    if( distance( a.x, a.y, cx, cy ) < a.r ) {
-      return true;
-    }    
-  }
-
-  return false;
-}
-
-bool check_collision( std::vector<SDL_Rect>& a, std::vector<SDL_Rect>& b ) {
-  // The sides of the rectangles
-  int left_a, left_b;
-  int top_a, top_b;
-  int right_a, right_b;
-  int bottom_a, bottom_b;
-
-  for( int aBox = 0; aBox < a.size(); ++aBox ) {
-
-    // Calc sides a
-    left_a = a[ aBox ].x;
-    right_a = a[ aBox ].x + a[ aBox ].w;
-    top_a = a[ aBox ].y; 
-    bottom_a = a[ aBox ].y + a[ aBox ].h;  
-
-    for( int bBox = 0; bBox < b.size(); ++bBox ) {
-
-      // Calc sides b
-      left_b = b[ bBox ].x;
-      right_b = b[ bBox ].x + b[ bBox ].w;
-      top_b = b[ bBox ].y; 
-      bottom_b = b[ bBox ].y + b[ bBox ].h;
-
-      if( (bottom_a <= top_b || 
-	   top_a >= bottom_b || 
-	   right_a <= left_b || 
-	   left_a >= right_b) == false ) {
-	return true;
-      }
-    }
-  }
-  
-  return false;
-}
-
 class Dot {
 private:
   Circle c;
@@ -190,6 +99,7 @@ public:
 
   Dot() {
     c.x = c.y = 10;
+    c.r = DOT_WIDTH / 2;
 
     xVel = yVel = 0;
   }
@@ -231,27 +141,15 @@ public:
     }
   }
 
-  // Move the dot
-  void move( std::vector<SDL_Rect>& rects, Circle& circle ) {
-    c.x += xVel;
-
-    if( c.x < 0 || c.x + Dot::DOT_WIDTH > SCREEN_WIDTH || 
-	check_collision( circle, box )) {
-      c.x -= xVel;
-    }
-
-    c.y += yVel;
-
-    if( c.y < 0 || c.y + Dot::DOT_HEIGHT > SCREEN_HEIGHT || 
-	check_collision( circle, box )) {
-      c.y -= yVel;
-    }
-
+  // Move the dot, stopping at the first wall or circle in the way and
+  // sliding along it
+  void move( const std::vector<SDL_Rect>& walls, const CircleSet& circles ) {
+    move_and_slide( c.x, c.y, c.r, xVel, yVel, walls, circles );
   }
 
   // Show dot on the screen
-  void show(SDL_Surface* dot, SDL_Surface* screen) {
-    apply_surface( x, y, dot, screen );
+  void show(SDL_Surface* dot, RenderQueue& queue) {
+    queue.blit( LAYER_DOTS, c.x - c.r, c.y - c.r, dot );
   }
 };
 
@@ -329,6 +227,7 @@ int main(int argc, char** argv)
   SDL_Color textColor = { 255, 255, 255};
 
   bool quit = false;
+  AssetCache assets;
 
   Dot theDot;
   std::vector<SDL_Rect> box(1);
@@ -346,16 +245,65 @@ int main(int argc, char** argv)
   // The frame rate regulator
   Timer fps;
 
+  // -buffers N: draw frames into N back buffers on a thread of their
+  // own, 0 to draw them on the screen
+  int buffers = 0;
+  for( int a = 1; a + 1 < argc; ++a ) {
+    if( std::string( argv[ a ] ) == "-buffers" ) {
+      buffers = atoi( argv[ a + 1 ] );
+    }
+  }
+
+  headless().parse( argc, argv );
   init( &screen, "Move the dot (with circle collision detection) (up, left, down, right)" );
 
   SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
 
+  // The box never moves, so it is part of the background
+  SDL_FillRect( screen, &box[0], SDL_MapRGB(screen->format, 0xFF, 0xFF, 0xFF) );
+
   // update screen
   if(SDL_Flip( screen ) == -1) {
     FAIL_SDL("Error fliping screen.\n");
   }
 
-  dot = load_image( "dot.png" );
+  DirtyRects renderer( screen );
+
+  // Draws are recorded here and done together at the end of the frame
+  RenderQueue queue( SCREEN_WIDTH, SCREEN_HEIGHT );
+
+  // The Makefile bakes the image already in display format, colorkey
+  // set; mapping it skips decoding and converting. Find the opaque runs
+  // once, blits then copy them with memcpy
+  dot = assets.image( "dot.png", true, true );
+  if( dot == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
+
+  // Nothing the dot runs into moves, so the walls and circles are laid
+  // out once
+  std::vector<SDL_Rect> walls( box );
+  CircleSet circles;
+
+  add_border_walls( walls, SCREEN_WIDTH, SCREEN_HEIGHT );
+  circles.push_back( otherDot.x, otherDot.y, otherDot.r );
+
+  // Each buffer's frame, recorded and prepared here, drawn on the draw
+  // thread through a queue of its own
+  std::vector< std::vector<RenderCommand> > drawnFrames( PRESENTER_MAX_DEPTH );
+  RenderQueue drawQueue( SCREEN_WIDTH, SCREEN_HEIGHT );
+  Presenter* presenter = NULL;
+  if( buffers > 0 ) {
+    presenter = new Presenter( screen, buffers, [&]( SDL_Surface* frame, int index, std::vector<SDL_Rect>& drawn ) {
+	for( int c = 0; c < drawnFrames[ index ].size(); ++c ) {
+	  drawn.push_back( drawnFrames[ index ][ c ].rect );
+	}
+	drawQueue.replay( drawnFrames[ index ] );
+	drawQueue.draw( frame );
+      } );
+  }
+
+  headless().start();
 
   // wait for user exit
   while(quit == false) {
@@ -369,31 +317,69 @@ int main(int argc, char** argv)
       theDot.handle_input(event);
 
     } // while(poll event)
-    
-
-    theDot.move( otherDot.get_rects()  );
+    headless().mark( HEADLESS_INPUT );
+    double input = now_ms();
 
-    SDL_FillRect( screen, &screen->clip_rect, SDL_MapRGB(screen->format, 0x00, 0x00, 0x00));
+    theDot.move( walls, circles );
 
-    SDL_FillRect( screen, &box[0], SDL_MapRGB(screen->format, 0xFF, 0xFF, 0xFF) );
+    headless().mark( HEADLESS_UPDATE );
 
-    apply_surface( otherDot.x - otherDot.r , otherDot.y - otherDot.r, dot, screen );
+    queue.blit( LAYER_DOTS, otherDot.x - otherDot.r , otherDot.y - otherDot.r, dot );
     
-    theDot.show(dot, screen);
+    theDot.show(dot, queue);
+
+    theDot.show(dot, queue);
+
+    if( presenter ) {
+      // The frame is drawn on the draw thread while the next one is made,
+      // and what changed is shown here once it is done
+      int index = presenter->begin_frame();
+      queue.prepare();
+      drawnFrames[ index ] = queue.get_commands();
+      queue.clear();
+      presenter->submit( index, input );
+      headless().mark( HEADLESS_DRAW );
+
+      presenter->present();
+      headless().mark( HEADLESS_PRESENT );
+    } else {
+      renderer.begin_frame();
+
+      // One pass over the sorted draws, the second theDot is dropped
+      queue.execute( renderer );
 
-    otherDot.show(dot, screen);
-    theDot.show(dot, screen);
+      headless().mark( HEADLESS_DRAW );
+
+      // Send only what changed to the display
+      renderer.present();
+      headless().mark( HEADLESS_PRESENT );
+    }
 
-    // update screen
-    if(SDL_Flip( screen ) == -1) {
-      FAIL_SDL("Error fliping screen.\n");        
+    if( headless().end_frame( screen ) ) {
+      quit = true;
     }
 
-    if( fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
+    if( !headless().is_enabled() && fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
       SDL_Delay( (1000 / FRAMES_PER_SECOND) - fps.get_ticks() );
     }
 
   } // while(not quit)
+
+  headless().report();
+  renderer.report();
+
+  if( presenter ) {
+    presenter->finish();
+    printf( "%d buffers: %d frames, %.1f fps, input to present %.2f ms (max %.2f ms)\n",
+	    presenter->get_depth(), presenter->get_frames(), presenter->get_fps(),
+	    presenter->get_mean_latency_ms(), presenter->get_max_latency_ms() );
+    presenter->get_renderer().report();
+    delete presenter;
+  }
+
+  // After the presenter, its draw thread blits the dot
+  assets.report();
+  assets.clear();
   
   TTF_Quit();
   
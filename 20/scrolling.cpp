@@ -0,0 +1,254 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdlib.h>
+#include <string>
+#include "../common/headless.h"
+#include "../common/assetcache.h"
+#include "../common/tiledimage.h"
+
+#define FAIL_SDL(msg)						\
+  fprintf(stderr, msg "SDL Error: %s\n", SDL_GetError());	\
+  exit(-1)
+
+#define FAIL_IMG(msg)						\
+  fprintf(stderr, msg "IMG Error: %s\n", IMG_GetError());	\
+  exit(-1)
+
+
+const int FRAMES_PER_SECOND = 20;
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int SCREEN_BPP = 32;
+
+//using namespace std;
+
+void apply_surface(int x, int y, SDL_Surface* source, SDL_Surface* destination, SDL_Rect* clip = NULL)
+{
+  SDL_Rect offset;
+
+  offset.x = x;
+  offset.y = y;
+
+  SDL_BlitSurface( source, clip, destination, &offset );
+}
+
+bool init(SDL_Surface** screen, std::string title)
+{
+  // Memory surface instead of a window with -headless
+  headless().setup();
+
+  // Init SDL Stuff
+  if(SDL_Init( SDL_INIT_EVERYTHING ) == -1)
+    {
+      FAIL_SDL("Error initializing SDL.\n");
+    }
+
+  // Setup screen
+  *screen = SDL_SetVideoMode( SCREEN_WIDTH, SCREEN_HEIGHT, SCREEN_BPP, SDL_SWSURFACE );
+  if(*screen == NULL)
+    {
+      FAIL_SDL("Error setting up SDL\n");
+    }
+
+  // Set window title
+  SDL_WM_SetCaption(title.c_str(), NULL);
+
+  return true;
+}
+
+// The dot moves around a level larger than the screen, the camera
+// follows it
+class Dot {
+private:
+  int x, y;
+  int xVel, yVel;
+
+  // Keeps going and bounces off the level's edges, for -headless
+  bool cruising;
+
+public:
+  static const int DOT_WIDTH = 37;
+  static const int DOT_HEIGHT = 36;
+
+  Dot() {
+    x = 0;
+    y = 0;
+
+    xVel = 0;
+    yVel = 0;
+
+    cruising = false;
+  }
+
+  void handle_input(SDL_Event& event) {
+    if( event.type == SDL_KEYDOWN ) {
+      switch( event.key.keysym.sym ) {
+      case SDLK_UP:
+	yVel -= Dot::DOT_HEIGHT / 2; break;
+      case SDLK_DOWN:
+	yVel += Dot::DOT_HEIGHT / 2; break;
+      case SDLK_LEFT:
+	xVel -= Dot::DOT_WIDTH / 2; break;
+      case SDLK_RIGHT:
+	xVel += Dot::DOT_WIDTH / 2; break;
+      }
+    } else if( event.type == SDL_KEYUP ) {
+      switch( event.key.keysym.sym ) {
+      case SDLK_UP:
+	yVel += Dot::DOT_HEIGHT / 2; break;
+      case SDLK_DOWN:
+	yVel -= Dot::DOT_HEIGHT / 2; break;
+      case SDLK_LEFT:
+	xVel += Dot::DOT_WIDTH / 2; break;
+      case SDLK_RIGHT:
+	xVel -= Dot::DOT_WIDTH / 2; break;
+      }
+    }
+  }
+
+  void cruise() {
+    cruising = true;
+    xVel = Dot::DOT_WIDTH / 2;
+    yVel = Dot::DOT_HEIGHT / 3;
+  }
+
+  void move(int levelWidth, int levelHeight) {
+    x += xVel;
+    if ( x < 0 || x + Dot::DOT_WIDTH > levelWidth ) {
+      x -= xVel;
+      if( cruising ) {
+	xVel = -xVel;
+      }
+    }
+    y += yVel;
+    if( y < 0 || y + Dot::DOT_HEIGHT > levelHeight ) {
+      y -= yVel;
+      if( cruising ) {
+	yVel = -yVel;
+      }
+    }
+  }
+
+  // Centers the camera on the dot, inside the level
+  void set_camera(SDL_Rect& camera, int levelWidth, int levelHeight) {
+    int cameraX = ( x + Dot::DOT_WIDTH / 2 ) - SCREEN_WIDTH / 2;
+    int cameraY = ( y + Dot::DOT_HEIGHT / 2 ) - SCREEN_HEIGHT / 2;
+
+    cameraX = cameraX > levelWidth - camera.w ? levelWidth - camera.w : cameraX;
+    cameraY = cameraY > levelHeight - camera.h ? levelHeight - camera.h : cameraY;
+    camera.x = cameraX < 0 ? 0 : cameraX;
+    camera.y = cameraY < 0 ? 0 : cameraY;
+  }
+
+  void show(SDL_Surface* dot, SDL_Surface* screen, SDL_Rect& camera) {
+    apply_surface( x - camera.x, y - camera.y, dot, screen );
+  }
+};
+
+class Timer {
+private:
+  int startTicks;
+
+public:
+  Timer() {
+    startTicks = 0;
+  }
+
+  void start() {
+    startTicks = SDL_GetTicks();
+  }
+
+  int get_ticks() {
+    return SDL_GetTicks() - startTicks;
+  }
+};
+
+int main(int argc, char** argv)
+{
+  SDL_Surface* screen = NULL;
+  SDL_Surface* dot = NULL;
+  SDL_Event event;
+  AssetCache assets;
+
+  // The level, decoded a tile at a time as the camera gets to it. Keeps
+  // TILED_DEFAULT_BUDGET bytes of tiles, -budget N keeps N screens' worth.
+  TiledImage level;
+
+  bool quit = false;
+
+  for( int a = 1; a + 1 < argc; ++a ) {
+    if( std::string( argv[ a ] ) == "-budget" ) {
+      level.set_budget( (size_t) atoi( argv[ a + 1 ] ) * SCREEN_WIDTH * SCREEN_HEIGHT * SCREEN_BPP / 8 );
+    }
+  }
+
+  // The frame rate regulator
+  Timer fps;
+
+  headless().parse( argc, argv );
+  init( &screen, "Scrolling (up, left, down, right)" );
+
+  dot = assets.image( "dot.png" );
+  if( dot == NULL || !level.open( "world.tiles" ) ) {
+    FAIL_IMG("Error loading image.\n");
+  }
+
+  SDL_Rect camera = { 0, 0, SCREEN_WIDTH, SCREEN_HEIGHT };
+  Dot theDot;
+
+  // Nobody is at the keys
+  if( headless().is_enabled() ) {
+    theDot.cruise();
+  }
+
+  headless().start();
+
+  // wait for user exit
+  while(quit == false) {
+    fps.start();
+
+    while( SDL_PollEvent( &event ) ) {
+      if( event.type == SDL_QUIT ) {
+	quit = true;
+      }
+
+      theDot.handle_input( event );
+    }
+    headless().mark( HEADLESS_INPUT );
+
+    theDot.move( level.get_width(), level.get_height() );
+    theDot.set_camera( camera, level.get_width(), level.get_height() );
+    headless().mark( HEADLESS_UPDATE );
+
+    // Only the tiles under the camera are decoded, or come from the cache
+    level.draw( camera, screen, 0, 0 );
+    theDot.show( dot, screen, camera );
+    headless().mark( HEADLESS_DRAW );
+
+    if(SDL_Flip( screen ) == -1) {
+      FAIL_SDL("Error fliping screen.\n");
+    }
+    headless().mark( HEADLESS_PRESENT );
+
+    if( headless().end_frame( screen ) ) {
+      quit = true;
+    }
+
+    if( !headless().is_enabled() && fps.get_ticks() < 1000 / FRAMES_PER_SECOND ) {
+      SDL_Delay( (1000 / FRAMES_PER_SECOND) - fps.get_ticks() );
+    }
+  }
+
+  headless().report();
+
+  printf( "level %dx%d: %d tiles decoded, %d drawn from the cache, %d freed, %d (%lu bytes) kept\n",
+	  level.get_width(), level.get_height(), level.get_decodes(), level.get_hits(), level.get_evictions(),
+	  level.get_live_tiles(), (unsigned long) level.get_live_bytes() );
+
+  // The screen belongs to SDL, SDL_Quit frees it
+  level.close();
+  assets.clear();
+  SDL_Quit();
+
+  return 0;
+}
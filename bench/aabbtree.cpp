@@ -0,0 +1,139 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "../common/clock.h"
+#include "../common/aabbtree.h"
+
+// Hundreds of static walls and thousands of moving dots, with the walls
+// in a static tree and the dots in a dynamic one. Reports tree quality
+// and the throughput of pair, rect and point queries; the pairs of the
+// first frame are checked against brute force.
+
+const int WORLD = 8000;
+const int WALLS = 400;
+const int DOT_SIZE = 20;
+const int FRAMES = 100;
+
+struct Mover {
+  SDL_Rect box;
+  int xVel, yVel;
+  int proxy;
+};
+
+bool check_collision( SDL_Rect a, SDL_Rect b ) {
+  return !( a.y + a.h <= b.y || a.y >= b.y + b.h || a.x + a.w <= b.x || a.x >= b.x + b.w );
+}
+
+int main( int argc, char** argv )
+{
+  static const int counts[] = { 1000, 4000, 16000 };
+
+  srand( 1234 );
+
+  // Static geometry is built once and never moved
+  AABBTree walls( 0 );
+  std::vector<SDL_Rect> wallRects;
+  for( int w = 0; w < WALLS; ++w ) {
+    SDL_Rect r;
+    bool vertical = rand() % 2;
+    r.x = rand() % WORLD;
+    r.y = rand() % WORLD;
+    r.w = vertical ? 40 : 100 + rand() % 300;
+    r.h = vertical ? 100 + rand() % 300 : 40;
+
+    walls.create_proxy( r, w );
+    wallRects.push_back( r );
+  }
+
+  printf( "static tree: %d walls, height %d, average depth %.2f, SAH cost %.2f\n",
+	  walls.size(), walls.height(), walls.average_depth(), walls.sah_cost() );
+
+  printf( "%8s %8s %8s %8s %12s %12s %14s %14s\n", "movers", "height", "depth", "SAH", "frame ms", "reinserts", "rect q/s", "point q/s" );
+
+  for( int c = 0; c < sizeof( counts ) / sizeof( counts[ 0 ] ); ++c ) {
+    int n = counts[ c ];
+    AABBTree tree;
+    std::vector<Mover> movers( n );
+
+    for( int m = 0; m < n; ++m ) {
+      movers[ m ].box.x = rand() % WORLD;
+      movers[ m ].box.y = rand() % WORLD;
+      movers[ m ].box.w = movers[ m ].box.h = DOT_SIZE;
+      movers[ m ].xVel = rand() % 9 - 4;
+      movers[ m ].yVel = rand() % 9 - 4;
+      movers[ m ].proxy = tree.create_proxy( movers[ m ].box, m );
+    }
+
+    // First frame against brute force
+    std::vector< std::pair<int, int> > pairs, wallPairs;
+    tree.find_pairs( pairs );
+    tree.find_pairs( walls, wallPairs );
+
+    int brutePairs = 0, bruteWallPairs = 0;
+    for( int a = 0; a < n; ++a ) {
+      for( int b = a + 1; b < n; ++b ) {
+	brutePairs += check_collision( movers[ a ].box, movers[ b ].box );
+      }
+      for( int w = 0; w < WALLS; ++w ) {
+	bruteWallPairs += check_collision( movers[ a ].box, wallRects[ w ] );
+      }
+    }
+
+    if( brutePairs != pairs.size() || bruteWallPairs != wallPairs.size() ) {
+      fprintf( stderr, "pairs differ from brute force: %d/%d, %d/%d\n",
+	       (int) pairs.size(), brutePairs, (int) wallPairs.size(), bruteWallPairs );
+      return 1;
+    }
+
+    // Move everything for a while, finding all pairs every frame
+    int reinserts = 0;
+    double start = now_ms();
+    for( int f = 0; f < FRAMES; ++f ) {
+      for( int m = 0; m < n; ++m ) {
+	Mover& mover = movers[ m ];
+
+	mover.box.x += mover.xVel;
+	mover.box.y += mover.yVel;
+	if( mover.box.x < 0 || mover.box.x > WORLD ) mover.xVel = -mover.xVel;
+	if( mover.box.y < 0 || mover.box.y > WORLD ) mover.yVel = -mover.yVel;
+
+	reinserts += tree.move_proxy( mover.proxy, mover.box, mover.xVel, mover.yVel );
+      }
+
+      pairs.clear();
+      wallPairs.clear();
+      tree.find_pairs( pairs );
+      tree.find_pairs( walls, wallPairs );
+    }
+    double frameMs = ( now_ms() - start ) / FRAMES;
+
+    // Query throughput on the moved tree
+    const int queries = 100000;
+    std::vector<int> hits;
+    start = now_ms();
+    for( int q = 0; q < queries; ++q ) {
+      SDL_Rect r;
+      r.x = rand() % WORLD;
+      r.y = rand() % WORLD;
+      r.w = r.h = 64;
+      hits.clear();
+      tree.query( r, hits );
+    }
+    double rectMs = now_ms() - start;
+
+    start = now_ms();
+    for( int q = 0; q < queries; ++q ) {
+      hits.clear();
+      tree.query_point( rand() % WORLD, rand() % WORLD, hits );
+    }
+    double pointMs = now_ms() - start;
+
+    printf( "%8d %8d %8.2f %8.2f %12.3f %12d %14.0f %14.0f\n", n, tree.height(), tree.average_depth(), tree.sah_cost(),
+	    frameMs, reinserts / FRAMES, queries / rectMs * 1e3, queries / pointMs * 1e3 );
+  }
+
+  return 0;
+}
@@ -0,0 +1,163 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <SDL/SDL_ttf.h>
+#include <SDL/SDL_mixer.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include "../common/clock.h"
+#include "../common/assetcache.h"
+
+// AssetCache step by step on the examples' assets: loading, asking again
+// for the same key, asking for spans on a cached image, a different key
+// for the same file, releasing down to
+// zero and clearing. After each step the live counts and bytes per type
+// must be what the loaded assets add up to, and a second request for a
+// key must hand back the same asset. Also times a load against a hit.
+
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int RUNS = 50;
+
+const char* const IMAGE = "../05/dude.png";
+const char* const FONT = "../16/DejaVuSans.ttf";
+const char* const SOUND = "../11/high.wav";
+
+size_t surface_bytes( SDL_Surface* surface ) {
+  return (size_t) surface->pitch * surface->h;
+}
+
+size_t span_bytes( SDL_Surface* surface ) {
+  std::unordered_map<SDL_Surface*, SpanSprite*>::iterator encoded = span_sprites().find( surface );
+  return encoded != span_sprites().end() ? encoded->second->get_span_count() * sizeof( Span ) : 0;
+}
+
+size_t file_bytes( const char* path ) {
+  struct stat info;
+  return stat( path, &info ) == 0 ? info.st_size : 0;
+}
+
+// Prints the step and whether the cache holds what it should
+bool step( const char* name, const AssetCache& assets, bool same, int images, size_t imageBytes,
+	   int fonts, size_t fontBytes, int sounds, size_t soundBytes ) {
+  bool match = same &&
+    assets.get_live_count( CACHED_IMAGE ) == images && assets.get_live_bytes( CACHED_IMAGE ) == imageBytes &&
+    assets.get_live_count( CACHED_FONT ) == fonts && assets.get_live_bytes( CACHED_FONT ) == fontBytes &&
+    assets.get_live_count( CACHED_SOUND ) == sounds && assets.get_live_bytes( CACHED_SOUND ) == soundBytes;
+
+  printf( "%-28s %6d %10lu %6d %10lu %6d %10lu %6d %6d %6s\n", name,
+	  assets.get_live_count( CACHED_IMAGE ), (unsigned long) assets.get_live_bytes( CACHED_IMAGE ),
+	  assets.get_live_count( CACHED_FONT ), (unsigned long) assets.get_live_bytes( CACHED_FONT ),
+	  assets.get_live_count( CACHED_SOUND ), (unsigned long) assets.get_live_bytes( CACHED_SOUND ),
+	  assets.get_loads(), assets.get_hits(), match ? "yes" : "NO" );
+
+  return match;
+}
+
+int main( int argc, char** argv )
+{
+  setenv( "SDL_VIDEODRIVER", "dummy", 1 );
+  setenv( "SDL_AUDIODRIVER", "dummy", 1 );
+  if( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_AUDIO ) < 0 || SDL_SetVideoMode( SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_SWSURFACE ) == NULL ||
+      TTF_Init() < 0 || Mix_OpenAudio( 22050, MIX_DEFAULT_FORMAT, 2, 4096 ) < 0 ) {
+    fprintf( stderr, "Error setting up SDL: %s\n", SDL_GetError() );
+    return 1;
+  }
+
+  AssetCache assets;
+  bool ok = true;
+
+  printf( "%-28s %6s %10s %6s %10s %6s %10s %6s %6s %6s\n", "step", "images", "bytes", "fonts", "bytes", "sounds", "bytes",
+	  "loads", "hits", "match" );
+
+  SDL_Surface* keyed = assets.image( IMAGE );
+  if( keyed == NULL ) {
+    fprintf( stderr, "Error loading %s\n", IMAGE );
+    return 1;
+  }
+  size_t imageBytes = surface_bytes( keyed );
+  ok = step( "image", assets, true, 1, imageBytes, 0, 0, 0, 0 ) && ok;
+
+  // Same key, same surface, one more reference
+  SDL_Surface* again = assets.image( IMAGE );
+  ok = step( "same image", assets, again == keyed, 1, imageBytes, 0, 0, 0, 0 ) && ok;
+
+  // Spans are not in the key: the same surface, encoded now and counted
+  SDL_Surface* spanned = assets.image( IMAGE, true, true );
+  size_t keyedBytes = imageBytes + span_bytes( keyed );
+  ok = step( "same image with spans", assets, spanned == keyed && keyedBytes > imageBytes, 1, keyedBytes, 0, 0, 0, 0 ) && ok;
+
+  // Asked for again, they are not encoded twice
+  assets.release( assets.image( IMAGE, true, true ) );
+  ok = step( "spans again", assets, true, 1, keyedBytes, 0, 0, 0, 0 ) && ok;
+
+  // Without the colorkey it is another asset
+  SDL_Surface* plain = assets.image( IMAGE, false );
+  size_t bothBytes = keyedBytes + imageBytes;
+  ok = step( "image without colorkey", assets, plain != keyed && plain != NULL, 2, bothBytes, 0, 0, 0, 0 ) && ok;
+
+  TTF_Font* font = assets.font( FONT, 27 );
+  TTF_Font* fontAgain = assets.font( FONT, 27 );
+  TTF_Font* small = assets.font( FONT, 12 );
+  size_t fontBytes = file_bytes( FONT );
+  ok = step( "font twice, other size", assets, font != NULL && fontAgain == font && small != font,
+	     2, bothBytes, 2, 2 * fontBytes, 0, 0 ) && ok;
+
+  Mix_Chunk* sound = assets.sound( SOUND );
+  Mix_Chunk* soundAgain = assets.sound( SOUND );
+  size_t soundBytes = sound ? sound->alen : 0;
+  ok = step( "sound twice", assets, sound != NULL && soundAgain == sound, 2, bothBytes, 2, 2 * fontBytes, 1, soundBytes ) && ok;
+
+  // Two references or more each: the first release keeps them
+  assets.release( keyed );
+  assets.release( font );
+  assets.release( sound );
+  ok = step( "release once", assets, true, 2, bothBytes, 2, 2 * fontBytes, 1, soundBytes ) && ok;
+
+  assets.release( again );
+  assets.release( spanned );
+  assets.release( fontAgain );
+  assets.release( soundAgain );
+  ok = step( "release to zero", assets, true, 1, imageBytes, 1, fontBytes, 0, 0 ) && ok;
+
+  // Freed, so asking again loads it again
+  SDL_Surface* reloaded = assets.image( IMAGE );
+  ok = step( "image after release", assets, reloaded != NULL, 2, 2 * imageBytes, 1, fontBytes, 0, 0 ) && ok;
+
+  // Not from this cache: nothing happens
+  SDL_Surface* other = SDL_CreateRGBSurface( SDL_SWSURFACE, 4, 4, 32, 0xFF0000, 0x00FF00, 0x0000FF, 0 );
+  assets.release( other );
+  SDL_FreeSurface( other );
+  ok = step( "release unknown", assets, true, 2, 2 * imageBytes, 1, fontBytes, 0, 0 ) && ok;
+
+  // Two images, two fonts, a sound and the image again; five shared
+  if( assets.get_loads() != 6 || assets.get_hits() != 5 ) {
+    printf( "expected 6 loads and 5 hits\n" );
+    ok = false;
+  }
+
+  assets.clear();
+  ok = step( "clear", assets, true, 0, 0, 0, 0, 0, 0 ) && ok;
+
+  // A load decodes and converts, a hit is a lookup
+  double loadMs = 0, hitMs = 0;
+  for( int r = 0; r < RUNS; ++r ) {
+    double start = now_ms();
+    SDL_Surface* image = assets.image( IMAGE );
+    double loaded = now_ms();
+    assets.image( IMAGE );
+    hitMs += now_ms() - loaded;
+    loadMs += loaded - start;
+
+    assets.release( image );
+    assets.release( image );
+  }
+  printf( "\nload %.4f ms, hit %.4f ms\n", loadMs / RUNS, hitMs / RUNS );
+  ok = assets.get_live_count( CACHED_IMAGE ) == 0 && ok;
+
+  Mix_CloseAudio();
+  TTF_Quit();
+  SDL_Quit();
+
+  return ok ? 0 : 1;
+}
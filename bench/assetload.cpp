@@ -0,0 +1,126 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../common/clock.h"
+#include "../common/blob.h"
+
+// Startup time of the examples' images loaded the way load_image always
+// did (IMG_Load, SDL_DisplayFormat, colorkey) against mapping the blob
+// tools/bake writes for them. Both are followed by one blit to the
+// screen, so the blob's pages are faulted in as they would be on the
+// first frame. Every blob must give the same pixels as the decoded image.
+//
+// usage: assetload [image...], the examples' images by default. The
+// blobs are baked to /tmp first, so the files are in the page cache for
+// both paths.
+
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int RUNS = 50;
+
+SDL_Surface* decode( const std::string& file ) {
+  SDL_Surface* loaded = IMG_Load( file.c_str() );
+  if( loaded == NULL ) {
+    return NULL;
+  }
+
+  SDL_Surface* image = SDL_DisplayFormat( loaded );
+  SDL_FreeSurface( loaded );
+  SDL_SetColorKey( image, SDL_SRCCOLORKEY, SDL_MapRGB( image->format, 200, 191, 231 ) );
+
+  return image;
+}
+
+bool same_pixels( SDL_Surface* a, SDL_Surface* b ) {
+  if( a->w != b->w || a->h != b->h || a->format->colorkey != b->format->colorkey ||
+      ( a->flags & SDL_SRCCOLORKEY ) != ( b->flags & SDL_SRCCOLORKEY ) ) {
+    return false;
+  }
+  for( int y = 0; y < a->h; ++y ) {
+    if( memcmp( (Uint8*) a->pixels + y * a->pitch, (Uint8*) b->pixels + y * b->pitch, a->w * a->format->BytesPerPixel ) != 0 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main( int argc, char** argv )
+{
+  static const char* examples[] = {
+    "../02/background.bmp", "../02/message.bmp", "../03/background.png", "../03/message.png", "../04/image.png",
+    "../05/background.png", "../05/dude.png", "../06/dots.png", "../09/button.png", "../16/dot.png", "../18/dot.png", "../19/dot.png"
+  };
+
+  std::vector<std::string> files;
+  for( int a = 1; a < argc; ++a ) {
+    files.push_back( argv[ a ] );
+  }
+  if( files.empty() ) {
+    files.assign( examples, examples + sizeof( examples ) / sizeof( examples[ 0 ] ) );
+  }
+
+  setenv( "SDL_VIDEODRIVER", "dummy", 1 );
+  SDL_Init( SDL_INIT_VIDEO );
+  SDL_Surface* screen = SDL_SetVideoMode( SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_SWSURFACE );
+  if( screen == NULL ) {
+    fprintf( stderr, "Error setting video mode: %s\n", SDL_GetError() );
+    return 1;
+  }
+
+  printf( "%24s %10s %12s %12s %8s %8s\n", "image", "size", "decode ms", "blob ms", "speedup", "match" );
+
+  double decodeTotal = 0, blobTotal = 0;
+  bool allMatch = true;
+
+  for( int f = 0; f < files.size(); ++f ) {
+    SDL_Surface* reference = decode( files[ f ] );
+    if( reference == NULL ) {
+      printf( "%24s %10s\n", files[ f ].c_str(), "missing" );
+      continue;
+    }
+
+    std::string blob = "/tmp/assetload" + std::to_string( f ) + ".blob";
+    save_blob( reference, blob );
+
+    SDL_Surface* mapped = load_blob( blob );
+    bool match = mapped != NULL && same_pixels( reference, mapped );
+    free_blob( mapped );
+
+    double start = now_ms();
+    for( int r = 0; r < RUNS; ++r ) {
+      SDL_Surface* image = decode( files[ f ] );
+      SDL_BlitSurface( image, NULL, screen, NULL );
+      SDL_FreeSurface( image );
+    }
+    double decodeMs = ( now_ms() - start ) / RUNS;
+
+    start = now_ms();
+    for( int r = 0; r < RUNS; ++r ) {
+      SDL_Surface* image = load_blob( blob );
+      SDL_BlitSurface( image, NULL, screen, NULL );
+      free_blob( image );
+    }
+    double blobMs = ( now_ms() - start ) / RUNS;
+
+    char size[ 16 ];
+    snprintf( size, sizeof( size ), "%dx%d", reference->w, reference->h );
+    printf( "%24s %10s %12.4f %12.4f %8.2f %8s\n", files[ f ].c_str(), size, decodeMs, blobMs, decodeMs / blobMs, match ? "yes" : "NO" );
+
+    decodeTotal += decodeMs;
+    blobTotal += blobMs;
+    allMatch = allMatch && match;
+
+    SDL_FreeSurface( reference );
+    remove( blob.c_str() );
+  }
+
+  printf( "%24s %10s %12.4f %12.4f %8.2f %8s\n", "startup", "", decodeTotal, blobTotal, blobTotal > 0 ? decodeTotal / blobTotal : 0, allMatch ? "yes" : "NO" );
+
+  SDL_Quit();
+
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,114 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include "../common/clock.h"
+#include "../common/bitmask.h"
+#include "../common/collision.h"
+#include "../18/dot_boxes.h"
+
+// Bitmask collision against the box list of 18's Dot on dot.png.
+// Both are timed on the same random offsets; the mask is also checked
+// against a plain per pixel test, and the boxes' misses are counted.
+
+#define FAIL_IMG(msg)						\
+  fprintf(stderr, msg "IMG Error: %s\n", IMG_GetError());	\
+  exit(-1)
+
+const int RANGE = 24;
+
+// What Dot::move does before each test: rewrite the boxes at x, y
+void shift_boxes( std::vector<SDL_Rect>& box, int x, int y ) {
+  for( int set = 0; set < box.size(); set++ ) {
+    box[ set ].x = x + DOT_BOXES[ set ].x;
+    box[ set ].y = y + DOT_BOXES[ set ].y;
+  }
+}
+
+bool pixel_reference( const Bitmask& a, int ax, int ay, const Bitmask& b, int bx, int by ) {
+  for( int y = 0; y < a.height(); ++y ) {
+    for( int x = 0; x < a.width(); ++x ) {
+      if( a.get( x, y ) && b.get( x + ax - bx, y + ay - by ) ) {
+	return true;
+      }
+    }
+  }
+  return false;
+}
+
+int main( int argc, char** argv )
+{
+  const char* file = argc > 1 ? argv[ 1 ] : "../18/dot.png";
+
+  SDL_Surface* dot = IMG_Load( file );
+  if( dot == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
+
+  // Same key load_image sets, on a 32 bit surface like the display's
+  SDL_Surface* layout = SDL_CreateRGBSurface( SDL_SWSURFACE, 1, 1, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0 );
+  SDL_Surface* keyed = SDL_ConvertSurface( dot, layout->format, SDL_SWSURFACE );
+  SDL_SetColorKey( keyed, SDL_SRCCOLORKEY, SDL_MapRGB( keyed->format, 200, 191, 231 ) );
+
+  Bitmask mask( keyed );
+
+  srand( 1234 );
+
+  const int count = 1 << 20;
+  std::vector<int> offsets( count * 2 );
+  for( int i = 0; i < count * 2; ++i ) {
+    offsets[ i ] = rand() % ( RANGE * 2 + 1 ) - RANGE;
+  }
+
+  // Exactness, and how often the boxes disagree with the pixels
+  int boxMisses = 0;
+  std::vector<SDL_Rect> a( DOT_BOX_COUNT ), b( DOT_BOX_COUNT );
+  for( int set = 0; set < DOT_BOX_COUNT; ++set ) {
+    a[ set ].w = b[ set ].w = DOT_BOXES[ set ].w;
+    a[ set ].h = b[ set ].h = DOT_BOXES[ set ].h;
+  }
+  shift_boxes( b, 0, 0 );
+
+  for( int i = 0; i < 20000; ++i ) {
+    int x = offsets[ i * 2 ], y = offsets[ i * 2 + 1 ];
+    bool exact = pixel_reference( mask, x, y, mask, 0, 0 );
+
+    if( check_collision( mask, x, y, mask, 0, 0 ) != exact ) {
+      fprintf( stderr, "bitmask differs from pixel test at %d, %d\n", x, y );
+      return 1;
+    }
+
+    shift_boxes( a, x, y );
+    if( check_collision( a, b ) != exact ) {
+      ++boxMisses;
+    }
+  }
+
+  int boxHits = 0;
+  double start = now_ms();
+  for( int i = 0; i < count; ++i ) {
+    shift_boxes( a, offsets[ i * 2 ], offsets[ i * 2 + 1 ] );
+    boxHits += check_collision( a, b );
+  }
+  double boxMs = now_ms() - start;
+
+  int maskHits = 0;
+  start = now_ms();
+  for( int i = 0; i < count; ++i ) {
+    maskHits += check_collision( mask, offsets[ i * 2 ], offsets[ i * 2 + 1 ], mask, 0, 0 );
+  }
+  double maskMs = now_ms() - start;
+
+  printf( "%d tests of %s at offsets within +-%d\n", count, file, RANGE );
+  printf( "%8s %10s %10s\n", "path", "ns/test", "hits" );
+  printf( "%8s %10.2f %10d\n", "boxes", boxMs * 1e6 / count, boxHits );
+  printf( "%8s %10.2f %10d\n", "bitmask", maskMs * 1e6 / count, maskHits );
+  printf( "boxes disagree with pixels in %d of 20000 tests\n", boxMisses );
+
+  SDL_FreeSurface( layout );
+  SDL_FreeSurface( keyed );
+  SDL_FreeSurface( dot );
+
+  return 0;
+}
@@ -0,0 +1,119 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cmath>
+#include <vector>
+#include <utility>
+#include "../common/clock.h"
+#include "../common/spatialhash.h"
+#include "../common/collision.h"
+#include "../18/dot_boxes.h"
+
+// Sweeps the number of dots and compares brute force against the
+// spatial hash broad phase, both followed by the same narrow phase.
+
+const int DOT_WIDTH = 20;
+const int DOT_HEIGHT = 20;
+
+// Above this many dots brute force takes minutes, so it is skipped
+const int BRUTE_FORCE_LIMIT = 10000;
+
+// The generated boxes of the dot in 18, placed at x, y
+std::vector<SDL_Rect> dot_boxes( int x, int y ) {
+  std::vector<SDL_Rect> box( DOT_BOX_COUNT );
+
+  for( int set = 0; set < DOT_BOX_COUNT; ++set ) {
+    box[ set ].w = DOT_BOXES[ set ].w;
+    box[ set ].h = DOT_BOXES[ set ].h;
+    box[ set ].x = x + DOT_BOXES[ set ].x;
+    box[ set ].y = y + DOT_BOXES[ set ].y;
+  }
+
+  return box;
+}
+
+int brute_force( std::vector< std::vector<SDL_Rect> >& dots ) {
+  int hits = 0;
+
+  for( int a = 0; a < dots.size(); ++a ) {
+    for( int b = a + 1; b < dots.size(); ++b ) {
+      if( check_collision( dots[ a ], dots[ b ] ) ) {
+	++hits;
+      }
+    }
+  }
+
+  return hits;
+}
+
+int hashed( std::vector< std::vector<SDL_Rect> >& dots, SpatialHash& grid, int& candidates ) {
+  std::vector< std::pair<int, int> > pairs;
+  int hits = 0;
+
+  grid.clear();
+  for( int d = 0; d < dots.size(); ++d ) {
+    grid.insert( dots[ d ] );
+  }
+
+  grid.find_pairs( pairs );
+
+  for( int p = 0; p < pairs.size(); ++p ) {
+    if( check_collision( dots[ pairs[ p ].first ], dots[ pairs[ p ].second ] ) ) {
+      ++hits;
+    }
+  }
+
+  candidates = pairs.size();
+  return hits;
+}
+
+int main( int argc, char** argv )
+{
+  static const int counts[] = { 10, 100, 1000, 10000, 100000 };
+
+  srand( 1234 );
+
+  printf( "%8s %12s %12s %12s %10s %8s\n", "dots", "brute ms", "hash ms", "candidates", "hits", "match" );
+
+  for( int c = 0; c < sizeof( counts ) / sizeof( counts[ 0 ] ); ++c ) {
+    int n = counts[ c ];
+
+    // Keep the density constant: on average one dot per 60x60 pixels
+    int side = (int) sqrt( (double) n ) * 60;
+
+    std::vector< std::vector<SDL_Rect> > dots( n );
+    for( int d = 0; d < n; ++d ) {
+      dots[ d ] = dot_boxes( rand() % side, rand() % side );
+    }
+
+    SpatialHash grid( DOT_WIDTH * 2, n * 2 );
+    int candidates = 0;
+
+    // Several rounds for the small sizes so the timer has something to measure
+    int rounds = n <= 1000 ? 100 : 1;
+
+    double start = now_ms();
+    int hashHits = 0;
+    for( int r = 0; r < rounds; ++r ) {
+      hashHits = hashed( dots, grid, candidates );
+    }
+    double hashMs = ( now_ms() - start ) / rounds;
+
+    if( n <= BRUTE_FORCE_LIMIT ) {
+      start = now_ms();
+      int bruteHits = brute_force( dots );
+      double bruteMs = now_ms() - start;
+
+      printf( "%8d %12.3f %12.3f %12d %10d %8s\n", n, bruteMs, hashMs, candidates, hashHits,
+	      bruteHits == hashHits ? "yes" : "NO" );
+
+      if( bruteHits != hashHits ) {
+	return 1;
+      }
+    } else {
+      printf( "%8d %12s %12.3f %12d %10d %8s\n", n, "-", hashMs, candidates, hashHits, "-" );
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,151 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cmath>
+#include <vector>
+#include <utility>
+#include "../common/clock.h"
+#include "../common/circleset.h"
+
+// Batched circle tests, with each kernel, against the sqrt( pow() )
+// tests of 19. Results must match exactly; times are per circle test.
+
+const char* KERNEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+struct Circle {
+  int x, y;
+  int r;
+};
+
+// The original tests from 19/circlecollisiondetection.cpp
+double distance( int x1, int y1, int x2, int y2 )
+{
+  return sqrt( pow( x2 - x1, 2 ) + pow( y2 - y1, 2 ) );
+}
+
+bool check_collision( Circle& a, Circle& b )
+{
+  return distance( a.x, a.y, b.x, b.y ) < ( a.r + b.r );
+}
+
+bool check_collision( Circle& a, SDL_Rect& b )
+{
+  int cx, cy;
+
+  if( a.x < b.x ) {
+    cx = b.x;
+  } else if( a.x > b.x + b.w ) {
+    cx = b.x + b.w;
+  } else {
+    cx = a.x;
+  }
+
+  if( a.y < b.y ) {
+    cy = b.y;
+  } else if( a.y > b.y + b.h ) {
+    cy = b.y + b.h;
+  } else {
+    cy = a.y;
+  }
+
+  return distance( a.x, a.y, cx, cy ) < a.r;
+}
+
+int main( int argc, char** argv )
+{
+  const int side = 4000;
+  const int n = argc > 1 ? atoi( argv[ 1 ] ) : 4096;
+
+  srand( 1234 );
+
+  std::vector<Circle> circles( n );
+  std::vector<SDL_Rect> rects( n );
+  CircleSet circleSet;
+  RectSet rectSet;
+
+  for( int i = 0; i < n; ++i ) {
+    circles[ i ].x = rand() % side;
+    circles[ i ].y = rand() % side;
+    circles[ i ].r = 5 + rand() % 20;
+    circleSet.push_back( circles[ i ].x, circles[ i ].y, circles[ i ].r );
+
+    rects[ i ].x = rand() % side;
+    rects[ i ].y = rand() % side;
+    rects[ i ].w = rand() % 40;
+    rects[ i ].h = rand() % 40;
+  }
+  rectSet.assign( rects );
+
+  // Circle vs circles
+  double start = now_ms();
+  std::vector< std::pair<int, int> > expected;
+  for( int i = 0; i < n; ++i ) {
+    for( int j = i + 1; j < n; ++j ) {
+      if( check_collision( circles[ i ], circles[ j ] ) ) {
+	expected.push_back( std::make_pair( i, j ) );
+      }
+    }
+  }
+  double scalarMs = now_ms() - start;
+
+  double tests = (double) n * ( n - 1 ) / 2;
+  printf( "%14s %8s %10s %14s %8s\n", "test", "path", "ns/test", "tests/s", "hits" );
+  printf( "%14s %8s %10.3f %14.0f %8d\n", "circle/circle", "sqrt", scalarMs * 1e6 / tests, tests / scalarMs * 1e3, (int) expected.size() );
+
+  for( int k = RECTSET_SCALAR; k <= RECTSET_AVX2; ++k ) {
+    if( !rectset_supports( (RectSetKernel) k ) ) {
+      continue;
+    }
+    rectset_use_kernel( (RectSetKernel) k );
+
+    double start = now_ms();
+    std::vector< std::pair<int, int> > pairs;
+    find_overlaps( circleSet, circleSet, pairs, true );
+    double batchMs = now_ms() - start;
+
+    if( pairs != expected ) {
+      fprintf( stderr, "%s circle/circle results differ: %d != %d\n", KERNEL_NAMES[ k ], (int) pairs.size(), (int) expected.size() );
+      return 1;
+    }
+
+    printf( "%14s %8s %10.3f %14.0f %8d\n", "circle/circle", KERNEL_NAMES[ k ], batchMs * 1e6 / tests, tests / batchMs * 1e3, (int) pairs.size() );
+  }
+
+  // Circle vs rects
+  start = now_ms();
+  std::vector<int> expectedHits;
+  for( int i = 0; i < n; ++i ) {
+    for( int j = 0; j < n; ++j ) {
+      if( check_collision( circles[ i ], rects[ j ] ) ) {
+	expectedHits.push_back( j );
+      }
+    }
+  }
+  scalarMs = now_ms() - start;
+
+  tests = (double) n * n;
+  printf( "%14s %8s %10.3f %14.0f %8d\n", "circle/rect", "sqrt", scalarMs * 1e6 / tests, tests / scalarMs * 1e3, (int) expectedHits.size() );
+
+  for( int k = RECTSET_SCALAR; k <= RECTSET_AVX2; ++k ) {
+    if( !rectset_supports( (RectSetKernel) k ) ) {
+      continue;
+    }
+    rectset_use_kernel( (RectSetKernel) k );
+
+    double start = now_ms();
+    std::vector<int> hits;
+    for( int i = 0; i < n; ++i ) {
+      find_overlaps( circles[ i ].x, circles[ i ].y, circles[ i ].r, rectSet, hits );
+    }
+    double batchMs = now_ms() - start;
+
+    if( hits != expectedHits ) {
+      fprintf( stderr, "%s circle/rect results differ: %d != %d\n", KERNEL_NAMES[ k ], (int) hits.size(), (int) expectedHits.size() );
+      return 1;
+    }
+
+    printf( "%14s %8s %10.3f %14.0f %8d\n", "circle/rect", KERNEL_NAMES[ k ], batchMs * 1e6 / tests, tests / batchMs * 1e3, (int) hits.size() );
+  }
+
+  return 0;
+}
@@ -0,0 +1,195 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include "../common/clock.h"
+#include "../common/collision.h"
+#include "../common/swept.h"
+#include "../18/dot_boxes.h"
+
+// The plain collision tests of 17, 18 and 19 on their own, no window,
+// and the swept move 18's dots make with each. Each workload is a list of test pairs of which about density collide;
+// hits sit at random offsets inside, misses a few pixels outside. Every
+// size and density is timed and printed as JSON.
+//
+// usage: collision [-n pairs]... [-d density]...
+
+const int BOX_SIZE = 20;
+const int DOT_RADIUS = 10;
+const int DOT_STRIP = 5;
+const double MIN_MS = 50;
+
+bool chance( double density ) {
+  return rand() < density * ( (double) RAND_MAX + 1 );
+}
+
+// Offset that keeps a size wide thing touching (hit) or apart (miss)
+int offset( bool hit, int size ) {
+  if( hit ) {
+    return rand() % size - size / 2;
+  }
+  int gap = size + rand() % size;
+  return rand() % 2 ? gap : -gap;
+}
+
+std::vector<SDL_Rect> dot_boxes( int x, int y ) {
+  std::vector<SDL_Rect> boxes( DOT_BOX_COUNT );
+
+  for( int b = 0; b < DOT_BOX_COUNT; ++b ) {
+    boxes[ b ].x = x + DOT_BOXES[ b ].x;
+    boxes[ b ].y = y + DOT_BOXES[ b ].y;
+    boxes[ b ].w = DOT_BOXES[ b ].w;
+    boxes[ b ].h = DOT_BOXES[ b ].h;
+  }
+
+  return boxes;
+}
+
+SDL_Rect rect( int x, int y ) {
+  SDL_Rect r;
+  r.x = x;
+  r.y = y;
+  r.w = r.h = BOX_SIZE;
+  return r;
+}
+
+// Runs all the tests until MIN_MS have passed, returns ns per test
+template<class Test>
+double time_tests( int count, Test test, int& hits ) {
+  int rounds = 0;
+  double start = now_ms(), elapsed;
+
+  do {
+    hits = 0;
+    for( int t = 0; t < count; ++t ) {
+      hits += test( t );
+    }
+    ++rounds;
+    elapsed = now_ms() - start;
+  } while( elapsed < MIN_MS );
+
+  return elapsed * 1e6 / ( (double) rounds * count );
+}
+
+void report( bool& first, const char* workload, int count, double density, int hits, double ns ) {
+  printf( "%s    { \"workload\": \"%s\", \"pairs\": %d, \"density\": %.3f, \"hit_rate\": %.3f, \"ns_per_test\": %.3f, \"tests_per_s\": %.0f }",
+	  first ? "" : ",\n", workload, count, density, (double) hits / count, ns, 1e9 / ns );
+  first = false;
+}
+
+int main( int argc, char** argv )
+{
+  std::vector<int> sizes;
+  std::vector<double> densities;
+
+  for( int a = 1; a + 1 < argc; a += 2 ) {
+    if( strcmp( argv[ a ], "-n" ) == 0 ) {
+      sizes.push_back( atoi( argv[ a + 1 ] ) );
+    } else if( strcmp( argv[ a ], "-d" ) == 0 ) {
+      densities.push_back( atof( argv[ a + 1 ] ) );
+    } else {
+      fprintf( stderr, "usage: %s [-n pairs]... [-d density]...\n", argv[ 0 ] );
+      return 1;
+    }
+  }
+  if( sizes.empty() ) {
+    sizes.push_back( 1000 );
+    sizes.push_back( 100000 );
+  }
+  if( densities.empty() ) {
+    densities.push_back( 0.1 );
+    densities.push_back( 0.5 );
+    densities.push_back( 0.9 );
+  }
+
+  srand( 1234 );
+
+  bool first = true;
+  printf( "{\n  \"benchmark\": \"collision\",\n  \"results\": [\n" );
+
+  for( int s = 0; s < sizes.size(); ++s ) {
+    for( int d = 0; d < densities.size(); ++d ) {
+      int n = sizes[ s ];
+      double density = densities[ d ];
+      int hits;
+      double ns;
+
+      // 17: rect against rect
+      std::vector<SDL_Rect> as( n ), bs( n );
+      for( int t = 0; t < n; ++t ) {
+	bool hit = chance( density );
+	as[ t ] = rect( 1000, 1000 );
+	bs[ t ] = rect( 1000 + offset( hit, BOX_SIZE ), 1000 + offset( true, BOX_SIZE ) );
+      }
+      ns = time_tests( n, [&]( int t ) { return check_collision( as[ t ], bs[ t ] ); }, hits );
+      report( first, "rect/rect", n, density, hits, ns );
+
+      // 18: dot box set against dot box set
+      std::vector< std::vector<SDL_Rect> > setA( n ), setB( n );
+      for( int t = 0; t < n; ++t ) {
+	bool hit = chance( density );
+	setA[ t ] = dot_boxes( 1000, 1000 );
+	setB[ t ] = dot_boxes( 1000 + offset( hit, 2 * DOT_RADIUS ), 1000 + offset( true, 2 * DOT_RADIUS ) );
+      }
+      ns = time_tests( n, [&]( int t ) { return check_collision( setA[ t ], setB[ t ] ); }, hits );
+      report( first, "rectset/rectset", n, density, hits, ns );
+
+      // 18 with the outer box and strip hierarchy, same placements
+      BoxShape dot( dot_boxes( 0, 0 ), DOT_STRIP );
+      std::vector<int> dotX( n ), dotY( n );
+      for( int t = 0; t < n; ++t ) {
+	dotX[ t ] = setB[ t ][ 0 ].x - DOT_BOXES[ 0 ].x;
+	dotY[ t ] = setB[ t ][ 0 ].y - DOT_BOXES[ 0 ].y;
+      }
+      ns = time_tests( n, [&]( int t ) { return check_collision( dot, 1000, 1000, dot, dotX[ t ], dotY[ t ] ); }, hits );
+      report( first, "shape/shape", n, density, hits, ns );
+
+      // 18's move: the dot sweeps a quarter of the way to the other one,
+      // against its boxes in world space, then against the shape and its
+      // hierarchy
+      std::vector<SDL_Rect> noWalls;
+      std::vector< std::vector<PlacedShape> > others( n, std::vector<PlacedShape>( 1 ) );
+      for( int t = 0; t < n; ++t ) {
+	PlacedShape other = { &dot, dotX[ t ], dotY[ t ] };
+	others[ t ][ 0 ] = other;
+      }
+      ns = time_tests( n, [&]( int t ) {
+	  int x = 1000, y = 1000;
+	  return move_and_slide( dot.get_boxes(), x, y, ( dotX[ t ] - 1000 ) / 4, ( dotY[ t ] - 1000 ) / 4, setB[ t ] );
+	}, hits );
+      report( first, "move/rectset", n, density, hits, ns );
+      ns = time_tests( n, [&]( int t ) {
+	  int x = 1000, y = 1000;
+	  return move_and_slide( dot, x, y, ( dotX[ t ] - 1000 ) / 4, ( dotY[ t ] - 1000 ) / 4, others[ t ], noWalls );
+	}, hits );
+      report( first, "move/shape", n, density, hits, ns );
+
+      // 19: circle against a box
+      std::vector<Circle> circles( n );
+      std::vector< std::vector<SDL_Rect> > walls( n );
+      for( int t = 0; t < n; ++t ) {
+	bool hit = chance( density );
+	walls[ t ].push_back( rect( 1000, 1000 ) );
+	circles[ t ].x = 1000 + BOX_SIZE / 2 + offset( hit, BOX_SIZE );
+	circles[ t ].y = 1000 + BOX_SIZE / 2 + offset( true, BOX_SIZE );
+	circles[ t ].r = DOT_RADIUS;
+      }
+      ns = time_tests( n, [&]( int t ) { return check_collision( circles[ t ], walls[ t ] ); }, hits );
+      report( first, "circle/rect", n, density, hits, ns );
+
+      // 19 against a dot shape, circles placed around it like the walls
+      for( int t = 0; t < n; ++t ) {
+	bool hit = chance( density );
+	circles[ t ].x = 1000 + DOT_RADIUS + offset( hit, 2 * DOT_RADIUS );
+	circles[ t ].y = 1000 + DOT_RADIUS + offset( true, DOT_RADIUS );
+      }
+      ns = time_tests( n, [&]( int t ) { return check_collision( circles[ t ], dot, 1000, 1000 ); }, hits );
+      report( first, "circle/shape", n, density, hits, ns );
+    }
+  }
+
+  printf( "\n  ]\n}\n" );
+
+  return 0;
+}
@@ -0,0 +1,205 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include "../common/clock.h"
+#include "../common/spansprite.h"
+
+// Checks colorkey_blit() with every kernel, and span_blit() on the span
+// encoded sprite, pixel for pixel against SDL_BlitSurface, clipping
+// included, then times sprites per second for each on sprites the size of
+// 18's dot, 06's dots and 09's button.
+
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int BLITS = 20000;
+
+const char* KERNEL_NAMES[] = { "sdl", "scalar", "sse4.1", "avx2" };
+
+typedef int (*BlitFunc)( SDL_Surface*, SDL_Rect*, SDL_Surface*, SDL_Rect* );
+
+SDL_Surface* make_surface( int w, int h ) {
+  return SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, 0xFF0000, 0xFF00, 0xFF, 0 );
+}
+
+// A round blob of random colors on the colorkey, like dot.png
+SDL_Surface* make_sprite( int w, int h ) {
+  SDL_Surface* sprite = make_surface( w, h );
+  Uint32 colorkey = SDL_MapRGB( sprite->format, 200, 191, 231 );
+
+  SDL_FillRect( sprite, NULL, colorkey );
+  for( int y = 0; y < h; ++y ) {
+    Uint32* row = (Uint32*) ( (Uint8*) sprite->pixels + y * sprite->pitch );
+
+    for( int x = 0; x < w; ++x ) {
+      long dx = ( 2 * x + 1 - w ) * (long) h, dy = ( 2 * y + 1 - h ) * (long) w;
+
+      if( dx * dx + dy * dy < (long) w * h * w * h ) {
+	row[ x ] = SDL_MapRGB( sprite->format, rand() % 256, rand() % 256, rand() % 256 );
+      }
+    }
+  }
+  SDL_SetColorKey( sprite, SDL_SRCCOLORKEY, colorkey );
+
+  return sprite;
+}
+
+void fill_random( SDL_Surface* surface ) {
+  for( int y = 0; y < surface->h; ++y ) {
+    Uint32* row = (Uint32*) ( (Uint8*) surface->pixels + y * surface->pitch );
+
+    for( int x = 0; x < surface->w; ++x ) {
+      row[ x ] = SDL_MapRGB( surface->format, rand() % 256, rand() % 256, rand() % 256 );
+    }
+  }
+}
+
+bool same_pixels( SDL_Surface* a, SDL_Surface* b ) {
+  for( int y = 0; y < a->h; ++y ) {
+    if( memcmp( (Uint8*) a->pixels + y * a->pitch, (Uint8*) b->pixels + y * b->pitch, a->w * 4 ) != 0 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Where an empty blit leaves x and y is not part of the contract
+bool same_rect( const SDL_Rect& a, const SDL_Rect& b ) {
+  if( a.w * a.h == 0 && b.w * b.h == 0 ) {
+    return true;
+  }
+  return a.x == b.x && a.y == b.y && a.w == b.w && a.h == b.h;
+}
+
+// Random blits of sprite, source rects and positions partly outside their
+// surfaces and sometimes a screen clip rect, through kernel and through
+// SDL; screens and returned rects must match
+bool verify( const char* name, BlitFunc blit, SDL_Surface* sprite, SDL_Surface* screen, SDL_Surface* reference ) {
+  fill_random( screen );
+  SDL_BlitSurface( screen, NULL, reference, NULL );
+
+  for( int b = 0; b < 2000; ++b ) {
+    SDL_Rect from, to, expected;
+
+    from.x = rand() % ( sprite->w + 20 ) - 10;
+    from.y = rand() % ( sprite->h + 20 ) - 10;
+    from.w = rand() % ( sprite->w + 10 );
+    from.h = rand() % ( sprite->h + 10 );
+    to.x = rand() % ( SCREEN_WIDTH + sprite->w ) - sprite->w;
+    to.y = rand() % ( SCREEN_HEIGHT + sprite->h ) - sprite->h;
+    to.w = to.h = 0;
+    expected = to;
+
+    if( b % 4 == 0 ) {
+      SDL_Rect clip;
+      clip.x = rand() % SCREEN_WIDTH;
+      clip.y = rand() % SCREEN_HEIGHT;
+      clip.w = rand() % SCREEN_WIDTH;
+      clip.h = rand() % SCREEN_HEIGHT;
+      SDL_SetClipRect( screen, &clip );
+      SDL_SetClipRect( reference, &clip );
+    } else if( b % 4 == 1 ) {
+      SDL_SetClipRect( screen, NULL );
+      SDL_SetClipRect( reference, NULL );
+    }
+
+    SDL_Rect* source = b % 8 == 7 ? NULL : &from;
+    SDL_Rect referenceFrom = from;
+    blit( sprite, source, screen, &to );
+    SDL_BlitSurface( sprite, source ? &referenceFrom : NULL, reference, &expected );
+
+    if( !same_rect( to, expected ) ) {
+      fprintf( stderr, "%s drew (%d,%d %dx%d) instead of (%d,%d %dx%d)\n", name,
+	       to.x, to.y, to.w, to.h, expected.x, expected.y, expected.w, expected.h );
+      return false;
+    }
+  }
+
+  SDL_SetClipRect( screen, NULL );
+  SDL_SetClipRect( reference, NULL );
+
+  if( !same_pixels( screen, reference ) ) {
+    fprintf( stderr, "%s pixels differ from SDL_BlitSurface\n", name );
+    return false;
+  }
+
+  return true;
+}
+
+// Sprites per second for whole sprites at random places on screen
+double sprites_per_s( BlitFunc blit, SDL_Surface* sprite, SDL_Surface* screen, const SDL_Rect* places ) {
+  double start = now_ms();
+  for( int b = 0; b < BLITS; ++b ) {
+    SDL_Rect to = places[ b ];
+    blit( sprite, NULL, screen, &to );
+  }
+
+  return BLITS / ( ( now_ms() - start ) / 1000.0 );
+}
+
+int main( int argc, char** argv )
+{
+  static const int sizes[][ 2 ] = { { 20, 20 }, { 100, 100 }, { 320, 240 } };
+
+  srand( 1234 );
+
+  SDL_Surface* screen = make_surface( SCREEN_WIDTH, SCREEN_HEIGHT );
+  SDL_Surface* reference = make_surface( SCREEN_WIDTH, SCREEN_HEIGHT );
+  SDL_Rect* places = new SDL_Rect[ BLITS ];
+
+  printf( "%10s", "sprite" );
+  for( int k = COLORKEY_SDL; k <= COLORKEY_AVX2; ++k ) {
+    printf( " %14s", KERNEL_NAMES[ k ] );
+  }
+  printf( " %14s %8s %8s\n", "spans", "runs", "match" );
+
+  for( int s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); ++s ) {
+    int w = sizes[ s ][ 0 ], h = sizes[ s ][ 1 ];
+    SDL_Surface* sprite = make_sprite( w, h );
+    bool match = true;
+
+    for( int k = COLORKEY_SCALAR; k <= COLORKEY_AVX2; ++k ) {
+      if( colorkey_supports( (ColorKeyKernel) k ) ) {
+	colorkey_use_kernel( (ColorKeyKernel) k );
+	match = match && verify( KERNEL_NAMES[ k ], colorkey_blit, sprite, screen, reference );
+      }
+    }
+
+    // Only span_blit looks at the encoding
+    span_encode( sprite );
+    match = match && verify( "spans", span_blit, sprite, screen, reference );
+
+    for( int b = 0; b < BLITS; ++b ) {
+      places[ b ].x = rand() % ( SCREEN_WIDTH - w + 1 );
+      places[ b ].y = rand() % ( SCREEN_HEIGHT - h + 1 );
+    }
+
+    char name[ 32 ];
+    snprintf( name, sizeof( name ), "%dx%d", w, h );
+    printf( "%10s", name );
+
+    for( int k = COLORKEY_SDL; k <= COLORKEY_AVX2; ++k ) {
+      if( colorkey_supports( (ColorKeyKernel) k ) ) {
+	colorkey_use_kernel( (ColorKeyKernel) k );
+	printf( " %14.0f", sprites_per_s( colorkey_blit, sprite, screen, places ) );
+      } else {
+	printf( " %14s", "-" );
+      }
+    }
+    printf( " %14.0f", sprites_per_s( span_blit, sprite, screen, places ) );
+    printf( " %8d %8s\n", span_sprites()[ sprite ]->get_span_count(), match ? "yes" : "NO" );
+
+    span_release( sprite );
+    SDL_FreeSurface( sprite );
+
+    if( !match ) {
+      return 1;
+    }
+  }
+
+  delete[] places;
+  SDL_FreeSurface( reference );
+  SDL_FreeSurface( screen );
+
+  return 0;
+}
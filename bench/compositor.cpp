@@ -0,0 +1,148 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+#include "../common/clock.h"
+#include "../common/compositor.h"
+
+// Composites a sprite dense frame (a tiled background, many colorkeyed
+// dots, a few opaque panels) with the band compositor on 1 to N threads
+// at several screen sizes. Every run must match, pixel for pixel, the
+// frame drawn by RenderQueue::execute() on one thread.
+
+const int TILE = 64;
+const int DOT = 20;
+const int FRAMES = 20;
+
+// Dots per 640x480 worth of screen
+const int DOTS_PER_SCREEN = 4000;
+
+const int LAYER_BACKGROUND = 0;
+const int LAYER_DOTS = 1;
+const int LAYER_PANELS = 2;
+
+SDL_Surface* make_surface( int w, int h ) {
+  return SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, 0xFF0000, 0xFF00, 0xFF, 0 );
+}
+
+// A round dot in color on the colorkey, like dot.png
+SDL_Surface* make_dot( Uint8 r, Uint8 g, Uint8 b ) {
+  SDL_Surface* dot = make_surface( DOT, DOT );
+  Uint32 colorkey = SDL_MapRGB( dot->format, 200, 191, 231 );
+
+  SDL_FillRect( dot, NULL, colorkey );
+  for( int y = 0; y < DOT; ++y ) {
+    for( int x = 0; x < DOT; ++x ) {
+      int dx = 2 * x + 1 - DOT, dy = 2 * y + 1 - DOT;
+      if( dx * dx + dy * dy < DOT * DOT ) {
+	( (Uint32*) ( (Uint8*) dot->pixels + y * dot->pitch ) )[ x ] = SDL_MapRGB( dot->format, r, g, b );
+      }
+    }
+  }
+  SDL_SetColorKey( dot, SDL_SRCCOLORKEY, colorkey );
+
+  return dot;
+}
+
+bool same_pixels( SDL_Surface* a, SDL_Surface* b ) {
+  for( int y = 0; y < a->h; ++y ) {
+    if( memcmp( (Uint8*) a->pixels + y * a->pitch, (Uint8*) b->pixels + y * b->pitch, a->w * 4 ) != 0 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// One frame of the scene, recorded once and replayed for every run
+std::vector<RenderCommand> record( int w, int h, SDL_Surface* tile, SDL_Surface** dots, Uint32 panelColor ) {
+  RenderQueue queue( w, h );
+  int n = (long) DOTS_PER_SCREEN * w * h / ( 640 * 480 );
+
+  for( int y = 0; y < h; y += TILE ) {
+    for( int x = 0; x < w; x += TILE ) {
+      queue.blit( LAYER_BACKGROUND, x, y, tile );
+    }
+  }
+  for( int d = 0; d < n; ++d ) {
+    queue.blit( LAYER_DOTS, rand() % ( w + DOT ) - DOT, rand() % ( h + DOT ) - DOT, dots[ rand() % 4 ] );
+  }
+  for( int p = 0; p < 4; ++p ) {
+    SDL_Rect panel;
+    panel.x = rand() % w;
+    panel.y = rand() % h;
+    panel.w = w / 5;
+    panel.h = h / 5;
+    queue.fill( LAYER_PANELS, panel, panelColor );
+  }
+
+  return queue.get_commands();
+}
+
+int main( int argc, char** argv )
+{
+  static const int sizes[][ 2 ] = { { 640, 480 }, { 1280, 960 }, { 1920, 1080 } };
+  int cores = std::thread::hardware_concurrency();
+
+  srand( 1234 );
+
+  SDL_Surface* tile = make_surface( TILE, TILE );
+  SDL_Surface* dots[ 4 ] = { make_dot( 255, 0, 0 ), make_dot( 0, 255, 0 ), make_dot( 0, 0, 255 ), make_dot( 255, 255, 255 ) };
+
+  SDL_FillRect( tile, NULL, SDL_MapRGB( tile->format, 40, 40, 60 ) );
+  for( int d = 0; d < 4; ++d ) {
+    span_encode( dots[ d ] );
+  }
+
+  printf( "%10s %8s %8s %6s %10s %8s %8s\n", "screen", "commands", "threads", "bands", "ms", "speedup", "match" );
+
+  for( int s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); ++s ) {
+    int w = sizes[ s ][ 0 ], h = sizes[ s ][ 1 ];
+    SDL_Surface* screen = make_surface( w, h );
+    SDL_Surface* reference = make_surface( w, h );
+    Uint32 clearColor = SDL_MapRGB( screen->format, 0, 0, 0 );
+    std::vector<RenderCommand> frame = record( w, h, tile, dots, SDL_MapRGB( screen->format, 90, 90, 90 ) );
+    RenderQueue queue( w, h );
+    double baseMs = 0;
+
+    queue.replay( frame );
+    SDL_FillRect( reference, NULL, clearColor );
+    queue.execute( reference );
+
+    char name[ 32 ];
+    snprintf( name, sizeof( name ), "%dx%d", w, h );
+
+    for( int threads = 1; threads <= ( cores > 8 ? cores : 8 ); threads *= 2 ) {
+      ThreadPool pool( threads );
+      BandCompositor compositor( pool );
+
+      // Leftovers from the last run must not hide a band left undrawn
+      SDL_FillRect( screen, NULL, SDL_MapRGB( screen->format, 255, 0, 255 ) );
+      queue.replay( frame );
+      compositor.execute( queue, screen, clearColor );
+      bool match = same_pixels( screen, reference ) && compositor.get_serial_frames() == 0;
+
+      double start = now_ms();
+      for( int f = 0; f < FRAMES; ++f ) {
+	queue.replay( frame );
+	compositor.execute( queue, screen, clearColor );
+      }
+      double ms = ( now_ms() - start ) / FRAMES;
+      if( threads == 1 ) {
+	baseMs = ms;
+      }
+
+      printf( "%10s %8d %8d %6d %10.3f %8.2f %8s\n", name, (int) frame.size(), threads, compositor.get_bands(), ms, baseMs / ms, match ? "yes" : "NO" );
+
+      if( !match ) {
+	return 1;
+      }
+    }
+
+    SDL_FreeSurface( reference );
+    SDL_FreeSurface( screen );
+  }
+
+  return 0;
+}
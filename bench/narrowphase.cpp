@@ -0,0 +1,175 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <thread>
+#include "../common/clock.h"
+#include "../common/spatialhash.h"
+#include "../common/narrowphase.h"
+#include "../common/collision.h"
+#include "../18/dot_boxes.h"
+
+// Narrow phase over spatial hash candidates on 1 to N threads.
+// Two workloads: the per pixel box sets of 18 against each other, and
+// the circles of 19 against box walls. Every threaded run must give the
+// very same hit list, in the same order, as the single threaded loop.
+// First the pool itself is run many times back to back with tiny loops,
+// where a worker waking late from one run could meet the next one.
+
+const int DOT_SIZE = 20;
+const int ROUNDS = 20;
+const int STRESS_RUNS = 20000;
+
+template<class Test>
+void single_threaded( const std::vector< std::pair<int, int> >& candidates, Test test, std::vector< std::pair<int, int> >& hits ) {
+  for( int c = 0; c < candidates.size(); ++c ) {
+    if( test( candidates[ c ].first, candidates[ c ].second ) ) {
+      hits.push_back( candidates[ c ] );
+    }
+  }
+}
+
+// Many small run() calls in a row on 8 workers, each must cover every
+// index exactly once
+bool stress() {
+  ThreadPool pool( 8 );
+  std::vector<int> counts( 64 );
+
+  double start = now_ms();
+  for( int r = 0; r < STRESS_RUNS; ++r ) {
+    pool.run( counts.size(), 4, [&]( int begin, int end, int worker ) {
+	for( int i = begin; i < end; ++i ) {
+	  ++counts[ i ];
+	}
+      } );
+  }
+  double ms = now_ms() - start;
+
+  bool match = true;
+  for( int i = 0; i < counts.size(); ++i ) {
+    match = match && counts[ i ] == STRESS_RUNS;
+  }
+  printf( "stress: %d runs of %d on %d threads, %.3f ms per run, %s\n\n", STRESS_RUNS, (int) counts.size(), pool.size(),
+	  ms / STRESS_RUNS, match ? "yes" : "NO" );
+
+  return match;
+}
+
+// Times the single threaded loop, then the pool at each thread count
+template<class Test>
+bool run( const char* name, const std::vector< std::pair<int, int> >& candidates, Test test ) {
+  std::vector< std::pair<int, int> > reference, hits;
+
+  double start = now_ms();
+  for( int r = 0; r < ROUNDS; ++r ) {
+    reference.clear();
+    single_threaded( candidates, test, reference );
+  }
+  double baseMs = ( now_ms() - start ) / ROUNDS;
+
+  printf( "%-10s %10d %10d %8s %10.3f %8s %8s\n", name, (int) candidates.size(), (int) reference.size(), "loop", baseMs, "1.00", "yes" );
+
+  int cores = std::thread::hardware_concurrency();
+  for( int threads = 1; threads <= ( cores > 8 ? cores : 8 ); threads *= 2 ) {
+    ThreadPool pool( threads );
+
+    start = now_ms();
+    for( int r = 0; r < ROUNDS; ++r ) {
+      hits.clear();
+      find_collisions( pool, candidates, test, hits );
+    }
+    double ms = ( now_ms() - start ) / ROUNDS;
+    bool match = hits == reference;
+
+    printf( "%-10s %10d %10d %8d %10.3f %8.2f %8s\n", name, (int) candidates.size(), (int) hits.size(), threads, ms, baseMs / ms, match ? "yes" : "NO" );
+
+    if( !match ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main( int argc, char** argv )
+{
+  const int n = 40000;
+  const int world = 12 * (int) sqrt( (double) n );
+
+  srand( 1234 );
+
+  if( !stress() ) {
+    return 1;
+  }
+
+  printf( "%-10s %10s %10s %8s %10s %8s %8s\n", "workload", "candidates", "hits", "threads", "ms", "speedup", "match" );
+
+  // Dense dots so most hash candidates reach the box set test
+  std::vector< std::vector<SDL_Rect> > dots( n );
+  SpatialHash grid( 2 * DOT_SIZE, 1 << 16 );
+
+  for( int d = 0; d < n; ++d ) {
+    int x = rand() % world, y = rand() % world;
+
+    for( int b = 0; b < DOT_BOX_COUNT; ++b ) {
+      SDL_Rect r;
+      r.x = x + DOT_BOXES[ b ].x;
+      r.y = y + DOT_BOXES[ b ].y;
+      r.w = DOT_BOXES[ b ].w;
+      r.h = DOT_BOXES[ b ].h;
+      dots[ d ].push_back( r );
+    }
+    grid.insert( dots[ d ] );
+  }
+
+  std::vector< std::pair<int, int> > candidates;
+  grid.find_pairs( candidates );
+
+  bool ok = run( "box sets", candidates, [&]( int a, int b ) { return check_collision( dots[ a ], dots[ b ] ); } );
+
+  // Circles against walls, walls go in the hash after the circles
+  const int walls = 4000;
+  std::vector< std::vector<SDL_Rect> > rects;
+  std::vector<Circle> circles( n );
+  int radius = DOT_SIZE / 2;
+
+  grid.clear();
+  for( int c = 0; c < n; ++c ) {
+    circles[ c ].x = rand() % world;
+    circles[ c ].y = rand() % world;
+    circles[ c ].r = radius;
+
+    std::vector<SDL_Rect> bounds( 1 );
+    bounds[ 0 ].x = circles[ c ].x - radius;
+    bounds[ 0 ].y = circles[ c ].y - radius;
+    bounds[ 0 ].w = bounds[ 0 ].h = 2 * radius;
+    grid.insert( bounds );
+  }
+  for( int w = 0; w < walls; ++w ) {
+    std::vector<SDL_Rect> wall( 1 );
+    bool vertical = rand() % 2;
+    wall[ 0 ].x = rand() % world;
+    wall[ 0 ].y = rand() % world;
+    wall[ 0 ].w = vertical ? 20 : 60 + rand() % 200;
+    wall[ 0 ].h = vertical ? 60 + rand() % 200 : 20;
+    rects.push_back( wall );
+    grid.insert( wall );
+  }
+
+  std::vector< std::pair<int, int> > all;
+  grid.find_pairs( all );
+  candidates.clear();
+  for( int p = 0; p < all.size(); ++p ) {
+    int a = all[ p ].first, b = all[ p ].second;
+
+    if( ( a < n ) != ( b < n ) ) {
+      candidates.push_back( a < n ? std::make_pair( a, b - n ) : std::make_pair( b, a - n ) );
+    }
+  }
+
+  ok = ok && run( "circ/rect", candidates, [&]( int c, int w ) { return check_collision( circles[ c ], rects[ w ] ); } );
+
+  return ok ? 0 : 1;
+}
@@ -0,0 +1,146 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <SDL/SDL_ttf.h>
+#include <SDL/SDL_mixer.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <thread>
+#include "../common/clock.h"
+#include "../common/assetloader.h"
+
+// Time to first frame of the examples' assets (every image, sound and
+// font of 03 to 16) loaded with AssetLoader on 1 to N threads; 1 is how
+// the examples loaded them, one after another. Each run must give the
+// same pixels and samples as the one thread run.
+
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int RUNS = 5;
+
+bool same_pixels( SDL_Surface* a, SDL_Surface* b ) {
+  if( a->w != b->w || a->h != b->h ) {
+    return false;
+  }
+  for( int y = 0; y < a->h; ++y ) {
+    if( memcmp( (Uint8*) a->pixels + y * a->pitch, (Uint8*) b->pixels + y * b->pitch, a->w * a->format->BytesPerPixel ) != 0 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+struct Batch {
+  std::vector<ImageHandle> images;
+  std::vector<SoundHandle> sounds;
+  std::vector<MusicHandle> music;
+  std::vector<FontHandle> fonts;
+};
+
+Batch queue_all( AssetLoader& loader ) {
+  static const char* images[] = {
+    "../03/background.png", "../03/message.png", "../04/image.png", "../05/background.png", "../05/dude.png",
+    "../06/dots.png", "../07/background.png", "../08/background.png", "../09/button.png", "../11/background.png",
+    "../16/dot.png", "../18/dot.png", "../19/dot.png"
+  };
+  static const char* sounds[] = { "../11/scratch.wav", "../11/high.wav", "../11/med.wav", "../11/low.wav" };
+  Batch batch;
+
+  for( int i = 0; i < sizeof( images ) / sizeof( images[ 0 ] ); ++i ) {
+    batch.images.push_back( loader.image( images[ i ] ) );
+  }
+  for( int s = 0; s < sizeof( sounds ) / sizeof( sounds[ 0 ] ); ++s ) {
+    batch.sounds.push_back( loader.sound( sounds[ s ] ) );
+  }
+  batch.music.push_back( loader.music( "../11/music.wav" ) );
+  batch.fonts.push_back( loader.font( "../16/DejaVuSans.ttf", 27 ) );
+
+  return batch;
+}
+
+void free_all( AssetLoader& loader, const Batch& batch ) {
+  for( int i = 0; i < batch.images.size(); ++i ) {
+    free_blob( loader.get( batch.images[ i ] ) );
+  }
+  for( int s = 0; s < batch.sounds.size(); ++s ) {
+    Mix_FreeChunk( loader.get( batch.sounds[ s ] ) );
+  }
+  for( int m = 0; m < batch.music.size(); ++m ) {
+    Mix_FreeMusic( loader.get( batch.music[ m ] ) );
+  }
+  for( int f = 0; f < batch.fonts.size(); ++f ) {
+    TTF_CloseFont( loader.get( batch.fonts[ f ] ) );
+  }
+}
+
+int main( int argc, char** argv )
+{
+  int cores = std::thread::hardware_concurrency();
+
+  setenv( "SDL_VIDEODRIVER", "dummy", 1 );
+  setenv( "SDL_AUDIODRIVER", "dummy", 1 );
+  if( SDL_Init( SDL_INIT_VIDEO | SDL_INIT_AUDIO ) < 0 || SDL_SetVideoMode( SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_SWSURFACE ) == NULL ||
+      TTF_Init() < 0 || Mix_OpenAudio( 22050, MIX_DEFAULT_FORMAT, 2, 4096 ) < 0 ) {
+    fprintf( stderr, "Error setting up SDL: %s\n", SDL_GetError() );
+    return 1;
+  }
+
+  // One thread, as the examples used to load, gives the reference
+  AssetLoader reference;
+  Batch expected = queue_all( reference );
+  if( !reference.load( 1 ) ) {
+    fprintf( stderr, "Error loading %s\n", reference.get_failed().c_str() );
+    return 1;
+  }
+
+  printf( "%8s %8s %12s %12s %12s %8s %8s\n", "threads", "assets", "ms", "decode ms", "finish ms", "speedup", "match" );
+
+  double baseMs = 0;
+  bool allMatch = true;
+
+  for( int threads = 1; threads <= ( cores > 8 ? cores : 8 ); threads *= 2 ) {
+    double ms = 0, decodeMs = 0, finishMs = 0;
+    bool match = true;
+    int assets = 0;
+
+    for( int r = 0; r < RUNS; ++r ) {
+      AssetLoader loader;
+      Batch batch = queue_all( loader );
+
+      double start = now_ms();
+      match = loader.load( threads ) && match;
+      ms += now_ms() - start;
+      decodeMs += loader.get_decode_ms();
+      finishMs += loader.get_finish_ms();
+
+      for( int i = 0; i < batch.images.size() && match; ++i ) {
+	match = same_pixels( loader.get( batch.images[ i ] ), reference.get( expected.images[ i ] ) );
+      }
+      for( int s = 0; s < batch.sounds.size() && match; ++s ) {
+	Mix_Chunk* chunk = loader.get( batch.sounds[ s ] );
+	Mix_Chunk* want = reference.get( expected.sounds[ s ] );
+	match = chunk->alen == want->alen && memcmp( chunk->abuf, want->abuf, chunk->alen ) == 0;
+      }
+
+      assets = batch.images.size() + batch.sounds.size() + batch.music.size() + batch.fonts.size();
+      free_all( loader, batch );
+    }
+
+    ms /= RUNS;
+    if( threads == 1 ) {
+      baseMs = ms;
+    }
+
+    printf( "%8d %8d %12.3f %12.3f %12.3f %8.2f %8s\n", threads, assets, ms, decodeMs / RUNS, finishMs / RUNS, baseMs / ms, match ? "yes" : "NO" );
+    allMatch = allMatch && match;
+  }
+
+  free_all( reference, expected );
+  Mix_CloseAudio();
+  TTF_Quit();
+  SDL_Quit();
+
+  return allMatch ? 0 : 1;
+}
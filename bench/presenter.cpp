@@ -0,0 +1,194 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <thread>
+#include "../common/clock.h"
+#include "../common/presenter.h"
+#include "../common/dirtyrects.h"
+#include "../common/rendercommands.h"
+
+// Runs the same frames, input then simulation then drawing then the
+// present, all in line through dirty rects like 16 to 19, and with the
+// drawing pipelined on a draw thread with 2 to PRESENTER_MAX_DEPTH
+// buffers. Prints throughput and latency from reading the input to the
+// end of the present for each buffer depth. The last frame on screen
+// must be the same every time.
+
+const int SCREEN_WIDTH = 1920;
+const int SCREEN_HEIGHT = 1080;
+const int DOT = 20;
+const int DOTS = 2000;
+const int FRAMES = 200;
+
+// Stand in for move() and collision tests of a busy scene
+const double SIMULATE_MS = 2.0;
+
+SDL_Surface* make_surface( int w, int h ) {
+  return SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, 0xFF0000, 0xFF00, 0xFF, 0 );
+}
+
+// A round dot in color on the colorkey, like dot.png
+SDL_Surface* make_dot() {
+  SDL_Surface* dot = make_surface( DOT, DOT );
+  Uint32 colorkey = SDL_MapRGB( dot->format, 200, 191, 231 );
+
+  SDL_FillRect( dot, NULL, colorkey );
+  for( int y = 0; y < DOT; ++y ) {
+    for( int x = 0; x < DOT; ++x ) {
+      int dx = 2 * x + 1 - DOT, dy = 2 * y + 1 - DOT;
+      if( dx * dx + dy * dy < DOT * DOT ) {
+	( (Uint32*) ( (Uint8*) dot->pixels + y * dot->pitch ) )[ x ] = SDL_MapRGB( dot->format, 255, 255, 255 );
+      }
+    }
+  }
+  SDL_SetColorKey( dot, SDL_SRCCOLORKEY, colorkey );
+
+  return dot;
+}
+
+struct Scene {
+  std::vector<SDL_Rect> dots;
+  std::vector<SDL_Rect> velocities;
+  SDL_Surface* dot;
+  RenderQueue queue;
+
+  Scene() : queue( SCREEN_WIDTH, SCREEN_HEIGHT ) {
+    dot = make_dot();
+    span_encode( dot );
+    srand( 1234 );
+
+    for( int d = 0; d < DOTS; ++d ) {
+      SDL_Rect p, v;
+      p.x = rand() % ( SCREEN_WIDTH - DOT );
+      p.y = rand() % ( SCREEN_HEIGHT - DOT );
+      v.x = rand() % 7 - 3;
+      v.y = rand() % 7 - 3;
+      dots.push_back( p );
+      velocities.push_back( v );
+    }
+  }
+
+  void simulate() {
+    double start = now_ms();
+    while( now_ms() - start < SIMULATE_MS ) {
+    }
+
+    for( int d = 0; d < dots.size(); ++d ) {
+      dots[ d ].x += velocities[ d ].x;
+      dots[ d ].y += velocities[ d ].y;
+      if( dots[ d ].x < 0 || dots[ d ].x + DOT > SCREEN_WIDTH ) {
+	velocities[ d ].x = -velocities[ d ].x;
+      }
+      if( dots[ d ].y < 0 || dots[ d ].y + DOT > SCREEN_HEIGHT ) {
+	velocities[ d ].y = -velocities[ d ].y;
+      }
+    }
+  }
+
+  // Draws the dots on the screen, only changes are presented
+  void draw( DirtyRects& renderer ) {
+    renderer.begin_frame();
+    for( int d = 0; d < dots.size(); ++d ) {
+      queue.blit( 0, dots[ d ].x, dots[ d ].y, dot );
+    }
+    queue.execute( renderer );
+  }
+
+  // Draws the dots at where, dots as they were for that frame, into a
+  // presenter's buffer
+  void draw( SDL_Surface* frame, const std::vector<SDL_Rect>& where, std::vector<SDL_Rect>& drawn ) {
+    for( int d = 0; d < where.size(); ++d ) {
+      queue.blit( 0, where[ d ].x, where[ d ].y, dot );
+    }
+    queue.prepare();
+    for( int c = 0; c < queue.get_commands().size(); ++c ) {
+      drawn.push_back( queue.get_commands()[ c ].rect );
+    }
+    queue.draw( frame );
+  }
+};
+
+bool same_pixels( SDL_Surface* a, SDL_Surface* b ) {
+  for( int y = 0; y < a->h; ++y ) {
+    if( memcmp( (Uint8*) a->pixels + y * a->pitch, (Uint8*) b->pixels + y * b->pitch, a->w * 4 ) != 0 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void report( const char* mode, int frames, double fps, double meanLatency, double maxLatency, double presentMs, bool match ) {
+  printf( "%10s %8d %10.1f %14.3f %14.3f %12.3f %8s\n", mode, frames, fps, meanLatency, maxLatency, presentMs, match ? "yes" : "NO" );
+}
+
+int main( int argc, char** argv )
+{
+  SDL_Surface* screen = make_surface( SCREEN_WIDTH, SCREEN_HEIGHT );
+  SDL_Surface* reference = make_surface( SCREEN_WIDTH, SCREEN_HEIGHT );
+
+  printf( "%10s %8s %10s %14s %14s %12s %8s\n", "buffers", "frames", "fps", "latency ms", "max ms", "present ms", "match" );
+
+  // In line, as the examples' main loops do it
+  {
+    Scene scene;
+    DirtyRects renderer( screen );
+    double latencySum = 0, latencyMax = 0, presentSum = 0;
+    double start = now_ms();
+
+    for( int f = 0; f < FRAMES; ++f ) {
+      double input = now_ms();
+      scene.simulate();
+      scene.draw( renderer );
+
+      double presentStart = now_ms();
+      renderer.present();
+      double end = now_ms();
+
+      latencySum += end - input;
+      latencyMax = end - input > latencyMax ? end - input : latencyMax;
+      presentSum += end - presentStart;
+    }
+
+    double ms = now_ms() - start;
+    report( "in line", FRAMES, FRAMES * 1000.0 / ms, latencySum / FRAMES, latencyMax, presentSum / FRAMES, true );
+    SDL_BlitSurface( screen, NULL, reference, NULL );
+  }
+
+  for( int depth = 2; depth <= PRESENTER_MAX_DEPTH; ++depth ) {
+    Scene scene;
+    std::vector< std::vector<SDL_Rect> > frames( depth );
+
+    SDL_FillRect( screen, NULL, SDL_MapRGB( screen->format, 0, 0, 0 ) );
+    Presenter presenter( screen, depth, [&]( SDL_Surface* frame, int index, std::vector<SDL_Rect>& drawn ) {
+	scene.draw( frame, frames[ index ], drawn );
+      } );
+
+    for( int f = 0; f < FRAMES; ++f ) {
+      double input = now_ms();
+      scene.simulate();
+
+      int index = presenter.begin_frame();
+      frames[ index ] = scene.dots;
+      presenter.submit( index, input );
+      presenter.present();
+    }
+    presenter.finish();
+
+    char mode[ 16 ];
+    snprintf( mode, sizeof( mode ), "%d", depth );
+    bool match = presenter.get_frames() == FRAMES && same_pixels( screen, reference );
+    report( mode, presenter.get_frames(), presenter.get_fps(), presenter.get_mean_latency_ms(),
+	    presenter.get_max_latency_ms(), presenter.get_mean_present_ms(), match );
+
+    if( !match ) {
+      return 1;
+    }
+  }
+
+  SDL_FreeSurface( reference );
+  SDL_FreeSurface( screen );
+
+  return 0;
+}
@@ -0,0 +1,106 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <vector>
+#include "../common/clock.h"
+#include "../common/rectset.h"
+
+// Checks the SIMD rect set kernels bit for bit against the scalar one,
+// then times one box against sets of increasing size with each kernel.
+
+const char* KERNEL_NAMES[] = { "scalar", "sse2", "avx2" };
+
+SDL_Rect random_rect( int side ) {
+  SDL_Rect r;
+  r.x = rand() % side - side / 8;
+  r.y = rand() % side - side / 8;
+  r.w = rand() % 40;
+  r.h = rand() % 40;
+  return r;
+}
+
+// Every kernel must give the same bits as the scalar reference
+bool verify( int side ) {
+  for( int round = 0; round < 1000; ++round ) {
+    RectSet set;
+    int n = rand() % 100;
+
+    for( int i = 0; i < n; ++i ) {
+      set.push_back( random_rect( side ) );
+    }
+
+    SDL_Rect box = random_rect( side );
+
+    for( int first = 0; first < set.padded_size(); first += RECTSET_BLOCK ) {
+      unsigned int expected = rectset_block_scalar( set, first, box.x, box.y, box.x + box.w, box.y + box.h );
+
+      for( int k = RECTSET_SSE2; k <= RECTSET_AVX2; ++k ) {
+	if( !rectset_supports( (RectSetKernel) k ) ) {
+	  continue;
+	}
+
+	rectset_use_kernel( (RectSetKernel) k );
+	unsigned int got = rectset_block_func()( set, first, box.x, box.y, box.x + box.w, box.y + box.h );
+
+	if( got != expected ) {
+	  fprintf( stderr, "%s kernel mismatch: %08x != %08x\n", KERNEL_NAMES[ k ], got, expected );
+	  return false;
+	}
+      }
+    }
+  }
+
+  return true;
+}
+
+int main( int argc, char** argv )
+{
+  static const int sizes[] = { 16, 256, 4096, 65536 };
+
+  srand( 1234 );
+
+  if( !verify( 200 ) ) {
+    return 1;
+  }
+  printf( "kernels match scalar reference\n" );
+
+  printf( "%8s %8s %12s %12s\n", "kernel", "rects", "ns/test", "hits" );
+
+  for( int s = 0; s < sizeof( sizes ) / sizeof( sizes[ 0 ] ); ++s ) {
+    int n = sizes[ s ];
+    RectSet set;
+
+    for( int i = 0; i < n; ++i ) {
+      set.push_back( random_rect( 4000 ) );
+    }
+
+    std::vector<SDL_Rect> queries( 256 );
+    for( int q = 0; q < queries.size(); ++q ) {
+      queries[ q ] = random_rect( 4000 );
+    }
+
+    for( int k = RECTSET_SCALAR; k <= RECTSET_AVX2; ++k ) {
+      if( !rectset_supports( (RectSetKernel) k ) ) {
+	continue;
+      }
+      rectset_use_kernel( (RectSetKernel) k );
+
+      std::vector<int> hits;
+      int rounds = 1 + ( 1 << 22 ) / ( n * queries.size() );
+
+      double start = now_ms();
+      for( int r = 0; r < rounds; ++r ) {
+	hits.clear();
+	for( int q = 0; q < queries.size(); ++q ) {
+	  find_overlaps( queries[ q ], set, hits );
+	}
+      }
+      double ms = now_ms() - start;
+
+      double tests = (double) rounds * queries.size() * n;
+      printf( "%8s %8d %12.3f %12d\n", KERNEL_NAMES[ k ], n, ms * 1e6 / tests, (int) hits.size() );
+    }
+  }
+
+  return 0;
+}
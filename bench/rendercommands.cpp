@@ -0,0 +1,160 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <vector>
+#include <algorithm>
+#include "../common/clock.h"
+#include "../common/rendercommands.h"
+
+// Replays a recorded frame through the render command buffer and through
+// plain blits in the order it was recorded. The frame is like 19 at
+// scale: a tiled background, colorkeyed dots on top drawn twice each,
+// and opaque panels over some of them. The buffer's output is checked
+// pixel for pixel against drawing every command, none dropped, in the
+// buffer's own sort order.
+
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int TILE = 64;
+const int DOT = 20;
+const int FRAMES = 50;
+
+const int LAYER_BACKGROUND = 0;
+const int LAYER_DOTS = 1;
+const int LAYER_PANELS = 2;
+
+SDL_Surface* make_surface( int w, int h ) {
+  return SDL_CreateRGBSurface( SDL_SWSURFACE, w, h, 32, 0xFF0000, 0xFF00, 0xFF, 0 );
+}
+
+// A round dot in color on the colorkey, like dot.png
+SDL_Surface* make_dot( Uint8 r, Uint8 g, Uint8 b ) {
+  SDL_Surface* dot = make_surface( DOT, DOT );
+  Uint32 colorkey = SDL_MapRGB( dot->format, 200, 191, 231 );
+
+  SDL_FillRect( dot, NULL, colorkey );
+  for( int y = 0; y < DOT; ++y ) {
+    for( int x = 0; x < DOT; ++x ) {
+      int dx = 2 * x + 1 - DOT, dy = 2 * y + 1 - DOT;
+      if( dx * dx + dy * dy < DOT * DOT ) {
+	( (Uint32*) ( (Uint8*) dot->pixels + y * dot->pitch ) )[ x ] = SDL_MapRGB( dot->format, r, g, b );
+      }
+    }
+  }
+  SDL_SetColorKey( dot, SDL_SRCCOLORKEY, colorkey );
+
+  return dot;
+}
+
+// Draws commands as they are, in the order given
+void draw( const std::vector<RenderCommand>& commands, SDL_Surface* screen ) {
+  for( int c = 0; c < commands.size(); ++c ) {
+    SDL_Rect from = commands[ c ].clip, to = commands[ c ].rect;
+
+    if( commands[ c ].source ) {
+      SDL_BlitSurface( commands[ c ].source, &from, screen, &to );
+    } else {
+      SDL_FillRect( screen, &to, commands[ c ].color );
+    }
+  }
+}
+
+bool key_less( const RenderCommand& a, const RenderCommand& b ) {
+  return a.key < b.key;
+}
+
+bool same_pixels( SDL_Surface* a, SDL_Surface* b ) {
+  for( int y = 0; y < a->h; ++y ) {
+    if( memcmp( (Uint8*) a->pixels + y * a->pitch, (Uint8*) b->pixels + y * b->pitch, a->w * 4 ) != 0 ) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main( int argc, char** argv )
+{
+  static const int counts[] = { 100, 1000, 10000 };
+
+  srand( 1234 );
+
+  SDL_Surface* screen = make_surface( SCREEN_WIDTH, SCREEN_HEIGHT );
+  SDL_Surface* reference = make_surface( SCREEN_WIDTH, SCREEN_HEIGHT );
+  SDL_Surface* tile = make_surface( TILE, TILE );
+  SDL_Surface* dots[ 4 ] = { make_dot( 255, 0, 0 ), make_dot( 0, 255, 0 ), make_dot( 0, 0, 255 ), make_dot( 255, 255, 255 ) };
+
+  SDL_FillRect( tile, NULL, SDL_MapRGB( tile->format, 40, 40, 60 ) );
+
+  printf( "%8s %10s %10s %14s %14s %14s %8s\n", "dots", "commands", "dropped", "direct ms", "queue ms", "prepare ms", "match" );
+
+  for( int c = 0; c < sizeof( counts ) / sizeof( counts[ 0 ] ); ++c ) {
+    int n = counts[ c ];
+    RenderQueue queue( SCREEN_WIDTH, SCREEN_HEIGHT );
+
+    // Record one frame
+    for( int y = 0; y < SCREEN_HEIGHT; y += TILE ) {
+      for( int x = 0; x < SCREEN_WIDTH; x += TILE ) {
+	queue.blit( LAYER_BACKGROUND, x, y, tile );
+      }
+    }
+    for( int d = 0; d < n; ++d ) {
+      int x = rand() % ( SCREEN_WIDTH - DOT ), y = rand() % ( SCREEN_HEIGHT - DOT );
+      SDL_Surface* dot = dots[ rand() % 4 ];
+
+      // Like theDot in 19, every dot is shown twice
+      queue.blit( LAYER_DOTS, x, y, dot );
+      queue.blit( LAYER_DOTS, x, y, dot );
+    }
+    for( int p = 0; p < 4; ++p ) {
+      SDL_Rect panel;
+      panel.x = rand() % ( SCREEN_WIDTH - 160 );
+      panel.y = rand() % ( SCREEN_HEIGHT - 120 );
+      panel.w = 160;
+      panel.h = 120;
+      queue.fill( LAYER_PANELS, panel, SDL_MapRGB( screen->format, 90, 90, 90 ) );
+    }
+
+    std::vector<RenderCommand> frame = queue.get_commands();
+
+    // Reference: every command, in layer order
+    std::vector<RenderCommand> ordered = frame;
+    std::stable_sort( ordered.begin(), ordered.end(), key_less );
+    draw( ordered, reference );
+
+    queue.replay( frame );
+    queue.execute( screen );
+    bool match = same_pixels( screen, reference );
+    int dropped = queue.get_dropped();
+
+    // Direct blits in recorded order (recorded in layer order here)
+    double start = now_ms();
+    for( int f = 0; f < FRAMES; ++f ) {
+      draw( frame, screen );
+    }
+    double directMs = ( now_ms() - start ) / FRAMES;
+
+    start = now_ms();
+    for( int f = 0; f < FRAMES; ++f ) {
+      queue.replay( frame );
+      queue.execute( screen );
+    }
+    double queueMs = ( now_ms() - start ) / FRAMES;
+
+    start = now_ms();
+    for( int f = 0; f < FRAMES; ++f ) {
+      queue.replay( frame );
+      queue.prepare();
+    }
+    double prepareMs = ( now_ms() - start ) / FRAMES;
+    queue.clear();
+
+    printf( "%8d %10d %10d %14.3f %14.3f %14.3f %8s\n", n, (int) frame.size(), dropped, directMs, queueMs, prepareMs, match ? "yes" : "NO" );
+
+    if( !match ) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,130 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <cmath>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include "../common/clock.h"
+#include "../common/sweepprune.h"
+
+// Sort and sweep against a brute force baseline built on check_collision.
+// Dots move a few pixels per frame like the Square/Dot velocity model.
+// Brute force finds the full pair list each frame and diffs it with the
+// previous one; both must report the same started/stopped pairs.
+
+const int DOT_SIZE = 20;
+const int FRAMES = 30;
+
+struct Mover {
+  SDL_Rect box;
+  int xVel, yVel;
+  int id;
+};
+
+// Same test as 17/collisiondetection.cpp
+bool check_collision( SDL_Rect a, SDL_Rect b ) {
+  int left_a = a.x, right_a = a.x + a.w, top_a = a.y, bottom_a = a.y + a.h;
+  int left_b = b.x, right_b = b.x + b.w, top_b = b.y, bottom_b = b.y + b.h;
+
+  if( bottom_a <= top_b ) {
+    return false;
+  }
+  if( top_a >= bottom_b ) {
+    return false;
+  }
+  if( right_a <= left_b ) {
+    return false;
+  }
+  if( left_a >= right_b ) {
+    return false;
+  }
+  return true;
+}
+
+void brute_force( std::vector<Mover>& movers, std::vector< std::pair<int, int> >& pairs ) {
+  pairs.clear();
+  for( int a = 0; a < movers.size(); ++a ) {
+    for( int b = a + 1; b < movers.size(); ++b ) {
+      if( check_collision( movers[ a ].box, movers[ b ].box ) ) {
+	pairs.push_back( std::make_pair( movers[ a ].id, movers[ b ].id ) );
+      }
+    }
+  }
+  std::sort( pairs.begin(), pairs.end() );
+}
+
+int main( int argc, char** argv )
+{
+  static const int counts[] = { 500, 2000, 8000 };
+
+  srand( 1234 );
+
+  printf( "%8s %14s %14s %10s %10s %8s\n", "dots", "brute ms/frm", "sap ms/frm", "pairs", "changes", "match" );
+
+  for( int c = 0; c < sizeof( counts ) / sizeof( counts[ 0 ] ); ++c ) {
+    int n = counts[ c ];
+    int world = 60 * (int) sqrt( (double) n );
+
+    SweepAndPrune sap;
+    std::vector<Mover> movers( n );
+
+    for( int m = 0; m < n; ++m ) {
+      movers[ m ].box.x = rand() % world;
+      movers[ m ].box.y = rand() % world;
+      movers[ m ].box.w = movers[ m ].box.h = DOT_SIZE;
+      movers[ m ].xVel = rand() % 5 - 2;
+      movers[ m ].yVel = rand() % 5 - 2;
+      movers[ m ].id = sap.add( movers[ m ].box );
+    }
+
+    std::vector< std::pair<int, int> > started, stopped;
+    std::vector< std::pair<int, int> > previous, current;
+    sap.update( started, stopped );
+    brute_force( movers, previous );
+
+    bool match = started == previous && stopped.empty();
+    int changes = 0;
+    double bruteMs = 0, sapMs = 0;
+
+    for( int f = 0; f < FRAMES && match; ++f ) {
+      for( int m = 0; m < n; ++m ) {
+	Mover& mover = movers[ m ];
+
+	mover.box.x += mover.xVel;
+	mover.box.y += mover.yVel;
+	if( mover.box.x < 0 || mover.box.x > world ) mover.xVel = -mover.xVel;
+	if( mover.box.y < 0 || mover.box.y > world ) mover.yVel = -mover.yVel;
+      }
+
+      double start = now_ms();
+      for( int m = 0; m < n; ++m ) {
+	sap.move( movers[ m ].id, movers[ m ].box );
+      }
+      started.clear();
+      stopped.clear();
+      sap.update( started, stopped );
+      sapMs += now_ms() - start;
+
+      // Baseline: every pair, then diff with the last frame
+      start = now_ms();
+      brute_force( movers, current );
+      std::vector< std::pair<int, int> > bruteStarted, bruteStopped;
+      std::set_difference( current.begin(), current.end(), previous.begin(), previous.end(), std::back_inserter( bruteStarted ) );
+      std::set_difference( previous.begin(), previous.end(), current.begin(), current.end(), std::back_inserter( bruteStopped ) );
+      previous.swap( current );
+      bruteMs += now_ms() - start;
+
+      match = started == bruteStarted && stopped == bruteStopped;
+      changes += started.size() + stopped.size();
+    }
+
+    printf( "%8d %14.3f %14.3f %10d %10d %8s\n", n, bruteMs / FRAMES, sapMs / FRAMES, sap.pair_count(), changes, match ? "yes" : "NO" );
+
+    if( !match ) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
@@ -0,0 +1,182 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include "../common/clock.h"
+#include "../common/tiledimage.h"
+
+// A world map much larger than the screen, drawn the way the examples
+// drew backgrounds (every pixel decoded and converted up front) against
+// TiledImage, which decodes only the tiles in view. Reports the time to
+// the first frame, then scrolls the view across the map at several memory
+// budgets: ms per frame, tiles decoded, cache hits, evictions and the
+// most memory the tiles took. Every frame must match the map converted
+// whole.
+//
+// usage: tiledimage [size [tileSize]], a 4096 pixel square map of 256
+// pixel tiles by default. The tiles are written to /tmp.
+
+const int SCREEN_WIDTH = 640;
+const int SCREEN_HEIGHT = 480;
+const int FRAMES = 600;
+const int SCROLL = 6;
+const char* const TILES = "/tmp/tiledimage.tiles";
+
+// Terrain of 16 pixel cells in a few colors with a speckle here and there,
+// colorkey included, so there are runs and literals both
+SDL_Surface* make_world( int size ) {
+  static const Uint8 colors[][ 3 ] = {
+    { 34, 139, 34 }, { 107, 142, 35 }, { 65, 105, 225 }, { 194, 178, 128 }, { 128, 128, 128 }, { 200, 191, 231 }
+  };
+  SDL_Surface* world = SDL_CreateRGBSurface( SDL_SWSURFACE, size, size, 32, 0xFF0000, 0x00FF00, 0x0000FF, 0 );
+  Uint32 seed = 12345;
+
+  for( int y = 0; y < size; ++y ) {
+    Uint32* row = (Uint32*) ( (Uint8*) world->pixels + y * world->pitch );
+    for( int x = 0; x < size; ++x ) {
+      Uint32 cell = ( ( x / 16 ) * 73856093u ) ^ ( ( y / 16 ) * 19349663u );
+      const Uint8* c = colors[ ( cell >> 7 ) % 6 ];
+
+      seed = seed * 1664525u + 1013904223u;
+      int speckle = ( seed >> 24 ) < 8 ? ( seed >> 16 ) & 31 : 0;
+      row[ x ] = ( ( c[ 0 ] ^ speckle ) << 16 ) | ( ( c[ 1 ] ^ speckle ) << 8 ) | ( c[ 2 ] ^ speckle );
+    }
+  }
+  return world;
+}
+
+// screen holds view of the map on black: what the whole converted map
+// shows there, with colorkey pixels left black
+bool same_view( SDL_Surface* screen, SDL_Surface* reference, const SDL_Rect& view ) {
+  Uint32 key = reference->format->colorkey;
+
+  for( int y = 0; y < view.h; ++y ) {
+    const Uint32* got = (const Uint32*) ( (Uint8*) screen->pixels + y * screen->pitch );
+    const Uint32* want = (const Uint32*) ( (Uint8*) reference->pixels + ( view.y + y ) * reference->pitch ) + view.x;
+    for( int x = 0; x < view.w; ++x ) {
+      if( got[ x ] != ( want[ x ] == key ? 0 : want[ x ] ) ) {
+	return false;
+      }
+    }
+  }
+  return true;
+}
+
+// Where the view is after frame f: down and to the right, bouncing off
+// the edges
+SDL_Rect scroll_view( int f, int size ) {
+  int spanX = size - SCREEN_WIDTH, spanY = size - SCREEN_HEIGHT;
+  int x = ( f * SCROLL ) % ( 2 * spanX ), y = ( f * SCROLL / 2 ) % ( 2 * spanY );
+  SDL_Rect view = { (Sint16) ( x > spanX ? 2 * spanX - x : x ), (Sint16) ( y > spanY ? 2 * spanY - y : y ),
+		    SCREEN_WIDTH, SCREEN_HEIGHT };
+  return view;
+}
+
+int main( int argc, char** argv )
+{
+  int size = argc > 1 ? atoi( argv[ 1 ] ) : 4096;
+  int tileSize = argc > 2 ? atoi( argv[ 2 ] ) : TILED_DEFAULT_TILE;
+
+  if( size < SCREEN_WIDTH || size > 32767 || tileSize <= 0 ) {
+    fprintf( stderr, "usage: %s [size [tileSize]], size %d to 32767\n", argv[ 0 ], SCREEN_WIDTH );
+    return 1;
+  }
+
+  setenv( "SDL_VIDEODRIVER", "dummy", 1 );
+  SDL_Surface* screen = NULL;
+  if( SDL_Init( SDL_INIT_VIDEO ) < 0 || ( screen = SDL_SetVideoMode( SCREEN_WIDTH, SCREEN_HEIGHT, 32, SDL_SWSURFACE ) ) == NULL ) {
+    fprintf( stderr, "Error setting up SDL: %s\n", SDL_GetError() );
+    return 1;
+  }
+
+  SDL_Surface* world = make_world( size );
+  double start = now_ms();
+  if( !save_tiled( world, TILES, tileSize, true ) ) {
+    fprintf( stderr, "Error writing %s\n", TILES );
+    return 1;
+  }
+  double tileMs = now_ms() - start;
+
+  struct stat info;
+  stat( TILES, &info );
+  printf( "map %dx%d, %d pixel tiles, %lu bytes of pixels, %lu in tiles (%.1f ms to write)\n\n", size, size, tileSize,
+	  (unsigned long) size * size * 3, (unsigned long) info.st_size, tileMs );
+
+  // Eager, as backgrounds always loaded: the whole map converted up front
+  start = now_ms();
+  SDL_Surface* reference = SDL_DisplayFormat( world );
+  SDL_SetColorKey( reference, SDL_SRCCOLORKEY, SDL_MapRGB( reference->format, 200, 191, 231 ) );
+  double eagerMs = now_ms() - start;
+  SDL_FreeSurface( world );
+
+  // Every tile decoded and converted, what TiledImage does for the map
+  // when all of it is in view
+  TiledImage all( (size_t) -1 );
+  start = now_ms();
+  all.open( TILES );
+  for( int row = 0; row * tileSize < size; ++row ) {
+    for( int col = 0; col * tileSize < size; ++col ) {
+      all.get_tile( col, row );
+    }
+  }
+  double allMs = now_ms() - start;
+  size_t allBytes = all.get_live_bytes();
+  all.close();
+
+  // Lazy: only what the first frame shows
+  TiledImage first;
+  SDL_Rect origin = scroll_view( 0, size );
+  start = now_ms();
+  first.open( TILES );
+  SDL_FillRect( screen, NULL, 0 );
+  first.draw( origin, screen, 0, 0 );
+  double firstMs = now_ms() - start;
+  bool allMatch = same_view( screen, reference, origin );
+
+  printf( "%-28s %12s %14s\n", "first frame", "ms", "bytes" );
+  printf( "%-28s %12.3f %14lu\n", "convert whole map", eagerMs, (unsigned long) reference->pitch * reference->h );
+  printf( "%-28s %12.3f %14lu\n", "decode every tile", allMs, (unsigned long) allBytes );
+  printf( "%-28s %12.3f %14lu %s\n\n", "decode tiles in view", firstMs, (unsigned long) first.get_live_bytes(), allMatch ? "" : "MISMATCH" );
+  first.close();
+
+  size_t screenBytes = (size_t) SCREEN_WIDTH * SCREEN_HEIGHT * 4;
+  size_t budgets[] = { 0, screenBytes, 2 * screenBytes, TILED_DEFAULT_BUDGET, (size_t) -1 };
+  const char* names[] = { "0", "1 screen", "2 screens", "default", "unlimited" };
+
+  printf( "%d frames scrolling %d pixels a frame\n", FRAMES, SCROLL );
+  printf( "%-12s %10s %10s %10s %10s %10s %14s %8s\n", "budget", "ms/frame", "worst ms", "decodes", "hits", "evictions", "peak bytes", "match" );
+
+  for( int b = 0; b < sizeof( budgets ) / sizeof( budgets[ 0 ] ); ++b ) {
+    TiledImage map( budgets[ b ] );
+    double ms = 0, worst = 0;
+    size_t peak = 0;
+    bool match = map.open( TILES );
+
+    for( int f = 0; f < FRAMES && match; ++f ) {
+      SDL_Rect view = scroll_view( f, size );
+
+      start = now_ms();
+      SDL_FillRect( screen, NULL, 0 );
+      map.draw( view, screen, 0, 0 );
+      double frameMs = now_ms() - start;
+
+      ms += frameMs;
+      worst = frameMs > worst ? frameMs : worst;
+      peak = map.get_live_bytes() > peak ? map.get_live_bytes() : peak;
+      match = same_view( screen, reference, view );
+    }
+
+    printf( "%-12s %10.3f %10.3f %10d %10d %10d %14lu %8s\n", names[ b ], ms / FRAMES, worst, map.get_decodes(), map.get_hits(),
+	    map.get_evictions(), (unsigned long) peak, match ? "yes" : "NO" );
+    allMatch = allMatch && match;
+  }
+
+  SDL_FreeSurface( reference );
+  unlink( TILES );
+  SDL_Quit();
+
+  return allMatch ? 0 : 1;
+}
@@ -0,0 +1,23 @@
+
+# Rules every example's Makefile shares, included after its own targets.
+# The example sets OUTPUT, ASSETS (files packed as they are) and, when it
+# bakes its images, OUTPUT_BLOBS before including this.
+
+# Bake images in display format, the examples map them when they fit
+$(OUTPUT)%.blob: %.png ../out/tools/bake
+	mkdir -p $(OUTPUT)
+	../out/tools/bake $< $@
+
+# Pack the assets into one file, the example maps it once and reads
+# them from memory
+$(OUTPUT)assets.pack: $(ASSETS) $(OUTPUT_BLOBS) ../out/tools/pack
+	mkdir -p $(OUTPUT)
+	../out/tools/pack $@ $(filter-out ../out/tools/pack, $^)
+
+# The tools the assets are made with, rebuilt when their source or the
+# headers they share with the examples change
+../out/tools/%: ../tools/%.cpp $(wildcard ../common/*.h)
+	$(MAKE) -C ../tools
+
+# Built by a pattern rule, make would delete them after use otherwise
+.PRECIOUS: ../out/tools/%
@@ -0,0 +1,470 @@
+#ifndef AABBTREE_H
+#define AABBTREE_H
+
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <vector>
+#include <utility>
+
+// Dynamic bounding volume hierarchy over rects.
+// Every leaf stores its rect grown by a margin (the "fat" box). A moving
+// rect only changes the tree when it leaves its fat box; then its leaf
+// is taken out and reinserted where it adds the least perimeter, and
+// the path back to the root is refit and rebalanced with rotations.
+//
+// Static geometry (the walls) goes in its own tree with margin 0 and is
+// never moved, so it stays as tight as it was built.
+
+const int AABBTREE_NULL = -1;
+
+struct AABBTreeBox {
+  int x0, y0, x1, y1;
+};
+
+class AABBTree {
+private:
+  struct Node {
+    AABBTreeBox fat;
+    AABBTreeBox tight;
+    int parent;
+    int child1, child2;
+    // Leaf = 0, free node = -1
+    int height;
+    int data;
+  };
+
+  std::vector<Node> nodes;
+  int root;
+  int freeList;
+  int margin;
+  int leafCount;
+
+  static AABBTreeBox to_box( const SDL_Rect& r ) {
+    AABBTreeBox b;
+    b.x0 = r.x;
+    b.y0 = r.y;
+    b.x1 = r.x + r.w;
+    b.y1 = r.y + r.h;
+    return b;
+  }
+
+  static AABBTreeBox combine( const AABBTreeBox& a, const AABBTreeBox& b ) {
+    AABBTreeBox c;
+    c.x0 = a.x0 < b.x0 ? a.x0 : b.x0;
+    c.y0 = a.y0 < b.y0 ? a.y0 : b.y0;
+    c.x1 = a.x1 > b.x1 ? a.x1 : b.x1;
+    c.y1 = a.y1 > b.y1 ? a.y1 : b.y1;
+    return c;
+  }
+
+  static int perimeter( const AABBTreeBox& b ) {
+    return 2 * ( ( b.x1 - b.x0 ) + ( b.y1 - b.y0 ) );
+  }
+
+  static bool contains( const AABBTreeBox& outer, const AABBTreeBox& inner ) {
+    return outer.x0 <= inner.x0 && outer.y0 <= inner.y0 && outer.x1 >= inner.x1 && outer.y1 >= inner.y1;
+  }
+
+  int allocate_node() {
+    if( freeList == AABBTREE_NULL ) {
+      Node node;
+      node.parent = node.child1 = node.child2 = AABBTREE_NULL;
+      node.height = -1;
+      node.data = 0;
+      nodes.push_back( node );
+      freeList = nodes.size() - 1;
+      nodes[ freeList ].parent = AABBTREE_NULL;
+    }
+
+    int id = freeList;
+    freeList = nodes[ id ].parent;
+
+    nodes[ id ].parent = nodes[ id ].child1 = nodes[ id ].child2 = AABBTREE_NULL;
+    nodes[ id ].height = 0;
+    nodes[ id ].data = 0;
+    return id;
+  }
+
+  void free_node( int id ) {
+    nodes[ id ].parent = freeList;
+    nodes[ id ].height = -1;
+    freeList = id;
+  }
+
+  bool is_leaf( int id ) const {
+    return nodes[ id ].child1 == AABBTREE_NULL;
+  }
+
+  void insert_leaf( int leaf ) {
+    if( root == AABBTREE_NULL ) {
+      root = leaf;
+      nodes[ root ].parent = AABBTREE_NULL;
+      return;
+    }
+
+    // Walk down to the sibling that costs the least perimeter
+    AABBTreeBox leafBox = nodes[ leaf ].fat;
+    int index = root;
+
+    while( !is_leaf( index ) ) {
+      int child1 = nodes[ index ].child1;
+      int child2 = nodes[ index ].child2;
+
+      int area = perimeter( nodes[ index ].fat );
+      int combinedArea = perimeter( combine( nodes[ index ].fat, leafBox ) );
+
+      // Cost of a new parent here, and of pushing the leaf further down
+      int cost = 2 * combinedArea;
+      int inheritance = 2 * ( combinedArea - area );
+
+      int cost1 = perimeter( combine( leafBox, nodes[ child1 ].fat ) ) + inheritance;
+      if( !is_leaf( child1 ) ) {
+	cost1 -= perimeter( nodes[ child1 ].fat );
+      }
+
+      int cost2 = perimeter( combine( leafBox, nodes[ child2 ].fat ) ) + inheritance;
+      if( !is_leaf( child2 ) ) {
+	cost2 -= perimeter( nodes[ child2 ].fat );
+      }
+
+      if( cost < cost1 && cost < cost2 ) {
+	break;
+      }
+
+      index = cost1 < cost2 ? child1 : child2;
+    }
+
+    int sibling = index;
+    int oldParent = nodes[ sibling ].parent;
+    int newParent = allocate_node();
+
+    nodes[ newParent ].parent = oldParent;
+    nodes[ newParent ].fat = combine( leafBox, nodes[ sibling ].fat );
+    nodes[ newParent ].height = nodes[ sibling ].height + 1;
+    nodes[ newParent ].child1 = sibling;
+    nodes[ newParent ].child2 = leaf;
+    nodes[ sibling ].parent = newParent;
+    nodes[ leaf ].parent = newParent;
+
+    if( oldParent != AABBTREE_NULL ) {
+      if( nodes[ oldParent ].child1 == sibling ) {
+	nodes[ oldParent ].child1 = newParent;
+      } else {
+	nodes[ oldParent ].child2 = newParent;
+      }
+    } else {
+      root = newParent;
+    }
+
+    refit( nodes[ leaf ].parent );
+  }
+
+  void remove_leaf( int leaf ) {
+    if( leaf == root ) {
+      root = AABBTREE_NULL;
+      return;
+    }
+
+    int parent = nodes[ leaf ].parent;
+    int grandParent = nodes[ parent ].parent;
+    int sibling = nodes[ parent ].child1 == leaf ? nodes[ parent ].child2 : nodes[ parent ].child1;
+
+    if( grandParent != AABBTREE_NULL ) {
+      if( nodes[ grandParent ].child1 == parent ) {
+	nodes[ grandParent ].child1 = sibling;
+      } else {
+	nodes[ grandParent ].child2 = sibling;
+      }
+      nodes[ sibling ].parent = grandParent;
+      free_node( parent );
+
+      refit( grandParent );
+    } else {
+      root = sibling;
+      nodes[ sibling ].parent = AABBTREE_NULL;
+      free_node( parent );
+    }
+  }
+
+  // Rebalances and refits every node from index up to the root
+  void refit( int index ) {
+    while( index != AABBTREE_NULL ) {
+      index = balance( index );
+
+      int child1 = nodes[ index ].child1;
+      int child2 = nodes[ index ].child2;
+
+      nodes[ index ].height = 1 + ( nodes[ child1 ].height > nodes[ child2 ].height ? nodes[ child1 ].height : nodes[ child2 ].height );
+      nodes[ index ].fat = combine( nodes[ child1 ].fat, nodes[ child2 ].fat );
+
+      index = nodes[ index ].parent;
+    }
+  }
+
+  // Rotates the taller grandchild of a up when its children's heights
+  // differ by more than one. Returns the node now in a's place.
+  int balance( int a ) {
+    if( is_leaf( a ) || nodes[ a ].height < 2 ) {
+      return a;
+    }
+
+    int b = nodes[ a ].child1;
+    int c = nodes[ a ].child2;
+    int diff = nodes[ c ].height - nodes[ b ].height;
+
+    if( diff > 1 ) {
+      return rotate( a, c, b );
+    }
+    if( diff < -1 ) {
+      return rotate( a, b, c );
+    }
+    return a;
+  }
+
+  // Lifts child up over a; other is a's other child
+  int rotate( int a, int up, int other ) {
+    int f = nodes[ up ].child1;
+    int g = nodes[ up ].child2;
+
+    nodes[ up ].child1 = a;
+    nodes[ up ].parent = nodes[ a ].parent;
+    nodes[ a ].parent = up;
+
+    if( nodes[ up ].parent != AABBTREE_NULL ) {
+      if( nodes[ nodes[ up ].parent ].child1 == a ) {
+	nodes[ nodes[ up ].parent ].child1 = up;
+      } else {
+	nodes[ nodes[ up ].parent ].child2 = up;
+      }
+    } else {
+      root = up;
+    }
+
+    // Keep the taller of up's children beside a, move the other under a
+    int keep = nodes[ f ].height > nodes[ g ].height ? f : g;
+    int move = keep == f ? g : f;
+
+    nodes[ up ].child2 = keep;
+    if( nodes[ a ].child1 == up ) {
+      nodes[ a ].child1 = move;
+    } else {
+      nodes[ a ].child2 = move;
+    }
+    nodes[ move ].parent = a;
+
+    nodes[ a ].fat = combine( nodes[ other ].fat, nodes[ move ].fat );
+    nodes[ up ].fat = combine( nodes[ a ].fat, nodes[ keep ].fat );
+
+    nodes[ a ].height = 1 + ( nodes[ other ].height > nodes[ move ].height ? nodes[ other ].height : nodes[ move ].height );
+    nodes[ up ].height = 1 + ( nodes[ a ].height > nodes[ keep ].height ? nodes[ a ].height : nodes[ keep ].height );
+
+    return up;
+  }
+
+  static bool overlaps( const AABBTreeBox& a, const AABBTreeBox& b ) {
+    return !( a.y1 <= b.y0 || a.y0 >= b.y1 || a.x1 <= b.x0 || a.x0 >= b.x1 );
+  }
+
+  int depth_of( int index ) const {
+    int depth = 0;
+    while( nodes[ index ].parent != AABBTREE_NULL ) {
+      index = nodes[ index ].parent;
+      ++depth;
+    }
+    return depth;
+  }
+
+public:
+  // fatMargin: pixels a leaf's box is grown by, 0 for static trees
+  AABBTree( int fatMargin = 8 ) {
+    root = AABBTREE_NULL;
+    freeList = AABBTREE_NULL;
+    margin = fatMargin;
+    leafCount = 0;
+  }
+
+  // Adds a rect, returns the proxy id used to move or remove it.
+  // data is handed back by the queries.
+  int create_proxy( const SDL_Rect& rect, int data ) {
+    int leaf = allocate_node();
+
+    nodes[ leaf ].tight = to_box( rect );
+    nodes[ leaf ].fat = nodes[ leaf ].tight;
+    nodes[ leaf ].fat.x0 -= margin;
+    nodes[ leaf ].fat.y0 -= margin;
+    nodes[ leaf ].fat.x1 += margin;
+    nodes[ leaf ].fat.y1 += margin;
+    nodes[ leaf ].data = data;
+
+    insert_leaf( leaf );
+    ++leafCount;
+
+    return leaf;
+  }
+
+  void destroy_proxy( int proxy ) {
+    remove_leaf( proxy );
+    free_node( proxy );
+    --leafCount;
+  }
+
+  // Updates a proxy's rect. The tree only changes when the rect leaves
+  // its fat box; the new fat box is also stretched by the displacement
+  // (dx, dy) to anticipate further motion. Returns whether it did.
+  bool move_proxy( int proxy, const SDL_Rect& rect, int dx = 0, int dy = 0 ) {
+    AABBTreeBox tight = to_box( rect );
+    nodes[ proxy ].tight = tight;
+
+    if( contains( nodes[ proxy ].fat, tight ) ) {
+      return false;
+    }
+
+    remove_leaf( proxy );
+
+    AABBTreeBox fat = tight;
+    fat.x0 -= margin;
+    fat.y0 -= margin;
+    fat.x1 += margin;
+    fat.y1 += margin;
+
+    if( dx < 0 ) fat.x0 += dx * 2; else fat.x1 += dx * 2;
+    if( dy < 0 ) fat.y0 += dy * 2; else fat.y1 += dy * 2;
+
+    nodes[ proxy ].fat = fat;
+    insert_leaf( proxy );
+
+    return true;
+  }
+
+  int get_data( int proxy ) const {
+    return nodes[ proxy ].data;
+  }
+
+  SDL_Rect get_rect( int proxy ) const {
+    SDL_Rect r;
+    r.x = nodes[ proxy ].tight.x0;
+    r.y = nodes[ proxy ].tight.y0;
+    r.w = nodes[ proxy ].tight.x1 - nodes[ proxy ].tight.x0;
+    r.h = nodes[ proxy ].tight.y1 - nodes[ proxy ].tight.y0;
+    return r;
+  }
+
+  int size() const {
+    return leafCount;
+  }
+
+  // Appends the proxy ids whose (tight) rect overlaps rect
+  void query( const SDL_Rect& rect, std::vector<int>& proxies ) const {
+    if( root == AABBTREE_NULL ) {
+      return;
+    }
+
+    AABBTreeBox box = to_box( rect );
+    std::vector<int> stack;
+    stack.push_back( root );
+
+    while( !stack.empty() ) {
+      int index = stack.back();
+      stack.pop_back();
+
+      if( !overlaps( nodes[ index ].fat, box ) ) {
+	continue;
+      }
+
+      if( is_leaf( index ) ) {
+	if( overlaps( nodes[ index ].tight, box ) ) {
+	  proxies.push_back( index );
+	}
+      } else {
+	stack.push_back( nodes[ index ].child1 );
+	stack.push_back( nodes[ index ].child2 );
+      }
+    }
+  }
+
+  // Appends the proxy ids whose rect contains pixel (x, y)
+  void query_point( int x, int y, std::vector<int>& proxies ) const {
+    SDL_Rect pixel;
+    pixel.x = x;
+    pixel.y = y;
+    pixel.w = pixel.h = 1;
+    query( pixel, proxies );
+  }
+
+  // Appends every pair of overlapping proxies of this tree, smaller id first
+  void find_pairs( std::vector< std::pair<int, int> >& pairs ) const {
+    std::vector<int> hits;
+
+    for( int leaf = 0; leaf < nodes.size(); ++leaf ) {
+      if( nodes[ leaf ].height != 0 ) {
+	continue;
+      }
+
+      hits.clear();
+      query( get_rect( leaf ), hits );
+
+      for( int h = 0; h < hits.size(); ++h ) {
+	if( hits[ h ] > leaf ) {
+	  pairs.push_back( std::make_pair( leaf, hits[ h ] ) );
+	}
+      }
+    }
+  }
+
+  // Appends every pair (proxy of this tree, proxy of other) that overlap.
+  // Used for movers against the static tree.
+  void find_pairs( const AABBTree& other, std::vector< std::pair<int, int> >& pairs ) const {
+    std::vector<int> hits;
+
+    for( int leaf = 0; leaf < nodes.size(); ++leaf ) {
+      if( nodes[ leaf ].height != 0 ) {
+	continue;
+      }
+
+      hits.clear();
+      other.query( get_rect( leaf ), hits );
+
+      for( int h = 0; h < hits.size(); ++h ) {
+	pairs.push_back( std::make_pair( leaf, hits[ h ] ) );
+      }
+    }
+  }
+
+  // Height of the root, 0 for a single leaf
+  int height() const {
+    return root == AABBTREE_NULL ? 0 : nodes[ root ].height;
+  }
+
+  // Average depth of the leaves, compare with log2( size() )
+  double average_depth() const {
+    if( leafCount == 0 ) {
+      return 0;
+    }
+
+    long total = 0;
+    for( int i = 0; i < nodes.size(); ++i ) {
+      if( nodes[ i ].height == 0 ) {
+	total += depth_of( i );
+      }
+    }
+    return (double) total / leafCount;
+  }
+
+  // Surface area heuristic cost: summed perimeter of the internal nodes
+  // over the root's perimeter. Lower means queries visit fewer nodes.
+  double sah_cost() const {
+    if( root == AABBTREE_NULL || is_leaf( root ) ) {
+      return 0;
+    }
+
+    double total = 0;
+    for( int i = 0; i < nodes.size(); ++i ) {
+      if( nodes[ i ].height > 0 ) {
+	total += perimeter( nodes[ i ].fat );
+      }
+    }
+    return total / perimeter( nodes[ root ].fat );
+  }
+};
+
+#endif
@@ -0,0 +1,299 @@
+#ifndef ASSETCACHE_H
+#define ASSETCACHE_H
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <algorithm>
+#include <sys/stat.h>
+#include "pack.h"
+#include "blob.h"
+#include "spansprite.h"
+
+// Reference counted asset cache.
+// Assets are keyed by type, path and load parameters (colorkey for
+// images, point size for fonts). Asking again for the same
+// key hands back the loaded asset with one more reference instead of
+// decoding it twice. release() drops a reference and frees the asset
+// with the last one. clear() frees whatever is left, newest first, and
+// must come before SDL_Quit. It replaces freeing surfaces by position,
+// and the leaks of the examples that never did.
+//
+// Images load the same way as load_image: the baked blob if there is
+// one, else decode, SDL_DisplayFormat, and the colorkey. Span encoding
+// is not part of the key: the first caller that asks for spans has the
+// cached surface encoded, and span_blit uses them for every caller.
+// font() exists when SDL_ttf.h is included before this header, and
+// sound() when SDL_mixer.h is.
+
+enum CachedKind {
+  CACHED_IMAGE,
+  CACHED_FONT,
+  CACHED_SOUND,
+  CACHED_KINDS
+};
+
+class AssetCache {
+private:
+  struct Entry {
+    CachedKind kind;
+    std::string key;
+    void* asset;
+    int refs;
+    size_t bytes;
+    bool baked;
+    bool spans;
+  };
+
+  std::unordered_map<std::string, Entry*> byKey;
+  std::unordered_map<void*, Entry*> byAsset;
+
+  // In load order, so clear() frees the newest first
+  std::vector<Entry*> entries;
+
+  int loads, hits;
+
+  // The cached entry for key with one more reference, NULL if not loaded
+  Entry* hit( const std::string& key ) {
+    std::unordered_map<std::string, Entry*>::iterator found = byKey.find( key );
+
+    if( found == byKey.end() ) {
+      return NULL;
+    }
+    ++found->second->refs;
+    ++hits;
+    return found->second;
+  }
+
+  Entry* add( CachedKind kind, const std::string& key, void* asset, size_t bytes, bool baked, bool spans ) {
+    Entry* entry = new Entry;
+
+    entry->kind = kind;
+    entry->key = key;
+    entry->asset = asset;
+    entry->refs = 1;
+    entry->bytes = bytes;
+    entry->baked = baked;
+    entry->spans = spans;
+
+    byKey[ key ] = entry;
+    byAsset[ asset ] = entry;
+    entries.push_back( entry );
+    ++loads;
+
+    return entry;
+  }
+
+  // Span encodes a cached image, once
+  void encode_spans( Entry* entry ) {
+    SDL_Surface* surface = (SDL_Surface*) entry->asset;
+
+    if( entry->spans ) {
+      return;
+    }
+    span_encode( surface );
+    entry->spans = true;
+
+    // Not encoded when the display is not 32 bits per pixel
+    std::unordered_map<SDL_Surface*, SpanSprite*>::iterator encoded = span_sprites().find( surface );
+    if( encoded != span_sprites().end() ) {
+      entry->bytes += encoded->second->get_span_count() * sizeof( Span );
+    }
+  }
+
+  void destroy( Entry* entry ) {
+    switch( entry->kind ) {
+    case CACHED_IMAGE: {
+      SDL_Surface* surface = (SDL_Surface*) entry->asset;
+      if( entry->spans ) {
+	span_release( surface );
+      }
+      if( entry->baked ) {
+	free_blob( surface );
+      } else {
+	SDL_FreeSurface( surface );
+      }
+      break;
+    }
+#ifdef _SDL_TTF_H
+    case CACHED_FONT:
+      TTF_CloseFont( (TTF_Font*) entry->asset );
+      break;
+#endif
+#ifdef _SDL_MIXER_H
+    case CACHED_SOUND:
+      Mix_FreeChunk( (Mix_Chunk*) entry->asset );
+      break;
+#endif
+    default:
+      break;
+    }
+
+    byKey.erase( entry->key );
+    byAsset.erase( entry->asset );
+    delete entry;
+  }
+
+  // Bytes of the asset file a font or sound was read from
+  static size_t source_bytes( const std::string& path ) {
+    size_t size = 0;
+
+    if( asset_pack().find( path, size ) == NULL ) {
+      struct stat info;
+      if( stat( path.c_str(), &info ) == 0 ) {
+	size = info.st_size;
+      }
+    }
+    return size;
+  }
+
+public:
+  AssetCache() {
+    loads = hits = 0;
+  }
+
+  ~AssetCache() {
+    clear();
+  }
+
+  // path in display format, NULL if it does not load. colorkey sets
+  // load_image's colorkey, spans span encodes it for span_blit.
+  SDL_Surface* image( const std::string& path, bool colorkey = true, bool spans = false ) {
+    std::string key = "image|" + path + ( colorkey ? "|colorkey" : "" );
+    Entry* entry = hit( key );
+    if( entry != NULL ) {
+      if( spans ) {
+	encode_spans( entry );
+      }
+      return (SDL_Surface*) entry->asset;
+    }
+
+    // Blobs are baked with the colorkey
+    SDL_Surface* surface = colorkey ? load_blob( blob_path( path ) ) : NULL;
+    bool baked = surface != NULL;
+
+    if( !baked ) {
+      SDL_Surface* loaded = IMG_Load_RW( asset_rw( path ), 1 );
+      if( loaded == NULL ) {
+	return NULL;
+      }
+
+      surface = SDL_DisplayFormat( loaded );
+      SDL_FreeSurface( loaded );
+      if( surface == NULL ) {
+	return NULL;
+      }
+
+      if( colorkey ) {
+	SDL_SetColorKey( surface, SDL_SRCCOLORKEY, SDL_MapRGB( surface->format, 200, 191, 231 ) );
+      }
+    }
+
+    entry = add( CACHED_IMAGE, key, surface, (size_t) surface->pitch * surface->h, baked, false );
+    if( spans ) {
+      encode_spans( entry );
+    }
+    return surface;
+  }
+
+#ifdef _SDL_TTF_H
+  TTF_Font* font( const std::string& path, int size ) {
+    std::string key = "font|" + path + "|" + std::to_string( size );
+    Entry* cached = hit( key );
+    if( cached != NULL ) {
+      return (TTF_Font*) cached->asset;
+    }
+
+    TTF_Font* font = TTF_OpenFontRW( asset_rw( path ), 1, size );
+    if( font == NULL ) {
+      return NULL;
+    }
+    add( CACHED_FONT, key, font, source_bytes( path ), false, false );
+    return font;
+  }
+#endif
+
+#ifdef _SDL_MIXER_H
+  Mix_Chunk* sound( const std::string& path ) {
+    std::string key = "sound|" + path;
+    Entry* cached = hit( key );
+    if( cached != NULL ) {
+      return (Mix_Chunk*) cached->asset;
+    }
+
+    Mix_Chunk* chunk = Mix_LoadWAV_RW( asset_rw( path ), 1 );
+    if( chunk == NULL ) {
+      return NULL;
+    }
+    add( CACHED_SOUND, key, chunk, chunk->alen, false, false );
+    return chunk;
+  }
+#endif
+
+  // Drops a reference to an asset from this cache, freeing it with the
+  // last one. Anything else is left alone.
+  void release( void* asset ) {
+    std::unordered_map<void*, Entry*>::iterator found = byAsset.find( asset );
+
+    if( found == byAsset.end() || --found->second->refs > 0 ) {
+      return;
+    }
+
+    entries.erase( std::find( entries.begin(), entries.end(), found->second ) );
+    destroy( found->second );
+  }
+
+  // Frees every asset still loaded, newest first, references or not
+  void clear() {
+    while( !entries.empty() ) {
+      Entry* entry = entries.back();
+      entries.pop_back();
+      destroy( entry );
+    }
+  }
+
+  int get_live_count( CachedKind kind ) const {
+    int count = 0;
+    for( int e = 0; e < entries.size(); ++e ) {
+      count += entries[ e ]->kind == kind;
+    }
+    return count;
+  }
+
+  // Pixels (and spans) for images, samples for sounds, the font file for
+  // fonts
+  size_t get_live_bytes( CachedKind kind ) const {
+    size_t bytes = 0;
+    for( int e = 0; e < entries.size(); ++e ) {
+      if( entries[ e ]->kind == kind ) {
+	bytes += entries[ e ]->bytes;
+      }
+    }
+    return bytes;
+  }
+
+  // Loads done, and loads saved by handing back a cached asset
+  int get_loads() const {
+    return loads;
+  }
+
+  int get_hits() const {
+    return hits;
+  }
+
+  // Live assets and bytes per type, and how many loads were shared
+  void report( FILE* out = stdout ) const {
+    static const char* names[ CACHED_KINDS ] = { "images", "fonts", "sounds" };
+
+    for( int k = 0; k < CACHED_KINDS; ++k ) {
+      fprintf( out, "%8s %4d live %10lu bytes\n", names[ k ], get_live_count( (CachedKind) k ),
+	       (unsigned long) get_live_bytes( (CachedKind) k ) );
+    }
+    fprintf( out, "%d loads, %d shared\n", loads, hits );
+  }
+};
+
+#endif
@@ -0,0 +1,255 @@
+#ifndef ASSETLOADER_H
+#define ASSETLOADER_H
+
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <string>
+#include <vector>
+#include <mutex>
+#include <thread>
+#include "clock.h"
+#include "threadpool.h"
+#include "pack.h"
+#include "blob.h"
+
+// Loads a batch of assets at once on a thread pool.
+// image(), sound(), music() and font() queue an asset and hand back its
+// handle. load() then reads and decodes every queued asset on a pool of
+// its own, no bigger than the batch, the calling thread included; the
+// pool is gone when load() returns. Afterwards, on the calling thread,
+// it does what needs the display: SDL_DisplayFormat and the colorkey,
+// the same as load_image. After load() each handle gives its asset with
+// get(), and the caller owns and frees it. Images may be mapped blobs,
+// free them with free_blob, which frees the other surfaces as well.
+//
+// Every decode reads its own RWops (asset_rw), so SDL_image's decoders
+// and SDL_mixer's WAV loader run side by side. TTF_Font all share
+// FreeType's library, so fonts are opened one at a time, next to the
+// rest.
+//
+// sound() and music() exist when SDL_mixer.h is included before this
+// header, and font() when SDL_ttf.h is, so examples only link what they
+// use.
+
+struct ImageHandle { int index; };
+struct SoundHandle { int index; };
+struct MusicHandle { int index; };
+struct FontHandle { int index; };
+
+enum AssetKind {
+  ASSET_IMAGE,
+  ASSET_SOUND,
+  ASSET_MUSIC,
+  ASSET_FONT
+};
+
+class AssetLoader {
+private:
+  struct Asset {
+    AssetKind kind;
+    std::string name;
+    int size;
+    bool colorkey;
+    bool baked;
+
+    // Images go from decoded to display format in surface, the rest is
+    // a Mix_Chunk, Mix_Music or TTF_Font
+    SDL_Surface* surface;
+    void* loaded;
+  };
+
+  std::vector<Asset> assets;
+  int firstQueued;
+  std::mutex fontLock;
+  std::string failed;
+  double decodeMs, finishMs;
+
+  int queue( AssetKind kind, const std::string& name, int size, bool colorkey ) {
+    Asset asset;
+
+    asset.kind = kind;
+    asset.name = name;
+    asset.size = size;
+    asset.colorkey = colorkey;
+    asset.baked = false;
+    asset.surface = NULL;
+    asset.loaded = NULL;
+    assets.push_back( asset );
+
+    return assets.size() - 1;
+  }
+
+  // On a worker: everything that does not need the display
+  void decode( Asset& asset ) {
+    switch( asset.kind ) {
+    case ASSET_IMAGE:
+      asset.surface = IMG_Load_RW( asset_rw( asset.name ), 1 );
+      break;
+#ifdef _SDL_MIXER_H
+    case ASSET_SOUND:
+      asset.loaded = Mix_LoadWAV_RW( asset_rw( asset.name ), 1 );
+      break;
+    case ASSET_MUSIC:
+      // Played from the RWops as it goes, Mix_FreeMusic closes it
+      asset.loaded = Mix_LoadMUSType_RW( asset_rw( asset.name ), MUS_NONE, SDL_TRUE );
+      break;
+#endif
+#ifdef _SDL_TTF_H
+    case ASSET_FONT: {
+      std::lock_guard<std::mutex> guard( fontLock );
+      asset.loaded = TTF_OpenFontRW( asset_rw( asset.name ), 1, asset.size );
+      break;
+    }
+#endif
+    default:
+      break;
+    }
+  }
+
+  // On the calling thread, once the decoding is done
+  bool finish( Asset& asset ) {
+    if( asset.kind != ASSET_IMAGE ) {
+      return asset.loaded != NULL;
+    }
+    if( asset.surface == NULL ) {
+      return false;
+    }
+    if( asset.baked ) {
+      return true;
+    }
+
+    SDL_Surface* optimized = SDL_DisplayFormat( asset.surface );
+    SDL_FreeSurface( asset.surface );
+    asset.surface = optimized;
+    if( optimized == NULL ) {
+      return false;
+    }
+
+    if( asset.colorkey ) {
+      SDL_SetColorKey( optimized, SDL_SRCCOLORKEY, SDL_MapRGB( optimized->format, 200, 191, 231 ) );
+    }
+    return true;
+  }
+
+public:
+  AssetLoader() {
+    firstQueued = 0;
+    decodeMs = finishMs = 0;
+  }
+
+  // An image in display format, with load_image's colorkey set
+  ImageHandle image( const std::string& name, bool colorkey = true ) {
+    ImageHandle handle = { queue( ASSET_IMAGE, name, 0, colorkey ) };
+    return handle;
+  }
+
+#ifdef _SDL_MIXER_H
+  SoundHandle sound( const std::string& name ) {
+    SoundHandle handle = { queue( ASSET_SOUND, name, 0, false ) };
+    return handle;
+  }
+
+  MusicHandle music( const std::string& name ) {
+    MusicHandle handle = { queue( ASSET_MUSIC, name, 0, false ) };
+    return handle;
+  }
+#endif
+
+#ifdef _SDL_TTF_H
+  FontHandle font( const std::string& name, int size ) {
+    FontHandle handle = { queue( ASSET_FONT, name, size, false ) };
+    return handle;
+  }
+#endif
+
+  // Loads everything queued since the last load() on up to threads
+  // threads, 0 for one per core. False if something did not load,
+  // get_failed() says which; the rest are loaded all the same.
+  bool load( int threads = 0 ) {
+    std::vector<int> pending;
+    int first = firstQueued;
+
+    firstQueued = assets.size();
+    failed.clear();
+
+    // Before any thread decodes, SDL_image loads its codecs on first use
+    IMG_Init( IMG_INIT_PNG | IMG_INIT_JPG );
+
+    // Baked images are only mapped, there is nothing to decode
+    for( int a = first; a < assets.size(); ++a ) {
+      if( assets[ a ].kind == ASSET_IMAGE && assets[ a ].colorkey ) {
+	assets[ a ].surface = load_blob( blob_path( assets[ a ].name ) );
+	assets[ a ].baked = assets[ a ].surface != NULL;
+      }
+      if( !assets[ a ].baked ) {
+	pending.push_back( a );
+      }
+    }
+
+    if( threads <= 0 ) {
+      threads = std::thread::hardware_concurrency();
+    }
+    if( threads > (int) pending.size() ) {
+      threads = pending.size();
+    }
+
+    double start = now_ms();
+    if( !pending.empty() ) {
+      ThreadPool pool( threads );
+      pool.run( pending.size(), 1, [&]( int begin, int end, int worker ) {
+	  for( int p = begin; p < end; ++p ) {
+	    decode( assets[ pending[ p ] ] );
+	  }
+	} );
+    }
+    double decoded = now_ms();
+
+    for( int a = first; a < assets.size(); ++a ) {
+      if( !finish( assets[ a ] ) && failed.empty() ) {
+	failed = assets[ a ].name;
+      }
+    }
+
+    decodeMs = decoded - start;
+    finishMs = now_ms() - decoded;
+
+    return failed.empty();
+  }
+
+  SDL_Surface* get( ImageHandle handle ) const {
+    return assets[ handle.index ].surface;
+  }
+
+#ifdef _SDL_MIXER_H
+  Mix_Chunk* get( SoundHandle handle ) const {
+    return (Mix_Chunk*) assets[ handle.index ].loaded;
+  }
+
+  Mix_Music* get( MusicHandle handle ) const {
+    return (Mix_Music*) assets[ handle.index ].loaded;
+  }
+#endif
+
+#ifdef _SDL_TTF_H
+  TTF_Font* get( FontHandle handle ) const {
+    return (TTF_Font*) assets[ handle.index ].loaded;
+  }
+#endif
+
+  // The first asset the last load() could not load, empty if none
+  const std::string& get_failed() const {
+    return failed;
+  }
+
+  // How long the last load() spent decoding on the pool, and converting
+  // on the calling thread after it
+  double get_decode_ms() const {
+    return decodeMs;
+  }
+
+  double get_finish_ms() const {
+    return finishMs;
+  }
+};
+
+#endif
@@ -0,0 +1,44 @@
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <SDL/SDL.h>
+#include "spansprite.h"
+
+// One sprite of a generated texture atlas, tables are written by
+// tools/atlas. Sprites are trimmed to their opaque pixels when packed:
+// x, y, w, h is where those pixels are in the atlas, offsetX, offsetY
+// where they were in the sprite's original cell, and width, height the
+// size of that cell.
+struct AtlasSprite {
+  int x, y;
+  int w, h;
+  int offsetX, offsetY;
+  int width, height;
+};
+
+// The sprite's pixels in the atlas, for SDL_BlitSurface
+inline SDL_Rect atlas_clip( const AtlasSprite& sprite )
+{
+  SDL_Rect clip;
+
+  clip.x = sprite.x;
+  clip.y = sprite.y;
+  clip.w = sprite.w;
+  clip.h = sprite.h;
+
+  return clip;
+}
+
+// Draws a sprite the way the untrimmed cell would be drawn at (x, y)
+inline void apply_sprite( int x, int y, SDL_Surface* atlas, const AtlasSprite& sprite, SDL_Surface* destination )
+{
+  SDL_Rect clip = atlas_clip( sprite );
+  SDL_Rect offset;
+
+  offset.x = x + sprite.offsetX;
+  offset.y = y + sprite.offsetY;
+
+  span_blit( atlas, &clip, destination, &offset );
+}
+
+#endif
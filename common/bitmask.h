@@ -0,0 +1,162 @@
+#ifndef BITMASK_H
+#define BITMASK_H
+
+#include <SDL/SDL.h>
+#include <vector>
+
+// One bit per pixel collision mask.
+// Bit i of word k in a row is pixel 64 * k + i, set when the pixel is
+// solid. Bits past the sprite's width are always zero so whole words can
+// be ANDed without masking.
+class Bitmask {
+private:
+  int w, h;
+  int wordsPerRow;
+  std::vector<Uint64> bits;
+
+  static Uint32 get_pixel( SDL_Surface* surface, int x, int y ) {
+    Uint8* p = (Uint8*) surface->pixels + y * surface->pitch + x * surface->format->BytesPerPixel;
+
+    switch( surface->format->BytesPerPixel ) {
+    case 1:
+      return *p;
+    case 2:
+      return *(Uint16*) p;
+    case 3:
+      if( SDL_BYTEORDER == SDL_BIG_ENDIAN ) {
+	return p[ 0 ] << 16 | p[ 1 ] << 8 | p[ 2 ];
+      }
+      return p[ 0 ] | p[ 1 ] << 8 | p[ 2 ] << 16;
+    default:
+      return *(Uint32*) p;
+    }
+  }
+
+public:
+  Bitmask() {
+    w = h = wordsPerRow = 0;
+  }
+
+  // Solid pixels are the ones that are not the surface's colorkey (when
+  // SDL_SRCCOLORKEY is set) and not fully transparent (when it has alpha).
+  Bitmask( SDL_Surface* surface ) {
+    w = surface->w;
+    h = surface->h;
+    wordsPerRow = ( w + 63 ) / 64;
+    bits.assign( wordsPerRow * h, 0 );
+
+    SDL_PixelFormat* fmt = surface->format;
+    bool keyed = ( surface->flags & SDL_SRCCOLORKEY ) != 0;
+    Uint32 key = fmt->colorkey & ~fmt->Amask;
+
+    if( SDL_MUSTLOCK( surface ) ) {
+      SDL_LockSurface( surface );
+    }
+
+    for( int y = 0; y < h; ++y ) {
+      for( int x = 0; x < w; ++x ) {
+	Uint32 pixel = get_pixel( surface, x, y );
+
+	if( keyed && ( pixel & ~fmt->Amask ) == key ) {
+	  continue;
+	}
+	if( fmt->Amask && ( pixel & fmt->Amask ) == 0 ) {
+	  continue;
+	}
+
+	set( x, y );
+      }
+    }
+
+    if( SDL_MUSTLOCK( surface ) ) {
+      SDL_UnlockSurface( surface );
+    }
+  }
+
+  // Empty mask of the given size, filled with set()
+  Bitmask( int width, int height ) {
+    w = width;
+    h = height;
+    wordsPerRow = ( w + 63 ) / 64;
+    bits.assign( wordsPerRow * h, 0 );
+  }
+
+  int width() const { return w; }
+  int height() const { return h; }
+
+  void set( int x, int y ) {
+    bits[ y * wordsPerRow + ( x >> 6 ) ] |= (Uint64) 1 << ( x & 63 );
+  }
+
+  bool get( int x, int y ) const {
+    if( x < 0 || y < 0 || x >= w || y >= h ) {
+      return false;
+    }
+    return ( bits[ y * wordsPerRow + ( x >> 6 ) ] >> ( x & 63 ) ) & 1;
+  }
+
+  // 64 bits of row y starting at pixel x, pixels outside the mask read 0
+  Uint64 row_bits( int y, int x ) const {
+    if( x >= w || x <= -64 ) {
+      return 0;
+    }
+
+    const Uint64* row = &bits[ y * wordsPerRow ];
+
+    if( x < 0 ) {
+      return row[ 0 ] << -x;
+    }
+
+    int word = x >> 6, offset = x & 63;
+    Uint64 result = row[ word ] >> offset;
+
+    if( offset && word + 1 < wordsPerRow ) {
+      result |= row[ word + 1 ] << ( 64 - offset );
+    }
+
+    return result;
+  }
+
+  const Uint64* row( int y ) const {
+    return &bits[ y * wordsPerRow ];
+  }
+
+  int words_per_row() const {
+    return wordsPerRow;
+  }
+};
+
+// Exact pixel test of mask a at (ax, ay) against mask b at (bx, by).
+// Rejects on the bounding boxes first, then ANDs a's rows with b's rows
+// shifted by the relative offset, 64 pixels at a time.
+inline bool check_collision( const Bitmask& a, int ax, int ay, const Bitmask& b, int bx, int by )
+{
+  int left = ax > bx ? ax : bx;
+  int top = ay > by ? ay : by;
+  int right = ax + a.width() < bx + b.width() ? ax + a.width() : bx + b.width();
+  int bottom = ay + a.height() < by + b.height() ? ay + a.height() : by + b.height();
+
+  if( left >= right || top >= bottom ) {
+    return false;
+  }
+
+  // Words of a's rows that cover the overlap
+  int firstWord = ( left - ax ) >> 6;
+  int lastWord = ( right - ax - 1 ) >> 6;
+  int dx = bx - ax;
+
+  for( int y = top; y < bottom; ++y ) {
+    const Uint64* rowA = a.row( y - ay );
+    int rowB = y - by;
+
+    for( int word = firstWord; word <= lastWord; ++word ) {
+      if( rowA[ word ] & b.row_bits( rowB, word * 64 - dx ) ) {
+	return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+#endif
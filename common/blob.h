@@ -0,0 +1,207 @@
+#ifndef BLOB_H
+#define BLOB_H
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <unordered_map>
+#include <utility>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pack.h"
+
+// Prebaked image blobs.
+// tools/bake writes an image already converted to the display's pixel
+// format, colorkey set, as a header followed by the pixel rows. load_blob
+// maps the file and wraps the rows with SDL_CreateRGBSurfaceFrom, so
+// loading is an mmap: no decoding, no conversion, no copy. The mapping is
+// private and writable, pages are only copied if something draws on the
+// surface.
+//
+// A blob in the asset pack is wrapped where the pack maps it.
+//
+// The format is the one of the machine the blobs were baked for; when the
+// display's differs load_blob returns NULL and callers load the image the
+// usual way.
+
+const Uint32 BLOB_MAGIC = 0x424C4453; // "SDLB"
+const Uint32 BLOB_VERSION = 1;
+
+// The pixel rows start at a multiple of BLOB_ALIGN in the file and
+// each row at a multiple of BLOB_ROW_ALIGN, for the SIMD blitters
+const int BLOB_ALIGN = 64;
+const int BLOB_ROW_ALIGN = 16;
+
+struct BlobHeader {
+  Uint32 magic, version;
+  Uint32 w, h, pitch;
+  Uint32 bpp, Rmask, Gmask, Bmask, Amask;
+
+  // SDL_SRCCOLORKEY and the key in the blob's format, or 0
+  Uint32 flags, colorkey;
+
+  // Where the rows start, from the start of the file
+  Uint32 offset;
+};
+
+// "dir/dot.png" is baked to "dir/dot.blob"
+inline std::string blob_path( const std::string& image )
+{
+  size_t dot = image.rfind( '.' );
+  size_t slash = image.rfind( '/' );
+
+  if( dot == std::string::npos || ( slash != std::string::npos && dot < slash ) ) {
+    return image + ".blob";
+  }
+  return image.substr( 0, dot ) + ".blob";
+}
+
+// Writes image, colorkey included, as a blob; what tools/bake runs on
+// the SDL_DisplayFormat of each image
+inline bool save_blob( SDL_Surface* image, const std::string& path )
+{
+  const SDL_PixelFormat* f = image->format;
+  BlobHeader header;
+  memset( &header, 0, sizeof( header ) );
+
+  header.magic = BLOB_MAGIC;
+  header.version = BLOB_VERSION;
+  header.w = image->w;
+  header.h = image->h;
+  header.bpp = f->BitsPerPixel;
+  header.Rmask = f->Rmask;
+  header.Gmask = f->Gmask;
+  header.Bmask = f->Bmask;
+  header.Amask = f->Amask;
+  if( image->flags & SDL_SRCCOLORKEY ) {
+    header.flags = SDL_SRCCOLORKEY;
+    header.colorkey = f->colorkey;
+  }
+
+  Uint32 row = image->w * f->BytesPerPixel;
+  header.pitch = ( row + BLOB_ROW_ALIGN - 1 ) / BLOB_ROW_ALIGN * BLOB_ROW_ALIGN;
+  header.offset = ( sizeof( header ) + BLOB_ALIGN - 1 ) / BLOB_ALIGN * BLOB_ALIGN;
+
+  FILE* out = fopen( path.c_str(), "wb" );
+  if( out == NULL ) {
+    return false;
+  }
+
+  std::vector<Uint8> padding( header.offset - sizeof( header ), 0 );
+  fwrite( &header, sizeof( header ), 1, out );
+  fwrite( padding.data(), 1, padding.size(), out );
+
+  std::vector<Uint8> line( header.pitch, 0 );
+  for( int y = 0; y < image->h; ++y ) {
+    memcpy( line.data(), (Uint8*) image->pixels + y * image->pitch, row );
+    fwrite( line.data(), 1, line.size(), out );
+  }
+
+  bool written = !ferror( out );
+  return fclose( out ) == 0 && written;
+}
+
+// Does a blob in this format fit the display as SDL_DisplayFormat would
+inline bool blob_matches_display( const BlobHeader& header )
+{
+  SDL_Surface* screen = SDL_GetVideoSurface();
+
+  if( screen == NULL ) {
+    return false;
+  }
+
+  const SDL_PixelFormat* f = screen->format;
+  return header.bpp == f->BitsPerPixel && header.Rmask == f->Rmask &&
+    header.Gmask == f->Gmask && header.Bmask == f->Bmask && header.Amask == f->Amask;
+}
+
+// Wraps the blob at data, NULL if it is not one or does not fit the
+// display
+inline SDL_Surface* blob_surface( void* data, size_t size )
+{
+  const BlobHeader* header = (const BlobHeader*) data;
+
+  if( size < sizeof( BlobHeader ) || header->magic != BLOB_MAGIC || header->version != BLOB_VERSION ||
+      (size_t) header->offset + (size_t) header->pitch * header->h > size ||
+      !blob_matches_display( *header ) ) {
+    return NULL;
+  }
+
+  SDL_Surface* surface = SDL_CreateRGBSurfaceFrom( (Uint8*) data + header->offset, header->w, header->h,
+						   header->bpp, header->pitch,
+						   header->Rmask, header->Gmask, header->Bmask, header->Amask );
+  if( surface != NULL && ( header->flags & SDL_SRCCOLORKEY ) ) {
+    SDL_SetColorKey( surface, SDL_SRCCOLORKEY, header->colorkey );
+  }
+
+  return surface;
+}
+
+// The mapping and its size of each blob load_blob mapped from its own
+// file, by the surface's pixels
+inline std::unordered_map< void*, std::pair<void*, size_t> >& blob_mappings()
+{
+  static std::unordered_map< void*, std::pair<void*, size_t> > mappings;
+  return mappings;
+}
+
+// The image baked at path, from the asset pack or else its own file; NULL
+// if there is none or it does not fit the display. Free it with
+// free_blob.
+inline SDL_Surface* load_blob( const std::string& path )
+{
+  size_t size = 0;
+  void* packed = asset_pack().find( path, size );
+  if( packed != NULL ) {
+    return blob_surface( packed, size );
+  }
+
+  int file = open( path.c_str(), O_RDONLY );
+  if( file < 0 ) {
+    return NULL;
+  }
+
+  struct stat info;
+  if( fstat( file, &info ) < 0 || info.st_size < (off_t) sizeof( BlobHeader ) ) {
+    close( file );
+    return NULL;
+  }
+
+  void* mapped = mmap( NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0 );
+  close( file );
+  if( mapped == MAP_FAILED ) {
+    return NULL;
+  }
+
+  SDL_Surface* surface = blob_surface( mapped, info.st_size );
+  if( surface == NULL ) {
+    munmap( mapped, info.st_size );
+    return NULL;
+  }
+
+  blob_mappings()[ surface->pixels ] = std::make_pair( mapped, (size_t) info.st_size );
+  return surface;
+}
+
+// Frees a surface from load_blob and unmaps its file. Surfaces from the
+// pack, or from anywhere else, are only freed; the pack stays mapped.
+inline void free_blob( SDL_Surface* surface )
+{
+  if( surface == NULL ) {
+    return;
+  }
+
+  std::unordered_map< void*, std::pair<void*, size_t> >::iterator mapping = blob_mappings().find( surface->pixels );
+  SDL_FreeSurface( surface );
+
+  if( mapping != blob_mappings().end() ) {
+    munmap( mapping->second.first, mapping->second.second );
+    blob_mappings().erase( mapping );
+  }
+}
+
+#endif
@@ -0,0 +1,11 @@
+#ifndef BOXTABLE_H
+#define BOXTABLE_H
+
+// One collision box of a generated table, relative to the sprite's top left.
+// Tables are written by tools/boxgen from the sprite images.
+struct BoxTableEntry {
+  int x, y;
+  int w, h;
+};
+
+#endif
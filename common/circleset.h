@@ -0,0 +1,422 @@
+#ifndef CIRCLESET_H
+#define CIRCLESET_H
+
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <utility>
+#include "rectset.h"
+
+// Structure of arrays circle set with integer squared distance tests.
+// x/y/r live in separate 32 byte aligned int arrays padded to
+// CIRCLESET_BLOCK, and every query tests a whole block at once with the
+// same SSE2/AVX2/scalar kernels choice as RectSet.
+//
+// Distances are compared squared: sqrt( d2 ) < r is d2 < r * r for
+// integers. Each axis distance is clamped to CIRCLESET_FAR before
+// squaring so the sum fits an int; radii up to CIRCLESET_FAR / 2 keep
+// every test exact.
+
+const int CIRCLESET_BLOCK = 16;
+const int CIRCLESET_FAR = 32767;
+
+inline int circleset_clamp( int d )
+{
+  d = d < -CIRCLESET_FAR ? -CIRCLESET_FAR : d;
+  return d > CIRCLESET_FAR ? CIRCLESET_FAR : d;
+}
+
+class CircleSet {
+private:
+  int* data;
+  int count;
+  int capacity;
+
+  void reserve( int wanted ) {
+    if( wanted <= capacity ) {
+      return;
+    }
+
+    int newCapacity = capacity ? capacity : CIRCLESET_BLOCK;
+    while( newCapacity < wanted ) {
+      newCapacity *= 2;
+    }
+
+    void* block = NULL;
+    if( posix_memalign( &block, 32, sizeof( int ) * 3 * newCapacity ) != 0 ) {
+      abort();
+    }
+
+    // Padding circles sit far away with radius 0, so they never hit
+    int* newData = (int*) block;
+    for( int i = 0; i < newCapacity; ++i ) {
+      newData[ i ] = newData[ newCapacity + i ] = -CIRCLESET_FAR * 4;
+      newData[ newCapacity * 2 + i ] = 0;
+    }
+
+    if( data != NULL ) {
+      for( int k = 0; k < 3; ++k ) {
+	memcpy( newData + k * newCapacity, data + k * capacity, sizeof( int ) * count );
+      }
+    }
+
+    free( data );
+    data = newData;
+    capacity = newCapacity;
+  }
+
+public:
+  CircleSet() {
+    data = NULL;
+    count = capacity = 0;
+  }
+
+  CircleSet( const CircleSet& other ) {
+    data = NULL;
+    count = capacity = 0;
+    *this = other;
+  }
+
+  CircleSet& operator=( const CircleSet& other ) {
+    if( this != &other ) {
+      clear();
+      reserve( other.capacity );
+      for( int k = 0; k < 3 && other.count; ++k ) {
+	memcpy( data + k * capacity, other.data + k * other.capacity, sizeof( int ) * other.count );
+      }
+      count = other.count;
+    }
+    return *this;
+  }
+
+  ~CircleSet() {
+    free( data );
+  }
+
+  int size() const {
+    return count;
+  }
+
+  int padded_size() const {
+    return ( count + CIRCLESET_BLOCK - 1 ) / CIRCLESET_BLOCK * CIRCLESET_BLOCK;
+  }
+
+  const int* x() const { return data; }
+  const int* y() const { return data + capacity; }
+  const int* r() const { return data + capacity * 2; }
+
+  void clear() {
+    for( int i = 0; i < count; ++i ) {
+      data[ i ] = data[ capacity + i ] = -CIRCLESET_FAR * 4;
+      data[ capacity * 2 + i ] = 0;
+    }
+    count = 0;
+  }
+
+  void push_back( int cx, int cy, int cr ) {
+    reserve( count + 1 );
+    ++count;
+    set( count - 1, cx, cy, cr );
+  }
+
+  // Overwrites circle i, for sets whose members move
+  void set( int i, int cx, int cy, int cr ) {
+    data[ i ] = cx;
+    data[ capacity + i ] = cy;
+    data[ capacity * 2 + i ] = cr;
+  }
+};
+
+// Bit i of the result is set when circle (cx, cy, cr) overlaps circle
+// first + i of set, for the CIRCLESET_BLOCK circles starting at first.
+inline unsigned int circleset_block_scalar( const CircleSet& set, int first, int cx, int cy, int cr )
+{
+  const int* x = set.x() + first;
+  const int* y = set.y() + first;
+  const int* r = set.r() + first;
+  unsigned int bits = 0;
+
+  for( int i = 0; i < CIRCLESET_BLOCK; ++i ) {
+    int dx = circleset_clamp( x[ i ] - cx );
+    int dy = circleset_clamp( y[ i ] - cy );
+    int rr = r[ i ] + cr;
+
+    if( dx * dx + dy * dy < rr * rr ) {
+      bits |= 1u << i;
+    }
+  }
+
+  return bits;
+}
+
+// Same for the rects first..first + CIRCLESET_BLOCK of set, using the
+// rect point nearest to the circle's center. Bits past set.size() are
+// left to the caller to mask off.
+inline unsigned int circleset_rect_block_scalar( const RectSet& set, int first, int cx, int cy, int cr )
+{
+  int n = set.size() - first < CIRCLESET_BLOCK ? set.size() - first : CIRCLESET_BLOCK;
+  unsigned int bits = 0;
+
+  for( int i = 0; i < n; ++i ) {
+    int x0 = set.x0()[ first + i ], x1 = set.x1()[ first + i ];
+    int y0 = set.y0()[ first + i ], y1 = set.y1()[ first + i ];
+
+    int dx = cx < x0 ? x0 - cx : ( cx > x1 ? cx - x1 : 0 );
+    int dy = cy < y0 ? y0 - cy : ( cy > y1 ? cy - y1 : 0 );
+
+    dx = dx > CIRCLESET_FAR ? CIRCLESET_FAR : dx;
+    dy = dy > CIRCLESET_FAR ? CIRCLESET_FAR : dy;
+
+    if( dx * dx + dy * dy < cr * cr ) {
+      bits |= 1u << i;
+    }
+  }
+
+  return bits;
+}
+
+#ifdef RECTSET_X86
+// The SIMD kernels saturate dx and dy to 16 bits with packs, interleave
+// them and let madd compute dx * dx + dy * dy in one instruction.
+// Clamping to -32767 keeps madd from overflowing on -32768 pairs.
+
+inline __m128i circleset_sum_squares_sse2( __m128i dx, __m128i dy )
+{
+  __m128i lowest = _mm_set1_epi16( -CIRCLESET_FAR );
+  __m128i dx16 = _mm_max_epi16( _mm_packs_epi32( dx, dx ), lowest );
+  __m128i dy16 = _mm_max_epi16( _mm_packs_epi32( dy, dy ), lowest );
+  __m128i pairs = _mm_unpacklo_epi16( dx16, dy16 );
+
+  return _mm_madd_epi16( pairs, pairs );
+}
+
+inline unsigned int circleset_block_sse2( const CircleSet& set, int first, int cx, int cy, int cr )
+{
+  __m128i vcx = _mm_set1_epi32( cx ), vcy = _mm_set1_epi32( cy ), vcr = _mm_set1_epi32( cr );
+  unsigned int bits = 0;
+
+  for( int i = 0; i < CIRCLESET_BLOCK; i += 4 ) {
+    __m128i x = _mm_load_si128( (const __m128i*) ( set.x() + first + i ) );
+    __m128i y = _mm_load_si128( (const __m128i*) ( set.y() + first + i ) );
+    __m128i r = _mm_load_si128( (const __m128i*) ( set.r() + first + i ) );
+
+    __m128i d2 = circleset_sum_squares_sse2( _mm_sub_epi32( x, vcx ), _mm_sub_epi32( y, vcy ) );
+    __m128i rr = _mm_add_epi32( r, vcr );
+    __m128i rr2 = _mm_madd_epi16( rr, rr );
+
+    bits |= (unsigned int) _mm_movemask_ps( _mm_castsi128_ps( _mm_cmplt_epi32( d2, rr2 ) ) ) << i;
+  }
+
+  return bits;
+}
+
+inline unsigned int circleset_rect_block_sse2( const RectSet& set, int first, int cx, int cy, int cr )
+{
+  __m128i vcx = _mm_set1_epi32( cx ), vcy = _mm_set1_epi32( cy );
+  __m128i rr2 = _mm_set1_epi32( cr * cr );
+  __m128i zero = _mm_setzero_si128();
+  unsigned int bits = 0;
+
+  for( int i = 0; i < CIRCLESET_BLOCK; i += 4 ) {
+    __m128i x0 = _mm_load_si128( (const __m128i*) ( set.x0() + first + i ) );
+    __m128i y0 = _mm_load_si128( (const __m128i*) ( set.y0() + first + i ) );
+    __m128i x1 = _mm_load_si128( (const __m128i*) ( set.x1() + first + i ) );
+    __m128i y1 = _mm_load_si128( (const __m128i*) ( set.y1() + first + i ) );
+
+    // Distance outside the rect on each axis, 0 when inside
+    __m128i dx = _mm_max_epi16( _mm_packs_epi32( _mm_sub_epi32( x0, vcx ), _mm_sub_epi32( vcx, x1 ) ), zero );
+    __m128i dy = _mm_max_epi16( _mm_packs_epi32( _mm_sub_epi32( y0, vcy ), _mm_sub_epi32( vcy, y1 ) ), zero );
+    dx = _mm_max_epi16( dx, _mm_unpackhi_epi64( dx, dx ) );
+    dy = _mm_max_epi16( dy, _mm_unpackhi_epi64( dy, dy ) );
+
+    __m128i pairs = _mm_unpacklo_epi16( dx, dy );
+    __m128i d2 = _mm_madd_epi16( pairs, pairs );
+
+    bits |= (unsigned int) _mm_movemask_ps( _mm_castsi128_ps( _mm_cmplt_epi32( d2, rr2 ) ) ) << i;
+  }
+
+  return bits;
+}
+
+__attribute__((target("avx2")))
+inline unsigned int circleset_block_avx2( const CircleSet& set, int first, int cx, int cy, int cr )
+{
+  __m256i vcx = _mm256_set1_epi32( cx ), vcy = _mm256_set1_epi32( cy ), vcr = _mm256_set1_epi32( cr );
+  __m256i lowest = _mm256_set1_epi16( -CIRCLESET_FAR );
+  unsigned int bits = 0;
+
+  for( int i = 0; i < CIRCLESET_BLOCK; i += 8 ) {
+    __m256i x = _mm256_load_si256( (const __m256i*) ( set.x() + first + i ) );
+    __m256i y = _mm256_load_si256( (const __m256i*) ( set.y() + first + i ) );
+    __m256i r = _mm256_load_si256( (const __m256i*) ( set.r() + first + i ) );
+
+    __m256i dx = _mm256_sub_epi32( x, vcx ), dy = _mm256_sub_epi32( y, vcy );
+    __m256i dx16 = _mm256_max_epi16( _mm256_packs_epi32( dx, dx ), lowest );
+    __m256i dy16 = _mm256_max_epi16( _mm256_packs_epi32( dy, dy ), lowest );
+    __m256i pairs = _mm256_unpacklo_epi16( dx16, dy16 );
+
+    __m256i d2 = _mm256_madd_epi16( pairs, pairs );
+    __m256i rr = _mm256_add_epi32( r, vcr );
+    __m256i rr2 = _mm256_madd_epi16( rr, rr );
+
+    bits |= (unsigned int) _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpgt_epi32( rr2, d2 ) ) ) << i;
+  }
+
+  return bits;
+}
+
+__attribute__((target("avx2")))
+inline unsigned int circleset_rect_block_avx2( const RectSet& set, int first, int cx, int cy, int cr )
+{
+  __m256i vcx = _mm256_set1_epi32( cx ), vcy = _mm256_set1_epi32( cy );
+  __m256i rr2 = _mm256_set1_epi32( cr * cr );
+  __m256i zero = _mm256_setzero_si256();
+  unsigned int bits = 0;
+
+  for( int i = 0; i < CIRCLESET_BLOCK; i += 8 ) {
+    __m256i x0 = _mm256_load_si256( (const __m256i*) ( set.x0() + first + i ) );
+    __m256i y0 = _mm256_load_si256( (const __m256i*) ( set.y0() + first + i ) );
+    __m256i x1 = _mm256_load_si256( (const __m256i*) ( set.x1() + first + i ) );
+    __m256i y1 = _mm256_load_si256( (const __m256i*) ( set.y1() + first + i ) );
+
+    __m256i dx = _mm256_max_epi16( _mm256_packs_epi32( _mm256_sub_epi32( x0, vcx ), _mm256_sub_epi32( vcx, x1 ) ), zero );
+    __m256i dy = _mm256_max_epi16( _mm256_packs_epi32( _mm256_sub_epi32( y0, vcy ), _mm256_sub_epi32( vcy, y1 ) ), zero );
+    dx = _mm256_max_epi16( dx, _mm256_unpackhi_epi64( dx, dx ) );
+    dy = _mm256_max_epi16( dy, _mm256_unpackhi_epi64( dy, dy ) );
+
+    __m256i pairs = _mm256_unpacklo_epi16( dx, dy );
+    __m256i d2 = _mm256_madd_epi16( pairs, pairs );
+
+    bits |= (unsigned int) _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpgt_epi32( rr2, d2 ) ) ) << i;
+  }
+
+  return bits;
+}
+#endif
+
+typedef unsigned int (*CircleSetBlockFunc)( const CircleSet&, int, int, int, int );
+typedef unsigned int (*CircleRectBlockFunc)( const RectSet&, int, int, int, int );
+
+// Kernels follow the choice made for rect sets, see rectset_use_kernel()
+inline CircleSetBlockFunc circleset_block_func()
+{
+  switch( rectset_kernel() ) {
+#ifdef RECTSET_X86
+  case RECTSET_AVX2:
+    return circleset_block_avx2;
+  case RECTSET_SSE2:
+    return circleset_block_sse2;
+#endif
+  default:
+    return circleset_block_scalar;
+  }
+}
+
+inline CircleRectBlockFunc circleset_rect_block_func()
+{
+  switch( rectset_kernel() ) {
+#ifdef RECTSET_X86
+  case RECTSET_AVX2:
+    return circleset_rect_block_avx2;
+  case RECTSET_SSE2:
+    return circleset_rect_block_sse2;
+#endif
+  default:
+    return circleset_rect_block_scalar;
+  }
+}
+
+// Lanes of the block at first that hold real rects of set
+inline unsigned int circleset_live_bits( const RectSet& set, int first )
+{
+  int n = set.size() - first;
+  return n >= CIRCLESET_BLOCK ? ( 1u << CIRCLESET_BLOCK ) - 1 : ( 1u << n ) - 1;
+}
+
+// Does circle (cx, cy, cr) overlap any circle of set
+inline bool check_collision( int cx, int cy, int cr, const CircleSet& set )
+{
+  CircleSetBlockFunc block = circleset_block_func();
+
+  for( int first = 0; first < set.size(); first += CIRCLESET_BLOCK ) {
+    if( block( set, first, cx, cy, cr ) ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Appends the index of every circle of set that circle (cx, cy, cr) overlaps
+inline void find_overlaps( int cx, int cy, int cr, const CircleSet& set, std::vector<int>& hits )
+{
+  CircleSetBlockFunc block = circleset_block_func();
+
+  for( int first = 0; first < set.size(); first += CIRCLESET_BLOCK ) {
+    unsigned int bits = block( set, first, cx, cy, cr );
+
+    while( bits ) {
+      hits.push_back( first + __builtin_ctz( bits ) );
+      bits &= bits - 1;
+    }
+  }
+}
+
+// Does circle (cx, cy, cr) overlap any rect of set
+inline bool check_collision( int cx, int cy, int cr, const RectSet& set )
+{
+  CircleRectBlockFunc block = circleset_rect_block_func();
+
+  for( int first = 0; first < set.size(); first += CIRCLESET_BLOCK ) {
+    if( block( set, first, cx, cy, cr ) & circleset_live_bits( set, first ) ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Appends the index of every rect of set that circle (cx, cy, cr) overlaps
+inline void find_overlaps( int cx, int cy, int cr, const RectSet& set, std::vector<int>& hits )
+{
+  CircleRectBlockFunc block = circleset_rect_block_func();
+
+  for( int first = 0; first < set.size(); first += CIRCLESET_BLOCK ) {
+    unsigned int bits = block( set, first, cx, cy, cr ) & circleset_live_bits( set, first );
+
+    while( bits ) {
+      hits.push_back( first + __builtin_ctz( bits ) );
+      bits &= bits - 1;
+    }
+  }
+}
+
+// Appends every pair (i, j) of a circle of a overlapping a circle of b.
+// With a and b the same set, pass self = true to get each pair once and
+// skip circles against themselves.
+inline void find_overlaps( const CircleSet& a, const CircleSet& b, std::vector< std::pair<int, int> >& pairs, bool self = false )
+{
+  CircleSetBlockFunc block = circleset_block_func();
+
+  for( int i = 0; i < a.size(); ++i ) {
+    int cx = a.x()[ i ], cy = a.y()[ i ], cr = a.r()[ i ];
+    int start = self ? ( i + 1 ) / CIRCLESET_BLOCK * CIRCLESET_BLOCK : 0;
+
+    for( int first = start; first < b.size(); first += CIRCLESET_BLOCK ) {
+      unsigned int bits = block( b, first, cx, cy, cr );
+
+      if( self && first <= i ) {
+	// Only pairs with j > i
+	bits &= ~0u << ( i + 1 - first );
+      }
+
+      while( bits ) {
+	pairs.push_back( std::make_pair( i, first + __builtin_ctz( bits ) ) );
+	bits &= bits - 1;
+      }
+    }
+  }
+}
+
+#endif
@@ -0,0 +1,12 @@
+#ifndef CLOCK_H
+#define CLOCK_H
+
+#include <chrono>
+
+// Milliseconds on a monotonic clock, for timing frames, loads and the
+// benchmarks. Only differences between two calls mean anything.
+inline double now_ms() {
+  return std::chrono::duration<double, std::milli>( std::chrono::steady_clock::now().time_since_epoch() ).count();
+}
+
+#endif
@@ -0,0 +1,336 @@
+#ifndef COLLISION_H
+#define COLLISION_H
+
+#include <SDL/SDL.h>
+#include <limits.h>
+#include <vector>
+#include <algorithm>
+
+// The collision tests of 17, 18 and 19, shared so they can be benchmarked
+// without opening a window. Only SDL's types are used, nothing here needs
+// SDL_Init or a display. Touching is not a collision.
+
+struct Circle {
+  int x, y;
+  int r;
+};
+
+// 17: box against box
+inline bool check_collision( SDL_Rect a, SDL_Rect b ) {
+  // The sides of the rectangles
+  int left_a, left_b;
+  int top_a, top_b;
+  int right_a, right_b;
+  int bottom_a, bottom_b;
+
+  // Calc sides a
+  left_a = a.x;
+  right_a = a.x + a.w;
+  top_a = a.y;
+  bottom_a = a.y + a.h;
+
+  // Calc sides b
+  left_b = b.x;
+  right_b = b.x + b.w;
+  top_b = b.y;
+  bottom_b = b.y + b.h;
+
+  if( bottom_a <= top_b ) {
+    return false;
+  }
+
+  if( top_a >= bottom_b ) {
+    return false;
+  }
+
+  if( right_a <= left_b ) {
+    return false;
+  }
+
+  if( left_a >= right_b ) {
+    return false;
+  }
+
+  return true;
+}
+
+// 18: per pixel box set against box set
+inline bool check_collision( const std::vector<SDL_Rect> &a, const std::vector<SDL_Rect> &b ) {
+  // The sides of the rectangles
+  int left_a, left_b;
+  int top_a, top_b;
+  int right_a, right_b;
+  int bottom_a, bottom_b;
+
+  for( int aBox = 0; aBox < a.size(); ++aBox ) {
+
+    // Calc sides a
+    left_a = a[ aBox ].x;
+    right_a = a[ aBox ].x + a[ aBox ].w;
+    top_a = a[ aBox ].y;
+    bottom_a = a[ aBox ].y + a[ aBox ].h;
+
+    for( int bBox = 0; bBox < b.size(); ++bBox ) {
+
+      // Calc sides b
+      left_b = b[ bBox ].x;
+      right_b = b[ bBox ].x + b[ bBox ].w;
+      top_b = b[ bBox ].y;
+      bottom_b = b[ bBox ].y + b[ bBox ].h;
+
+      if( (bottom_a <= top_b ||
+	   top_a >= bottom_b ||
+	   right_a <= left_b ||
+	   left_a >= right_b) == false ) {
+	return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// 18: box sets in local space, a placed at (ax, ay) and b at (bx, by).
+// Lets shapes move by changing two ints instead of rewriting their boxes.
+inline bool check_collision( const std::vector<SDL_Rect> &a, int ax, int ay, const std::vector<SDL_Rect> &b, int bx, int by ) {
+  // b relative to a
+  int dx = bx - ax, dy = by - ay;
+
+  for( int aBox = 0; aBox < a.size(); ++aBox ) {
+    int left_a = a[ aBox ].x, right_a = left_a + a[ aBox ].w;
+    int top_a = a[ aBox ].y, bottom_a = top_a + a[ aBox ].h;
+
+    for( int bBox = 0; bBox < b.size(); ++bBox ) {
+      int left_b = b[ bBox ].x + dx, right_b = left_b + b[ bBox ].w;
+      int top_b = b[ bBox ].y + dy, bottom_b = top_b + b[ bBox ].h;
+
+      if( (bottom_a <= top_b ||
+	   top_a >= bottom_b ||
+	   right_a <= left_b ||
+	   left_a >= right_b) == false ) {
+	return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// Squared distance, compared against squared radii so no sqrt is needed
+inline int distance_squared( int x1, int y1, int x2, int y2 )
+{
+  int dx = x2 - x1, dy = y2 - y1;
+  return dx * dx + dy * dy;
+}
+
+// 19: circle against circle
+inline bool check_collision( const Circle& a, const Circle& b )
+{
+  if( distance_squared( a.x, a.y, b.x, b.y ) < (a.r + b.r) * (a.r + b.r) ) {
+    return true;
+  }
+  return false;
+}
+
+// 19: circle against boxes, closest point on each box
+inline bool check_collision( const Circle& a, const std::vector<SDL_Rect>& b ) {
+  int cx, cy;
+
+  for(int bBox = 0; bBox < b.size(); ++bBox ) {
+    if( a.x < b[ bBox ].x ) {
+      cx = b[ bBox ].x;
+    } else if( a.x > b[ bBox ].x + b[ bBox ].w ) {
+      cx = b[ bBox ].x + b[ bBox ].w;
+    } else {
+      cx = a.x;
+    }
+
+    if( a.y < b[ bBox ].y ) {
+      cy = b[ bBox ].y;
+    } else if( a.y > b[ bBox ].y + b[ bBox ].h ) {
+      cy = b[ bBox ].y + b[ bBox ].h;
+    } else {
+      cy = a.y;
+    }
+
+    if( distance_squared( a.x, a.y, cx, cy ) < a.r * a.r ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Compound shape for the box set tests: local boxes under a two level
+// bounding hierarchy. The outer box bounds all of them and, if asked
+// for, strips group the boxes into horizontal bands of stripHeight rows
+// with bounds of their own. Tests reject on the outer boxes first, then
+// on strips, and only look at single boxes inside strips that overlap,
+// so shapes that are apart cost one box test instead of every pair.
+class BoxShape {
+public:
+  struct Bounds {
+    int x0, y0, x1, y1;
+  };
+
+  struct Strip {
+    Bounds bounds;
+    int first, count;
+  };
+
+private:
+  std::vector<SDL_Rect> boxes;
+  std::vector<Strip> strips;
+  Bounds outer;
+
+  static void grow( Bounds& b, const SDL_Rect& r ) {
+    if( r.x < b.x0 ) b.x0 = r.x;
+    if( r.y < b.y0 ) b.y0 = r.y;
+    if( r.x + r.w > b.x1 ) b.x1 = r.x + r.w;
+    if( r.y + r.h > b.y1 ) b.y1 = r.y + r.h;
+  }
+
+public:
+  BoxShape() {
+    outer.x0 = outer.y0 = outer.x1 = outer.y1 = 0;
+  }
+
+  BoxShape( const std::vector<SDL_Rect>& theBoxes, int stripHeight = 0 ) {
+    assign( theBoxes, stripHeight );
+  }
+
+  // Sets the boxes, stripHeight 0 for a single strip (outer box only)
+  void assign( const std::vector<SDL_Rect>& theBoxes, int stripHeight = 0 ) {
+    boxes = theBoxes;
+    strips.clear();
+    outer.x0 = outer.y0 = outer.x1 = outer.y1 = 0;
+
+    if( boxes.empty() ) {
+      return;
+    }
+
+    outer.x0 = outer.y0 = INT_MAX;
+    outer.x1 = outer.y1 = INT_MIN;
+    for( int b = 0; b < boxes.size(); ++b ) {
+      grow( outer, boxes[ b ] );
+    }
+
+    if( stripHeight <= 0 ) {
+      Strip all = { outer, 0, (int) boxes.size() };
+      strips.push_back( all );
+      return;
+    }
+
+    // A box belongs to the strip holding its top row
+    int top = outer.y0;
+    std::stable_sort( boxes.begin(), boxes.end(), [=]( const SDL_Rect& a, const SDL_Rect& b ) {
+	return ( a.y - top ) / stripHeight < ( b.y - top ) / stripHeight;
+      } );
+
+    for( int b = 0; b < boxes.size(); ++b ) {
+      int band = ( boxes[ b ].y - top ) / stripHeight;
+
+      if( strips.empty() || ( strips.back().bounds.y0 - top ) / stripHeight != band ) {
+	Strip strip = { { INT_MAX, INT_MAX, INT_MIN, INT_MIN }, b, 0 };
+	strips.push_back( strip );
+      }
+
+      grow( strips.back().bounds, boxes[ b ] );
+      ++strips.back().count;
+    }
+  }
+
+  const std::vector<SDL_Rect>& get_boxes() const {
+    return boxes;
+  }
+
+  const std::vector<Strip>& get_strips() const {
+    return strips;
+  }
+
+  const Bounds& bounds() const {
+    return outer;
+  }
+};
+
+inline bool overlaps( const BoxShape::Bounds& a, const BoxShape::Bounds& b, int dx, int dy ) {
+  return !( a.y1 <= b.y0 + dy || a.y0 >= b.y1 + dy || a.x1 <= b.x0 + dx || a.x0 >= b.x1 + dx );
+}
+
+// 18: shapes in local space, a placed at (ax, ay) and b at (bx, by)
+inline bool check_collision( const BoxShape& a, int ax, int ay, const BoxShape& b, int bx, int by ) {
+  // b relative to a
+  int dx = bx - ax, dy = by - ay;
+
+  if( a.get_boxes().empty() || b.get_boxes().empty() || !overlaps( a.bounds(), b.bounds(), dx, dy ) ) {
+    return false;
+  }
+
+  const std::vector<BoxShape::Strip>& stripsA = a.get_strips();
+  const std::vector<BoxShape::Strip>& stripsB = b.get_strips();
+
+  for( int sa = 0; sa < stripsA.size(); ++sa ) {
+    if( !overlaps( stripsA[ sa ].bounds, b.bounds(), dx, dy ) ) {
+      continue;
+    }
+
+    for( int sb = 0; sb < stripsB.size(); ++sb ) {
+      if( !overlaps( stripsA[ sa ].bounds, stripsB[ sb ].bounds, dx, dy ) ) {
+	continue;
+      }
+
+      const SDL_Rect* boxA = &a.get_boxes()[ stripsA[ sa ].first ];
+      const SDL_Rect* boxB = &b.get_boxes()[ stripsB[ sb ].first ];
+
+      for( int i = 0; i < stripsA[ sa ].count; ++i ) {
+	for( int j = 0; j < stripsB[ sb ].count; ++j ) {
+	  if( !( boxA[ i ].y + boxA[ i ].h <= boxB[ j ].y + dy ||
+		 boxA[ i ].y >= boxB[ j ].y + boxB[ j ].h + dy ||
+		 boxA[ i ].x + boxA[ i ].w <= boxB[ j ].x + dx ||
+		 boxA[ i ].x >= boxB[ j ].x + boxB[ j ].w + dx ) ) {
+	    return true;
+	  }
+	}
+      }
+    }
+  }
+
+  return false;
+}
+
+// Is circle a closer than its radius to bounds b placed at (bx, by)
+inline bool check_collision( const Circle& a, const BoxShape::Bounds& b, int bx, int by ) {
+  int x0 = b.x0 + bx, x1 = b.x1 + bx, y0 = b.y0 + by, y1 = b.y1 + by;
+  int cx = a.x < x0 ? x0 : ( a.x > x1 ? x1 : a.x );
+  int cy = a.y < y0 ? y0 : ( a.y > y1 ? y1 : a.y );
+
+  return distance_squared( a.x, a.y, cx, cy ) < a.r * a.r;
+}
+
+// 19: circle against a shape placed at (bx, by)
+inline bool check_collision( const Circle& a, const BoxShape& b, int bx, int by ) {
+  if( b.get_boxes().empty() || !check_collision( a, b.bounds(), bx, by ) ) {
+    return false;
+  }
+
+  const std::vector<BoxShape::Strip>& strips = b.get_strips();
+
+  for( int s = 0; s < strips.size(); ++s ) {
+    if( !check_collision( a, strips[ s ].bounds, bx, by ) ) {
+      continue;
+    }
+
+    for( int i = strips[ s ].first; i < strips[ s ].first + strips[ s ].count; ++i ) {
+      const SDL_Rect& box = b.get_boxes()[ i ];
+      BoxShape::Bounds bounds = { box.x, box.y, box.x + box.w, box.y + box.h };
+
+      if( check_collision( a, bounds, bx, by ) ) {
+	return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+#endif
@@ -0,0 +1,269 @@
+#ifndef COLORKEYBLIT_H
+#define COLORKEYBLIT_H
+
+#include <SDL/SDL.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define COLORKEYBLIT_X86 1
+#endif
+
+// Colorkey blit for 32 bit surfaces.
+// Every image from load_image is colorkeyed and drawn onto a 32 bit
+// software screen, which SDL does one pixel at a time. colorkey_blit()
+// takes the same arguments and clips the same way as SDL_BlitSurface, and
+// when both surfaces are 32 bit with the same RGB layout and the source
+// only has a colorkey (no alpha), copies a row at a time: the row is
+// compared against the key a vector at a time and only the pixels that
+// are not the key are stored. Anything else goes to SDL_BlitSurface.
+
+enum ColorKeyKernel {
+  COLORKEY_SDL,
+  COLORKEY_SCALAR,
+  COLORKEY_SSE41,
+  COLORKEY_AVX2
+};
+
+// Copies count pixels of src that are not key (compared under mask) to dst
+inline void colorkey_row_scalar( const Uint32* src, Uint32* dst, int count, Uint32 key, Uint32 mask )
+{
+  for( int i = 0; i < count; ++i ) {
+    if( ( src[ i ] & mask ) != key ) {
+      dst[ i ] = src[ i ];
+    }
+  }
+}
+
+#ifdef COLORKEYBLIT_X86
+// No masked store before AVX, so blend the kept pixels into what is there
+__attribute__((target("sse4.1")))
+inline void colorkey_row_sse41( const Uint32* src, Uint32* dst, int count, Uint32 key, Uint32 mask )
+{
+  __m128i vkey = _mm_set1_epi32( key ), vmask = _mm_set1_epi32( mask );
+  int i = 0;
+
+  for( ; i + 4 <= count; i += 4 ) {
+    __m128i s = _mm_loadu_si128( (const __m128i*) ( src + i ) );
+    __m128i transparent = _mm_cmpeq_epi32( _mm_and_si128( s, vmask ), vkey );
+
+    if( _mm_movemask_epi8( transparent ) == 0xFFFF ) {
+      continue;
+    }
+
+    __m128i d = _mm_loadu_si128( (const __m128i*) ( dst + i ) );
+    _mm_storeu_si128( (__m128i*) ( dst + i ), _mm_blendv_epi8( s, d, transparent ) );
+  }
+
+  colorkey_row_scalar( src + i, dst + i, count - i, key, mask );
+}
+
+// Masked loads and stores, so the tail needs no scalar loop and the
+// destination is never read
+__attribute__((target("avx2")))
+inline void colorkey_row_avx2( const Uint32* src, Uint32* dst, int count, Uint32 key, Uint32 mask )
+{
+  __m256i vkey = _mm256_set1_epi32( key ), vmask = _mm256_set1_epi32( mask );
+  __m256i lanes = _mm256_setr_epi32( 0, 1, 2, 3, 4, 5, 6, 7 );
+  int i = 0;
+
+  for( ; i + 8 <= count; i += 8 ) {
+    __m256i s = _mm256_loadu_si256( (const __m256i*) ( src + i ) );
+    __m256i opaque = _mm256_xor_si256( _mm256_cmpeq_epi32( _mm256_and_si256( s, vmask ), vkey ), _mm256_set1_epi32( -1 ) );
+
+    _mm256_maskstore_epi32( (int*) ( dst + i ), opaque, s );
+  }
+
+  if( i < count ) {
+    __m256i tail = _mm256_cmpgt_epi32( _mm256_set1_epi32( count - i ), lanes );
+    __m256i s = _mm256_maskload_epi32( (const int*) ( src + i ), tail );
+    __m256i opaque = _mm256_andnot_si256( _mm256_cmpeq_epi32( _mm256_and_si256( s, vmask ), vkey ), tail );
+
+    _mm256_maskstore_epi32( (int*) ( dst + i ), opaque, s );
+  }
+}
+#endif
+
+typedef void (*ColorKeyRowFunc)( const Uint32*, Uint32*, int, Uint32, Uint32 );
+
+inline bool colorkey_supports( ColorKeyKernel kernel )
+{
+#ifdef COLORKEYBLIT_X86
+  if( kernel == COLORKEY_AVX2 ) {
+    return __builtin_cpu_supports( "avx2" );
+  }
+  if( kernel == COLORKEY_SSE41 ) {
+    return __builtin_cpu_supports( "sse4.1" );
+  }
+  return true;
+#else
+  return kernel == COLORKEY_SDL || kernel == COLORKEY_SCALAR;
+#endif
+}
+
+// Kernel used by colorkey_blit(). Picked from the CPU on first use,
+// colorkey_use_kernel() forces one (it falls back to scalar if the CPU
+// can't run it); COLORKEY_SDL sends every blit to SDL_BlitSurface.
+inline ColorKeyKernel& colorkey_kernel_slot()
+{
+  static ColorKeyKernel kernel =
+    colorkey_supports( COLORKEY_AVX2 ) ? COLORKEY_AVX2 :
+    colorkey_supports( COLORKEY_SSE41 ) ? COLORKEY_SSE41 : COLORKEY_SCALAR;
+  return kernel;
+}
+
+inline void colorkey_use_kernel( ColorKeyKernel kernel )
+{
+  colorkey_kernel_slot() = colorkey_supports( kernel ) ? kernel : COLORKEY_SCALAR;
+}
+
+inline ColorKeyKernel colorkey_kernel()
+{
+  return colorkey_kernel_slot();
+}
+
+inline ColorKeyRowFunc colorkey_row_func()
+{
+  switch( colorkey_kernel_slot() ) {
+#ifdef COLORKEYBLIT_X86
+  case COLORKEY_AVX2:
+    return colorkey_row_avx2;
+  case COLORKEY_SSE41:
+    return colorkey_row_sse41;
+#endif
+  default:
+    return colorkey_row_scalar;
+  }
+}
+
+// Can src be drawn onto dst by the row kernels
+inline bool colorkey_blit_handles( SDL_Surface* src, SDL_Surface* dst )
+{
+  const SDL_PixelFormat* s = src->format;
+  const SDL_PixelFormat* d = dst->format;
+
+  return ( src->flags & ( SDL_SRCCOLORKEY | SDL_SRCALPHA ) ) == SDL_SRCCOLORKEY &&
+    s->BytesPerPixel == 4 && d->BytesPerPixel == 4 &&
+    s->Rmask == d->Rmask && s->Gmask == d->Gmask && s->Bmask == d->Bmask &&
+    s->Amask == 0 && d->Amask == 0;
+}
+
+// Clips a blit as SDL_UpperBlit does, to the source and then to dst's
+// clip rect. dstrect gets the area drawn and from the matching source
+// area; false if nothing is left to draw.
+inline bool colorkey_clip( SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst, SDL_Rect* dstrect, SDL_Rect& from )
+{
+  int srcX, srcY, w, h;
+  if( srcrect ) {
+    srcX = srcrect->x;
+    w = srcrect->w;
+    if( srcX < 0 ) {
+      w += srcX;
+      dstrect->x -= srcX;
+      srcX = 0;
+    }
+    if( src->w - srcX < w ) {
+      w = src->w - srcX;
+    }
+
+    srcY = srcrect->y;
+    h = srcrect->h;
+    if( srcY < 0 ) {
+      h += srcY;
+      dstrect->y -= srcY;
+      srcY = 0;
+    }
+    if( src->h - srcY < h ) {
+      h = src->h - srcY;
+    }
+  } else {
+    srcX = srcY = 0;
+    w = src->w;
+    h = src->h;
+  }
+
+  const SDL_Rect& clip = dst->clip_rect;
+  int dx = clip.x - dstrect->x;
+  if( dx > 0 ) {
+    w -= dx;
+    dstrect->x += dx;
+    srcX += dx;
+  }
+  dx = dstrect->x + w - clip.x - clip.w;
+  if( dx > 0 ) {
+    w -= dx;
+  }
+
+  int dy = clip.y - dstrect->y;
+  if( dy > 0 ) {
+    h -= dy;
+    dstrect->y += dy;
+    srcY += dy;
+  }
+  dy = dstrect->y + h - clip.y - clip.h;
+  if( dy > 0 ) {
+    h -= dy;
+  }
+
+  if( w <= 0 || h <= 0 ) {
+    dstrect->w = dstrect->h = 0;
+    return false;
+  }
+  dstrect->w = from.w = w;
+  dstrect->h = from.h = h;
+  from.x = srcX;
+  from.y = srcY;
+
+  return true;
+}
+
+// Same as SDL_BlitSurface, dstrect gets the area drawn
+inline int colorkey_blit( SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst, SDL_Rect* dstrect )
+{
+  if( colorkey_kernel_slot() == COLORKEY_SDL || !colorkey_blit_handles( src, dst ) ) {
+    return SDL_BlitSurface( src, srcrect, dst, dstrect );
+  }
+
+  SDL_Rect fullDst, from;
+  if( dstrect == NULL ) {
+    fullDst.x = fullDst.y = 0;
+    dstrect = &fullDst;
+  }
+
+  if( !colorkey_clip( src, srcrect, dst, dstrect, from ) ) {
+    return 0;
+  }
+
+  if( SDL_MUSTLOCK( src ) && SDL_LockSurface( src ) < 0 ) {
+    return -1;
+  }
+  if( SDL_MUSTLOCK( dst ) && SDL_LockSurface( dst ) < 0 ) {
+    if( SDL_MUSTLOCK( src ) ) {
+      SDL_UnlockSurface( src );
+    }
+    return -1;
+  }
+
+  ColorKeyRowFunc row = colorkey_row_func();
+  // Same key test as SDL's, every bit but alpha (there is none here)
+  Uint32 mask = ~src->format->Amask;
+  Uint32 key = src->format->colorkey & mask;
+  const Uint8* in = (const Uint8*) src->pixels + from.y * src->pitch + from.x * 4;
+  Uint8* out = (Uint8*) dst->pixels + dstrect->y * dst->pitch + dstrect->x * 4;
+
+  for( int y = 0; y < from.h; ++y ) {
+    row( (const Uint32*) in, (Uint32*) out, from.w, key, mask );
+    in += src->pitch;
+    out += dst->pitch;
+  }
+
+  if( SDL_MUSTLOCK( dst ) ) {
+    SDL_UnlockSurface( dst );
+  }
+  if( SDL_MUSTLOCK( src ) ) {
+    SDL_UnlockSurface( src );
+  }
+
+  return 0;
+}
+
+#endif
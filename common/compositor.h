@@ -0,0 +1,203 @@
+#ifndef COMPOSITOR_H
+#define COMPOSITOR_H
+
+#include <SDL/SDL.h>
+#include <string.h>
+#include <vector>
+#include "threadpool.h"
+#include "rendercommands.h"
+#include "spansprite.h"
+
+// Band parallel software compositor.
+// Runs a frame of render commands on a thread pool: the screen is cut
+// into horizontal bands, and each band clears its rows and draws only the
+// commands that reach into it, clipped to it. Bands never share a pixel
+// and keep the queue's order, so the picture is the same as from
+// RenderQueue::execute(). execute() returns once every band is done,
+// which is the point to SDL_Flip.
+//
+// Each band draws into its own surface header over the screen's rows,
+// so nothing SDL keeps per surface is shared between threads. For that
+// the blits must be ones span_blit or a plain row copy can do (32 bit,
+// same layout as the screen, no alpha); a frame with any other draw runs
+// on the calling thread.
+
+// Bands per worker, more than one so stealing evens out busy bands
+const int COMPOSITOR_BANDS_PER_WORKER = 4;
+const int COMPOSITOR_MIN_BAND = 16;
+
+class BandCompositor {
+private:
+  ThreadPool& pool;
+
+  // Surface headers over the rows of each band of the screen
+  std::vector<SDL_Surface*> views;
+  std::vector<int> tops;
+  SDL_Surface* viewScreen;
+  void* viewPixels;
+
+  int serialFrames;
+
+  void free_views() {
+    for( int v = 0; v < views.size(); ++v ) {
+      SDL_FreeSurface( views[ v ] );
+    }
+    views.clear();
+    tops.clear();
+  }
+
+  void make_views( SDL_Surface* screen ) {
+    if( screen == viewScreen && screen->pixels == viewPixels && !views.empty() ) {
+      return;
+    }
+    free_views();
+
+    int bands = pool.size() * COMPOSITOR_BANDS_PER_WORKER;
+    if( bands > screen->h / COMPOSITOR_MIN_BAND ) {
+      bands = screen->h / COMPOSITOR_MIN_BAND;
+    }
+    if( bands < 1 ) {
+      bands = 1;
+    }
+
+    const SDL_PixelFormat* f = screen->format;
+    for( int b = 0; b <= bands; ++b ) {
+      tops.push_back( b * screen->h / bands );
+    }
+    for( int b = 0; b < bands; ++b ) {
+      views.push_back( SDL_CreateRGBSurfaceFrom( (Uint8*) screen->pixels + tops[ b ] * screen->pitch,
+						 screen->w, tops[ b + 1 ] - tops[ b ], f->BitsPerPixel, screen->pitch,
+						 f->Rmask, f->Gmask, f->Bmask, f->Amask ) );
+    }
+
+    viewScreen = screen;
+    viewPixels = screen->pixels;
+  }
+
+  // Can the command be drawn from a worker thread
+  static bool band_safe( const RenderCommand& c, SDL_Surface* screen ) {
+    if( c.source == NULL ) {
+      return true;
+    }
+
+    const SDL_PixelFormat* s = c.source->format;
+    const SDL_PixelFormat* d = screen->format;
+    bool sameLayout = s->BytesPerPixel == 4 && d->BytesPerPixel == 4 &&
+      s->Rmask == d->Rmask && s->Gmask == d->Gmask && s->Bmask == d->Bmask &&
+      s->Amask == 0 && d->Amask == 0;
+
+    return sameLayout && ( c.source->flags & SDL_SRCALPHA ) == 0 &&
+      colorkey_kernel() != COLORKEY_SDL;
+  }
+
+  // Opaque 32 bit blit, already clipped
+  static void copy_rows( SDL_Surface* src, const SDL_Rect& from, SDL_Surface* dst, int x, int y ) {
+    for( int row = 0; row < from.h; ++row ) {
+      memcpy( (Uint8*) dst->pixels + ( y + row ) * dst->pitch + x * 4,
+	      (const Uint8*) src->pixels + ( from.y + row ) * src->pitch + from.x * 4, from.w * 4 );
+    }
+  }
+
+  void draw_band( int band, const std::vector<RenderCommand>& commands, bool clear, Uint32 color ) {
+    SDL_Surface* view = views[ band ];
+    int top = tops[ band ], bottom = tops[ band + 1 ];
+
+    if( clear ) {
+      SDL_FillRect( view, NULL, color );
+    }
+
+    for( int c = 0; c < commands.size(); ++c ) {
+      const RenderCommand& command = commands[ c ];
+      int y0 = command.rect.y > top ? command.rect.y : top;
+      int y1 = command.rect.y + command.rect.h < bottom ? command.rect.y + command.rect.h : bottom;
+
+      if( y1 <= y0 ) {
+	continue;
+      }
+
+      // Same draw, cut to the band's rows, in band coordinates
+      SDL_Rect from = command.clip, to = command.rect;
+      from.y += y0 - command.rect.y;
+      from.h = y1 - y0;
+      to.y = y0 - top;
+      to.h = y1 - y0;
+
+      if( command.source == NULL ) {
+	SDL_FillRect( view, &to, command.color );
+      } else if( command.source->flags & SDL_SRCCOLORKEY ) {
+	span_blit( command.source, &from, view, &to );
+      } else {
+	copy_rows( command.source, from, view, to.x, to.y );
+      }
+    }
+  }
+
+  void composite( RenderQueue& queue, SDL_Surface* screen, bool clear, Uint32 color ) {
+    queue.prepare();
+    const std::vector<RenderCommand>& commands = queue.get_commands();
+
+    bool parallel = screen->format->BytesPerPixel == 4;
+    for( int c = 0; parallel && c < commands.size(); ++c ) {
+      parallel = band_safe( commands[ c ], screen );
+    }
+
+    if( !parallel ) {
+      if( clear ) {
+	SDL_FillRect( screen, NULL, color );
+      }
+      queue.draw( screen );
+      ++serialFrames;
+      return;
+    }
+
+    if( SDL_MUSTLOCK( screen ) && SDL_LockSurface( screen ) < 0 ) {
+      queue.clear();
+      return;
+    }
+
+    make_views( screen );
+    pool.run( views.size(), 1, [&]( int begin, int end, int worker ) {
+	for( int band = begin; band < end; ++band ) {
+	  draw_band( band, commands, clear, color );
+	}
+      } );
+
+    if( SDL_MUSTLOCK( screen ) ) {
+      SDL_UnlockSurface( screen );
+    }
+
+    queue.clear();
+  }
+
+public:
+  BandCompositor( ThreadPool& thePool ) : pool( thePool ) {
+    viewScreen = NULL;
+    viewPixels = NULL;
+    serialFrames = 0;
+  }
+
+  ~BandCompositor() {
+    free_views();
+  }
+
+  // Draws the queue's frame onto screen, then clears the queue
+  void execute( RenderQueue& queue, SDL_Surface* screen ) {
+    composite( queue, screen, false, 0 );
+  }
+
+  // Same, filling the screen with color first
+  void execute( RenderQueue& queue, SDL_Surface* screen, Uint32 color ) {
+    composite( queue, screen, true, color );
+  }
+
+  int get_bands() const {
+    return views.size();
+  }
+
+  // Frames that had to be drawn on the calling thread
+  int get_serial_frames() const {
+    return serialFrames;
+  }
+};
+
+#endif
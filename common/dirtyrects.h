@@ -0,0 +1,225 @@
+#ifndef DIRTYRECTS_H
+#define DIRTYRECTS_H
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <vector>
+#include "spansprite.h"
+
+// Dirty rectangle renderer.
+// Instead of clearing the whole screen and flipping it every frame, only
+// the places things were drawn last frame are restored from a copy of the
+// static background, and only those plus the places drawn this frame are
+// sent to the display with SDL_UpdateRects. Rects close enough together
+// are merged first so the display gets a few larger updates.
+//
+// Whatever is on screen when the renderer is made is the background, so
+// draw the parts that never move first. After that only what moves on
+// top of it is redrawn and presented each frame.
+//
+// A frame is begin_frame(), then blit()/fill(), then present().
+
+// Merge two rects when their bounding box wastes at most this many pixels
+const int DIRTY_MERGE_SLACK = 64 * 64;
+
+class DirtyRects {
+private:
+  SDL_Surface* screen;
+  SDL_Surface* background;
+
+  // Bounds drawn in the last frame and in this one
+  std::vector<SDL_Rect> previous, current;
+  std::vector<SDL_Rect> dirty;
+
+  // This frame's bytes, from begin_frame() on, and the sums over all
+  // presented frames
+  Uint64 bytesTouched, bytesPresented;
+  Uint64 totalTouched, totalPresented;
+  int frames;
+
+  int area( const SDL_Rect& r ) const {
+    return r.w * r.h;
+  }
+
+  Uint64 bytes( const SDL_Rect& r ) const {
+    return (Uint64) area( r ) * screen->format->BytesPerPixel;
+  }
+
+  // Clips r to the screen, false if nothing is left
+  bool clip( SDL_Rect& r ) const {
+    int x0 = r.x < 0 ? 0 : r.x, y0 = r.y < 0 ? 0 : r.y;
+    int x1 = r.x + r.w > screen->w ? screen->w : r.x + r.w;
+    int y1 = r.y + r.h > screen->h ? screen->h : r.y + r.h;
+
+    if( x1 <= x0 || y1 <= y0 ) {
+      return false;
+    }
+
+    r.x = x0; r.y = y0;
+    r.w = x1 - x0; r.h = y1 - y0;
+    return true;
+  }
+
+  static SDL_Rect bounds( const SDL_Rect& a, const SDL_Rect& b ) {
+    int x0 = a.x < b.x ? a.x : b.x, y0 = a.y < b.y ? a.y : b.y;
+    int x1 = a.x + a.w > b.x + b.w ? a.x + a.w : b.x + b.w;
+    int y1 = a.y + a.h > b.y + b.h ? a.y + a.h : b.y + b.h;
+    SDL_Rect r;
+
+    r.x = x0; r.y = y0;
+    r.w = x1 - x0; r.h = y1 - y0;
+    return r;
+  }
+
+  // Folds rect into dirty, merging with any rect it can be joined with,
+  // and again with whatever the merged rect can now be joined with
+  void add_dirty( SDL_Rect rect ) {
+    bool merged = true;
+
+    while( merged ) {
+      merged = false;
+
+      for( int d = 0; d < dirty.size(); ++d ) {
+	SDL_Rect joined = bounds( rect, dirty[ d ] );
+
+	if( area( joined ) <= area( rect ) + area( dirty[ d ] ) + DIRTY_MERGE_SLACK ) {
+	  rect = joined;
+	  dirty[ d ] = dirty.back();
+	  dirty.pop_back();
+	  merged = true;
+	  break;
+	}
+      }
+    }
+
+    dirty.push_back( rect );
+  }
+
+public:
+  // Takes a copy of what is on screen now as the background
+  DirtyRects( SDL_Surface* theScreen ) {
+    screen = theScreen;
+    background = SDL_DisplayFormat( screen );
+    bytesTouched = bytesPresented = 0;
+    totalTouched = totalPresented = 0;
+    frames = 0;
+  }
+
+  ~DirtyRects() {
+    SDL_FreeSurface( background );
+  }
+
+  // Puts the background back wherever something was drawn last frame
+  void begin_frame() {
+    bytesTouched = bytesPresented = 0;
+
+    for( int p = 0; p < previous.size(); ++p ) {
+      SDL_Rect from = previous[ p ], to = previous[ p ];
+
+      SDL_BlitSurface( background, &from, screen, &to );
+      bytesTouched += bytes( previous[ p ] );
+    }
+  }
+
+  // Draws like apply_surface and remembers where
+  void blit( int x, int y, SDL_Surface* source, SDL_Rect* clipRect = NULL ) {
+    SDL_Rect offset;
+
+    offset.x = x;
+    offset.y = y;
+    offset.w = clipRect ? clipRect->w : source->w;
+    offset.h = clipRect ? clipRect->h : source->h;
+
+    if( !clip( offset ) ) {
+      return;
+    }
+
+    SDL_Rect drawn = offset;
+    offset.x = x;
+    offset.y = y;
+    span_blit( source, clipRect, screen, &offset );
+
+    current.push_back( drawn );
+    bytesTouched += bytes( drawn );
+  }
+
+  void fill( const SDL_Rect& rect, Uint32 color ) {
+    SDL_Rect drawn = rect;
+
+    if( !clip( drawn ) ) {
+      return;
+    }
+
+    SDL_Rect target = drawn;
+    SDL_FillRect( screen, &target, color );
+
+    current.push_back( drawn );
+    bytesTouched += bytes( drawn );
+  }
+
+  // Sends what changed, last frame's rects and this frame's, to the display
+  void present() {
+    dirty.clear();
+    for( int p = 0; p < previous.size(); ++p ) {
+      add_dirty( previous[ p ] );
+    }
+    for( int c = 0; c < current.size(); ++c ) {
+      add_dirty( current[ c ] );
+    }
+
+    // Merged bounds can overlap, count them once each anyway
+    for( int d = 0; d < dirty.size(); ++d ) {
+      bytesPresented += bytes( dirty[ d ] );
+    }
+    totalTouched += bytesTouched;
+    totalPresented += bytesPresented;
+
+    if( !dirty.empty() ) {
+      SDL_UpdateRects( screen, dirty.size(), &dirty[ 0 ] );
+    }
+
+    previous.swap( current );
+    current.clear();
+    ++frames;
+  }
+
+  // Bytes written to the screen surface (restores and draws) this frame
+  Uint64 get_bytes_touched() {
+    return bytesTouched;
+  }
+
+  // Bytes the last present() sent to the display
+  Uint64 get_bytes_presented() {
+    return bytesPresented;
+  }
+
+  // Bytes a full screen clear and flip sends each frame
+  Uint64 get_bytes_full() {
+    return (Uint64) screen->w * screen->h * screen->format->BytesPerPixel;
+  }
+
+  // Per frame over every frame presented so far
+  double get_mean_bytes_touched() {
+    return frames ? (double) totalTouched / frames : 0;
+  }
+
+  double get_mean_bytes_presented() {
+    return frames ? (double) totalPresented / frames : 0;
+  }
+
+  int get_frames() {
+    return frames;
+  }
+
+  // KB per frame touched and presented, against a full flip
+  void report() {
+    if( frames == 0 ) {
+      return;
+    }
+
+    printf( "%10s %10.2f KB/frame touched, %.2f KB/frame presented, full flip %.2f KB\n", "dirty",
+	    get_mean_bytes_touched() / 1024, get_mean_bytes_presented() / 1024, get_bytes_full() / 1024.0 );
+  }
+};
+
+#endif
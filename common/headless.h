@@ -0,0 +1,184 @@
+#ifndef HEADLESS_H
+#define HEADLESS_H
+
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include "clock.h"
+
+// Headless mode for the examples' main loops.
+// -headless N runs N frames as fast as they go, with no frame rate cap,
+// on SDL's dummy video driver, so the screen is a plain memory surface
+// and no display is needed. -dump PREFIX also writes every frame to
+// PREFIXnnnnn.ppm. At the end, frames per second and the time per frame
+// of each phase of the loop are printed.
+//
+// main() calls headless().parse( argc, argv ) before init(), init()
+// calls headless().setup() before SDL_Init, start() goes right before the
+// loop, and the loop marks the end of each phase and calls end_frame().
+// All of it does nothing without the flag.
+
+enum HeadlessPhase {
+  HEADLESS_INPUT,
+  HEADLESS_UPDATE,
+  HEADLESS_DRAW,
+  HEADLESS_PRESENT,
+  HEADLESS_PHASES
+};
+
+class Headless {
+private:
+  bool enabled;
+  int frames, frame;
+  std::string dumpPrefix;
+
+  double phaseMs[ HEADLESS_PHASES ];
+  double dumpMs;
+  double startMs, lastMs;
+
+  // Binary PPM, SDL 1.2 can only save BMP
+  bool dump( SDL_Surface* screen ) {
+    char name[ 32 ];
+    snprintf( name, sizeof( name ), "%05d.ppm", frame );
+
+    std::string path = dumpPrefix + name;
+    FILE* out = fopen( path.c_str(), "wb" );
+    if( out == NULL ) {
+      fprintf( stderr, "Error writing %s\n", path.c_str() );
+      return false;
+    }
+
+    if( SDL_MUSTLOCK( screen ) ) {
+      SDL_LockSurface( screen );
+    }
+
+    fprintf( out, "P6\n%d %d\n255\n", screen->w, screen->h );
+    std::string row( screen->w * 3, '\0' );
+    for( int y = 0; y < screen->h; ++y ) {
+      const Uint8* pixels = (const Uint8*) screen->pixels + y * screen->pitch;
+
+      for( int x = 0; x < screen->w; ++x ) {
+	Uint32 pixel = 0;
+	memcpy( &pixel, pixels + x * screen->format->BytesPerPixel, screen->format->BytesPerPixel );
+
+	Uint8 r, g, b;
+	SDL_GetRGB( pixel, screen->format, &r, &g, &b );
+	row[ x * 3 ] = r;
+	row[ x * 3 + 1 ] = g;
+	row[ x * 3 + 2 ] = b;
+      }
+      fwrite( row.data(), 1, row.size(), out );
+    }
+
+    if( SDL_MUSTLOCK( screen ) ) {
+      SDL_UnlockSurface( screen );
+    }
+
+    fclose( out );
+    return true;
+  }
+
+public:
+  Headless() {
+    enabled = false;
+    frames = frame = 0;
+    for( int p = 0; p < HEADLESS_PHASES; ++p ) {
+      phaseMs[ p ] = 0;
+    }
+    dumpMs = startMs = lastMs = 0;
+  }
+
+  // Picks up -headless N and -dump PREFIX
+  void parse( int argc, char** argv ) {
+    for( int a = 1; a + 1 < argc; ++a ) {
+      std::string flag = argv[ a ];
+
+      if( flag == "-headless" ) {
+	enabled = true;
+	frames = atoi( argv[ a + 1 ] );
+	if( frames <= 0 ) {
+	  frames = 1;
+	}
+      } else if( flag == "-dump" ) {
+	dumpPrefix = argv[ a + 1 ];
+      }
+    }
+  }
+
+  // Before SDL_Init, so SDL_SetVideoMode gives a memory surface (and
+  // SDL_INIT_EVERYTHING does not need a sound card either)
+  void setup() {
+    if( enabled ) {
+      setenv( "SDL_VIDEODRIVER", "dummy", 1 );
+      setenv( "SDL_AUDIODRIVER", "dummy", 1 );
+    }
+  }
+
+  bool is_enabled() const {
+    return enabled;
+  }
+
+  // Starts the clock, loading and the first flip are not counted
+  void start() {
+    startMs = lastMs = now_ms();
+  }
+
+  // Time since the last mark (or the end of the last frame) goes to phase
+  void mark( HeadlessPhase phase ) {
+    if( !enabled ) {
+      return;
+    }
+
+    double now = now_ms();
+    phaseMs[ phase ] += now - lastMs;
+    lastMs = now;
+  }
+
+  // Counts the frame and dumps it, true once the last frame is done
+  bool end_frame( SDL_Surface* screen ) {
+    if( !enabled ) {
+      return false;
+    }
+
+    if( !dumpPrefix.empty() ) {
+      double start = now_ms();
+      if( !dump( screen ) ) {
+	dumpPrefix.clear();
+      }
+      dumpMs += now_ms() - start;
+    }
+
+    ++frame;
+    lastMs = now_ms();
+
+    return frame >= frames;
+  }
+
+  // Frames per second, dumping left out, and each phase per frame
+  void report() const {
+    if( !enabled || frame == 0 ) {
+      return;
+    }
+
+    static const char* names[ HEADLESS_PHASES ] = { "input", "update", "draw", "present" };
+    double totalMs = lastMs - startMs - dumpMs;
+
+    printf( "%d frames in %.1f ms, %.1f fps\n", frame, totalMs, totalMs > 0 ? frame * 1000.0 / totalMs : 0 );
+    for( int p = 0; p < HEADLESS_PHASES; ++p ) {
+      printf( "%10s %10.4f ms/frame\n", names[ p ], phaseMs[ p ] / frame );
+    }
+    if( dumpMs > 0 ) {
+      printf( "%10s %10.4f ms/frame\n", "dump", dumpMs / frame );
+    }
+  }
+};
+
+inline Headless& headless()
+{
+  static Headless state;
+  return state;
+}
+
+#endif
@@ -0,0 +1,65 @@
+#ifndef NARROWPHASE_H
+#define NARROWPHASE_H
+
+#include <vector>
+#include <utility>
+#include "threadpool.h"
+
+// Parallel narrow phase over broad phase candidates.
+// The candidate list is cut into chunks that the pool's workers take and
+// steal. Every worker keeps its own hit buffer, so there is no locking
+// per hit. Each chunk notes where its hits landed, and once all chunks
+// are done they are copied out in chunk order, giving exactly what a
+// single threaded loop would.
+
+const int NARROWPHASE_CHUNK = 256;
+
+// Per worker hit buffer, on its own cache lines
+struct alignas( 64 ) NarrowPhaseBuffer {
+  std::vector<int> hits;
+};
+
+// Where a chunk's hits are: worker buffer, offset and count
+struct NarrowPhaseChunk {
+  int worker, first, count;
+};
+
+// Appends the candidates for which test( a, b ) is true to hits, in the
+// order they appear in candidates.
+template<class Test>
+void find_collisions( ThreadPool& pool, const std::vector< std::pair<int, int> >& candidates, Test test,
+		      std::vector< std::pair<int, int> >& hits, int chunkSize = NARROWPHASE_CHUNK ) {
+  if( chunkSize <= 0 ) {
+    chunkSize = NARROWPHASE_CHUNK;
+  }
+
+  std::vector<NarrowPhaseBuffer> buffers( pool.size() );
+  std::vector<NarrowPhaseChunk> chunks( ( candidates.size() + chunkSize - 1 ) / chunkSize );
+
+  pool.run( candidates.size(), chunkSize, [&]( int begin, int end, int worker ) {
+      std::vector<int>& out = buffers[ worker ].hits;
+      NarrowPhaseChunk& chunk = chunks[ begin / chunkSize ];
+
+      chunk.worker = worker;
+      chunk.first = out.size();
+
+      for( int c = begin; c < end; ++c ) {
+	if( test( candidates[ c ].first, candidates[ c ].second ) ) {
+	  out.push_back( c );
+	}
+      }
+
+      chunk.count = out.size() - chunk.first;
+    } );
+
+  // Chunks ran in any order, walking them by index restores it
+  for( int c = 0; c < chunks.size(); ++c ) {
+    const int* found = buffers[ chunks[ c ].worker ].hits.data() + chunks[ c ].first;
+
+    for( int h = 0; h < chunks[ c ].count; ++h ) {
+      hits.push_back( candidates[ found[ h ] ] );
+    }
+  }
+}
+
+#endif
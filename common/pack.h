@@ -0,0 +1,215 @@
+#ifndef PACK_H
+#define PACK_H
+
+#include <SDL/SDL.h>
+#include <string.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+// Asset packs.
+// tools/pack puts all of an example's images, fonts and sounds in one
+// file: a header, a perfect hash table, the table of contents, the names,
+// then every asset at a multiple of PACK_ALIGN. The examples map it once
+// and read the assets straight from memory with SDL_RWFromConstMem, one
+// open and one mmap instead of an open and reads per asset.
+//
+// The table of contents is indexed with a minimal perfect hash built at
+// pack time (hash and displace): the name's hash with seed 0 picks a
+// bucket, the bucket's seed hashes it again to its entry. Every lookup is
+// two hashes and a name compare, however many assets there are.
+
+const Uint32 PACK_MAGIC = 0x504C4453; // "SDLP"
+const Uint32 PACK_VERSION = 1;
+
+// Where each asset starts; blobs keep their rows aligned inside a pack
+const int PACK_ALIGN = 64;
+
+// Opened by asset_pack(), next to the executable's assets
+const char* const ASSET_PACK = "assets.pack";
+
+struct PackHeader {
+  Uint32 magic, version;
+  Uint32 count, buckets;
+
+  // From the start of the file: buckets seeds, count entries, the names
+  Uint32 seedsOffset, entriesOffset, namesOffset;
+  Uint32 size;
+};
+
+struct PackEntry {
+  Uint32 offset, size;
+  Uint32 nameOffset, nameLength;
+};
+
+// FNV-1a with a seed, finished with murmur3's mix so every seed gives a
+// new, well spread hash
+inline Uint32 pack_hash( const char* name, size_t length, Uint32 seed )
+{
+  Uint32 h = 2166136261u ^ ( seed * 0x9E3779B1u );
+
+  for( size_t i = 0; i < length; ++i ) {
+    h = ( h ^ (Uint8) name[ i ] ) * 16777619u;
+  }
+
+  h ^= h >> 16;
+  h *= 0x85EBCA6Bu;
+  h ^= h >> 13;
+  h *= 0xC2B2AE35u;
+  h ^= h >> 16;
+
+  return h;
+}
+
+class AssetPack {
+private:
+  Uint8* data;
+  size_t size;
+  const PackHeader* header;
+  const Uint32* seeds;
+  const PackEntry* entries;
+
+  // Checks the header and every entry lie in the file, then finds the
+  // tables
+  bool index() {
+    if( size < sizeof( PackHeader ) ) {
+      return false;
+    }
+    if( header->magic != PACK_MAGIC || header->version != PACK_VERSION || header->size != size ) {
+      return false;
+    }
+    if( (size_t) header->seedsOffset + header->buckets * sizeof( Uint32 ) > size ||
+	(size_t) header->entriesOffset + header->count * sizeof( PackEntry ) > size ) {
+      return false;
+    }
+    if( header->count > 0 && header->buckets == 0 ) {
+      return false;
+    }
+
+    seeds = (const Uint32*) ( data + header->seedsOffset );
+    entries = (const PackEntry*) ( data + header->entriesOffset );
+
+    for( Uint32 e = 0; e < header->count; ++e ) {
+      const PackEntry& entry = entries[ e ];
+      if( (size_t) entry.offset + entry.size > size || (size_t) entry.nameOffset + entry.nameLength > size ) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+public:
+  AssetPack() {
+    data = NULL;
+    size = 0;
+    header = NULL;
+    seeds = NULL;
+    entries = NULL;
+  }
+
+  ~AssetPack() {
+    close();
+  }
+
+  // Maps path, false if it is missing or not a pack
+  bool open( const std::string& path ) {
+    close();
+
+    int file = ::open( path.c_str(), O_RDONLY );
+    if( file < 0 ) {
+      return false;
+    }
+
+    struct stat info;
+    if( fstat( file, &info ) < 0 || info.st_size == 0 ) {
+      ::close( file );
+      return false;
+    }
+
+    // Private and writable so blob surfaces can be drawn on, copy on write
+    void* mapped = mmap( NULL, info.st_size, PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0 );
+    ::close( file );
+    if( mapped == MAP_FAILED ) {
+      return false;
+    }
+
+    data = (Uint8*) mapped;
+    size = info.st_size;
+    header = (const PackHeader*) data;
+
+    if( !index() ) {
+      close();
+      return false;
+    }
+    return true;
+  }
+
+  // Unmaps the pack, whatever was read from it must be freed first
+  void close() {
+    if( data != NULL ) {
+      munmap( data, size );
+    }
+    data = NULL;
+    size = 0;
+    header = NULL;
+    seeds = NULL;
+    entries = NULL;
+  }
+
+  bool is_open() const {
+    return data != NULL;
+  }
+
+  int get_count() const {
+    return header ? header->count : 0;
+  }
+
+  // The asset called name and its size, NULL if the pack has none
+  void* find( const std::string& name, size_t& assetSize ) const {
+    if( header == NULL || header->count == 0 ) {
+      return NULL;
+    }
+
+    Uint32 bucket = pack_hash( name.data(), name.size(), 0 ) % header->buckets;
+    const PackEntry& entry = entries[ pack_hash( name.data(), name.size(), seeds[ bucket ] ) % header->count ];
+
+    // Names that are not in the pack land on some entry too
+    if( entry.nameLength != name.size() || memcmp( data + entry.nameOffset, name.data(), name.size() ) != 0 ) {
+      return NULL;
+    }
+
+    assetSize = entry.size;
+    return data + entry.offset;
+  }
+
+  // The asset to read with IMG_Load_RW and the like, NULL if the pack has
+  // none. Reads come from the mapping, nothing is copied.
+  SDL_RWops* rw( const std::string& name ) const {
+    size_t assetSize = 0;
+    void* asset = find( name, assetSize );
+
+    return asset ? SDL_RWFromConstMem( asset, assetSize ) : NULL;
+  }
+};
+
+// The examples' pack, mapped on first use and for the whole run
+inline AssetPack& asset_pack()
+{
+  static AssetPack pack;
+  static bool opened = pack.open( ASSET_PACK );
+
+  (void) opened;
+  return pack;
+}
+
+// The asset from the pack, or else from the file of that name
+inline SDL_RWops* asset_rw( const std::string& name )
+{
+  SDL_RWops* rw = asset_pack().rw( name );
+
+  return rw ? rw : SDL_RWFromFile( name.c_str(), "rb" );
+}
+
+#endif
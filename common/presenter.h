@@ -0,0 +1,251 @@
+#ifndef PRESENTER_H
+#define PRESENTER_H
+
+#include <SDL/SDL.h>
+#include <atomic>
+#include <thread>
+#include <vector>
+#include <functional>
+#include "clock.h"
+#include "dirtyrects.h"
+
+// Pipelined frame drawing.
+// Frames are drawn into one of depth back buffers on a thread of its
+// own, so one frame is drawn while the next one's input and simulation
+// run. In SDL 1.2 only the drawing can overlap: video is not thread safe,
+// so the screen stays with the calling thread, and present() copies the
+// drawn frames to it and sends them to the display there.
+//
+// A frame is begin_frame(), which hands back a buffer index, then
+// keeping a copy of whatever draw needs under that index (the caller goes
+// on changing its own), then submit(). The draw thread calls
+// draw( buffer, index, drawn ) for each submitted frame, in order, and
+// present() shows the ones that are done. Every frame is shown, in order;
+// with more buffers the simulation can run further ahead, which evens out
+// uneven frames but adds latency.
+//
+// Whatever is on screen when the presenter is made is the background, as
+// with DirtyRects. Before draw is called the buffer's last frame is
+// wiped back to it, so draw only draws what moves and adds where to
+// drawn; present() then copies and updates just those rects and the last
+// frame's through a DirtyRects instead of the whole screen.
+//
+// Buffer indices go between the threads through two lock free single
+// producer, single consumer rings, queued and drawn; a side with nothing
+// to take yields. draw must not touch the screen.
+
+const int PRESENTER_MAX_DEPTH = 4;
+
+class Presenter {
+private:
+  // Holds at most PRESENTER_MAX_DEPTH indices, there are no more buffers
+  struct IndexRing {
+    std::atomic<unsigned int> head, tail;
+    int slots[ PRESENTER_MAX_DEPTH ];
+
+    IndexRing() {
+      head = tail = 0;
+    }
+
+    void push( int index ) {
+      unsigned int t = tail.load( std::memory_order_relaxed );
+      slots[ t % PRESENTER_MAX_DEPTH ] = index;
+      tail.store( t + 1, std::memory_order_release );
+    }
+
+    bool pop( int& index ) {
+      unsigned int h = head.load( std::memory_order_relaxed );
+      if( h == tail.load( std::memory_order_acquire ) ) {
+	return false;
+      }
+      index = slots[ h % PRESENTER_MAX_DEPTH ];
+      head.store( h + 1, std::memory_order_release );
+      return true;
+    }
+  };
+
+  SDL_Surface* screen;
+  SDL_Surface* buffers[ PRESENTER_MAX_DEPTH ];
+  double inputMs[ PRESENTER_MAX_DEPTH ];
+  int depth;
+  std::function<void( SDL_Surface*, int, std::vector<SDL_Rect>& )> draw;
+
+  // What each buffer's frame drew over the background. The draw thread's
+  // own copy of it, blitting one surface from two threads is not safe.
+  std::vector<SDL_Rect> drawnRects[ PRESENTER_MAX_DEPTH ];
+  SDL_Surface* background;
+
+  // Submitted, drawn but not shown, and (calling thread only) free
+  IndexRing queuedBuffers, drawnBuffers, freeBuffers;
+  std::atomic<bool> quit;
+  std::thread thread;
+
+  DirtyRects renderer;
+
+  // Written by present(), read after finish()
+  int frames;
+  double latencySum, latencyMax, presentSum;
+  double startMs, endMs;
+
+  void draw_main() {
+    int index;
+
+    for( ;; ) {
+      if( !queuedBuffers.pop( index ) ) {
+	if( !quit.load( std::memory_order_acquire ) ) {
+	  std::this_thread::yield();
+	  continue;
+	}
+	// Anything submitted before quit was set is seen now
+	if( !queuedBuffers.pop( index ) ) {
+	  return;
+	}
+      }
+
+      std::vector<SDL_Rect>& drawn = drawnRects[ index ];
+      for( int r = 0; r < drawn.size(); ++r ) {
+	SDL_Rect from = drawn[ r ], to = drawn[ r ];
+	SDL_BlitSurface( background, &from, buffers[ index ], &to );
+      }
+      drawn.clear();
+
+      draw( buffers[ index ], index, drawn );
+
+      drawnBuffers.push( index );
+    }
+  }
+
+  void show( int index ) {
+    double start = now_ms();
+
+    renderer.begin_frame();
+    for( int r = 0; r < drawnRects[ index ].size(); ++r ) {
+      SDL_Rect clip = drawnRects[ index ][ r ];
+      renderer.blit( clip.x, clip.y, buffers[ index ], &clip );
+    }
+    renderer.present();
+
+    double end = now_ms();
+
+    double latency = end - inputMs[ index ];
+    latencySum += latency;
+    if( latency > latencyMax ) {
+      latencyMax = latency;
+    }
+    presentSum += end - start;
+    endMs = end;
+    ++frames;
+  }
+
+public:
+  // theDepth back buffers, from 2 (double buffering) to
+  // PRESENTER_MAX_DEPTH. theDraw( buffer, index, drawn ) draws the frame
+  // submitted under index, on the draw thread.
+  Presenter( SDL_Surface* theScreen, int theDepth, std::function<void( SDL_Surface*, int, std::vector<SDL_Rect>& )> theDraw )
+    : renderer( theScreen ) {
+    screen = theScreen;
+    depth = theDepth < 2 ? 2 : theDepth > PRESENTER_MAX_DEPTH ? PRESENTER_MAX_DEPTH : theDepth;
+    draw = theDraw;
+    background = SDL_DisplayFormat( screen );
+
+    for( int b = 0; b < depth; ++b ) {
+      buffers[ b ] = SDL_DisplayFormat( screen );
+      inputMs[ b ] = 0;
+      freeBuffers.push( b );
+    }
+
+    frames = 0;
+    latencySum = latencyMax = presentSum = 0;
+    startMs = endMs = now_ms();
+    quit = false;
+    thread = std::thread( &Presenter::draw_main, this );
+  }
+
+  ~Presenter() {
+    finish();
+    for( int b = 0; b < depth; ++b ) {
+      SDL_FreeSurface( buffers[ b ] );
+    }
+    SDL_FreeSurface( background );
+  }
+
+  // The index to keep the next frame's state under. When every buffer is
+  // taken it waits for a frame to be drawn, and shows it to free its
+  // buffer. Every index must be submitted before the next begin_frame().
+  int begin_frame() {
+    int index;
+
+    while( !freeBuffers.pop( index ) ) {
+      if( present() == 0 ) {
+	std::this_thread::yield();
+      }
+    }
+    return index;
+  }
+
+  // Queues frame index to be drawn. inputMs is when its input was read,
+  // on the now_ms() clock.
+  void submit( int index, double theInputMs ) {
+    inputMs[ index ] = theInputMs;
+    queuedBuffers.push( index );
+  }
+
+  // Copies what the frames drawn so far changed to the screen and updates
+  // it there, on the calling thread; how many were shown. Never waits for
+  // a draw.
+  int present() {
+    int index, shown = 0;
+
+    while( drawnBuffers.pop( index ) ) {
+      show( index );
+      ++shown;
+      freeBuffers.push( index );
+    }
+    return shown;
+  }
+
+  // Draws and shows everything submitted and stops the draw thread
+  void finish() {
+    if( !thread.joinable() ) {
+      return;
+    }
+    quit.store( true, std::memory_order_release );
+    thread.join();
+
+    present();
+  }
+
+  int get_depth() const {
+    return depth;
+  }
+
+  // What the frames shown so far sent to the display
+  DirtyRects& get_renderer() {
+    return renderer;
+  }
+
+  // The rest are for after finish()
+  int get_frames() const {
+    return frames;
+  }
+
+  // Frames shown per second from construction to the last present
+  double get_fps() const {
+    return endMs > startMs ? frames * 1000.0 / ( endMs - startMs ) : 0;
+  }
+
+  // From reading the input to the end of the frame's update
+  double get_mean_latency_ms() const {
+    return frames ? latencySum / frames : 0;
+  }
+
+  double get_max_latency_ms() const {
+    return latencyMax;
+  }
+
+  double get_mean_present_ms() const {
+    return frames ? presentSum / frames : 0;
+  }
+};
+
+#endif
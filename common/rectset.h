@@ -0,0 +1,331 @@
+#ifndef RECTSET_H
+#define RECTSET_H
+
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define RECTSET_X86 1
+#endif
+
+// Structure of arrays rect set.
+// Sides are kept as x0/y0/x1/y1 in separate 32 byte aligned int arrays
+// so one box can be tested against a whole block of rects with a single
+// compare per side. Storage is padded to RECTSET_BLOCK with empty rects
+// that never overlap anything, so kernels never need a tail loop.
+
+const int RECTSET_BLOCK = 16;
+
+enum RectSetKernel {
+  RECTSET_SCALAR,
+  RECTSET_SSE2,
+  RECTSET_AVX2
+};
+
+class RectSet {
+private:
+  int* sides;
+  int count;
+  int capacity;
+
+  void reserve( int wanted ) {
+    if( wanted <= capacity ) {
+      return;
+    }
+
+    int newCapacity = capacity ? capacity : RECTSET_BLOCK;
+    while( newCapacity < wanted ) {
+      newCapacity *= 2;
+    }
+
+    void* block = NULL;
+    if( posix_memalign( &block, 32, sizeof( int ) * 4 * newCapacity ) != 0 ) {
+      abort();
+    }
+
+    int* newSides = (int*) block;
+    for( int k = 0; k < 4; ++k ) {
+      int fill = ( k < 2 ) ? INT_MAX : INT_MIN;
+
+      for( int i = 0; i < newCapacity; ++i ) {
+	newSides[ k * newCapacity + i ] = fill;
+      }
+
+      if( sides != NULL ) {
+	memcpy( newSides + k * newCapacity, sides + k * capacity, sizeof( int ) * count );
+      }
+    }
+
+    free( sides );
+    sides = newSides;
+    capacity = newCapacity;
+  }
+
+public:
+  RectSet() {
+    sides = NULL;
+    count = capacity = 0;
+  }
+
+  RectSet( const std::vector<SDL_Rect>& rects ) {
+    sides = NULL;
+    count = capacity = 0;
+    assign( rects );
+  }
+
+  RectSet( const RectSet& other ) {
+    sides = NULL;
+    count = capacity = 0;
+    *this = other;
+  }
+
+  RectSet& operator=( const RectSet& other ) {
+    if( this != &other ) {
+      clear();
+      reserve( other.capacity );
+      for( int k = 0; k < 4; ++k ) {
+	memcpy( sides + k * capacity, other.sides + k * other.capacity, sizeof( int ) * other.count );
+      }
+      count = other.count;
+    }
+    return *this;
+  }
+
+  ~RectSet() {
+    free( sides );
+  }
+
+  int size() const {
+    return count;
+  }
+
+  // Number of rects the kernels walk, always a multiple of RECTSET_BLOCK
+  int padded_size() const {
+    return ( count + RECTSET_BLOCK - 1 ) / RECTSET_BLOCK * RECTSET_BLOCK;
+  }
+
+  const int* x0() const { return sides; }
+  const int* y0() const { return sides + capacity; }
+  const int* x1() const { return sides + capacity * 2; }
+  const int* y1() const { return sides + capacity * 3; }
+
+  void clear() {
+    for( int k = 0; k < 4; ++k ) {
+      int fill = ( k < 2 ) ? INT_MAX : INT_MIN;
+
+      for( int i = 0; i < count; ++i ) {
+	sides[ k * capacity + i ] = fill;
+      }
+    }
+    count = 0;
+  }
+
+  void push_back( const SDL_Rect& rect ) {
+    reserve( count + 1 );
+
+    sides[ count ] = rect.x;
+    sides[ capacity + count ] = rect.y;
+    sides[ capacity * 2 + count ] = rect.x + rect.w;
+    sides[ capacity * 3 + count ] = rect.y + rect.h;
+
+    ++count;
+  }
+
+  void assign( const std::vector<SDL_Rect>& rects ) {
+    clear();
+    reserve( rects.size() );
+    for( int i = 0; i < rects.size(); ++i ) {
+      push_back( rects[ i ] );
+    }
+  }
+
+  // Overwrites rect i, for sets whose members move
+  void set( int i, const SDL_Rect& rect ) {
+    sides[ i ] = rect.x;
+    sides[ capacity + i ] = rect.y;
+    sides[ capacity * 2 + i ] = rect.x + rect.w;
+    sides[ capacity * 3 + i ] = rect.y + rect.h;
+  }
+
+  SDL_Rect get( int i ) const {
+    SDL_Rect rect;
+    rect.x = sides[ i ];
+    rect.y = sides[ capacity + i ];
+    rect.w = sides[ capacity * 2 + i ] - sides[ i ];
+    rect.h = sides[ capacity * 3 + i ] - sides[ capacity + i ];
+    return rect;
+  }
+};
+
+// Bit i of the result is set when box (ax0, ay0)-(ax1, ay1) overlaps rect
+// first + i of set, for the RECTSET_BLOCK rects starting at first.
+// Same test as check_collision( SDL_Rect, SDL_Rect ): touching edges do
+// not count.
+inline unsigned int rectset_block_scalar( const RectSet& set, int first, int ax0, int ay0, int ax1, int ay1 )
+{
+  const int* x0 = set.x0() + first;
+  const int* y0 = set.y0() + first;
+  const int* x1 = set.x1() + first;
+  const int* y1 = set.y1() + first;
+  unsigned int bits = 0;
+
+  for( int i = 0; i < RECTSET_BLOCK; ++i ) {
+    if( ( ay1 <= y0[ i ] || ay0 >= y1[ i ] || ax1 <= x0[ i ] || ax0 >= x1[ i ] ) == false ) {
+      bits |= 1u << i;
+    }
+  }
+
+  return bits;
+}
+
+#ifdef RECTSET_X86
+inline unsigned int rectset_block_sse2( const RectSet& set, int first, int ax0, int ay0, int ax1, int ay1 )
+{
+  __m128i vax0 = _mm_set1_epi32( ax0 ), vay0 = _mm_set1_epi32( ay0 );
+  __m128i vax1 = _mm_set1_epi32( ax1 ), vay1 = _mm_set1_epi32( ay1 );
+  unsigned int bits = 0;
+
+  for( int i = 0; i < RECTSET_BLOCK; i += 4 ) {
+    __m128i bx0 = _mm_load_si128( (const __m128i*) ( set.x0() + first + i ) );
+    __m128i by0 = _mm_load_si128( (const __m128i*) ( set.y0() + first + i ) );
+    __m128i bx1 = _mm_load_si128( (const __m128i*) ( set.x1() + first + i ) );
+    __m128i by1 = _mm_load_si128( (const __m128i*) ( set.y1() + first + i ) );
+
+    __m128i hit = _mm_and_si128( _mm_and_si128( _mm_cmpgt_epi32( bx1, vax0 ), _mm_cmpgt_epi32( vax1, bx0 ) ),
+				 _mm_and_si128( _mm_cmpgt_epi32( by1, vay0 ), _mm_cmpgt_epi32( vay1, by0 ) ) );
+
+    bits |= (unsigned int) _mm_movemask_ps( _mm_castsi128_ps( hit ) ) << i;
+  }
+
+  return bits;
+}
+
+__attribute__((target("avx2")))
+inline unsigned int rectset_block_avx2( const RectSet& set, int first, int ax0, int ay0, int ax1, int ay1 )
+{
+  __m256i vax0 = _mm256_set1_epi32( ax0 ), vay0 = _mm256_set1_epi32( ay0 );
+  __m256i vax1 = _mm256_set1_epi32( ax1 ), vay1 = _mm256_set1_epi32( ay1 );
+  unsigned int bits = 0;
+
+  for( int i = 0; i < RECTSET_BLOCK; i += 8 ) {
+    __m256i bx0 = _mm256_load_si256( (const __m256i*) ( set.x0() + first + i ) );
+    __m256i by0 = _mm256_load_si256( (const __m256i*) ( set.y0() + first + i ) );
+    __m256i bx1 = _mm256_load_si256( (const __m256i*) ( set.x1() + first + i ) );
+    __m256i by1 = _mm256_load_si256( (const __m256i*) ( set.y1() + first + i ) );
+
+    __m256i hit = _mm256_and_si256( _mm256_and_si256( _mm256_cmpgt_epi32( bx1, vax0 ), _mm256_cmpgt_epi32( vax1, bx0 ) ),
+				    _mm256_and_si256( _mm256_cmpgt_epi32( by1, vay0 ), _mm256_cmpgt_epi32( vay1, by0 ) ) );
+
+    bits |= (unsigned int) _mm256_movemask_ps( _mm256_castsi256_ps( hit ) ) << i;
+  }
+
+  return bits;
+}
+#endif
+
+typedef unsigned int (*RectSetBlockFunc)( const RectSet&, int, int, int, int, int );
+
+// Kernel used by the queries below. Picked from the CPU on first use,
+// rectset_use_kernel() forces one (it falls back to scalar if the CPU
+// can't run it).
+inline RectSetKernel& rectset_kernel_slot()
+{
+  static RectSetKernel kernel =
+#ifdef RECTSET_X86
+    __builtin_cpu_supports( "avx2" ) ? RECTSET_AVX2 : RECTSET_SSE2;
+#else
+    RECTSET_SCALAR;
+#endif
+  return kernel;
+}
+
+inline bool rectset_supports( RectSetKernel kernel )
+{
+#ifdef RECTSET_X86
+  if( kernel == RECTSET_AVX2 ) {
+    return __builtin_cpu_supports( "avx2" );
+  }
+  return true;
+#else
+  return kernel == RECTSET_SCALAR;
+#endif
+}
+
+inline void rectset_use_kernel( RectSetKernel kernel )
+{
+  rectset_kernel_slot() = rectset_supports( kernel ) ? kernel : RECTSET_SCALAR;
+}
+
+inline RectSetKernel rectset_kernel()
+{
+  return rectset_kernel_slot();
+}
+
+inline RectSetBlockFunc rectset_block_func()
+{
+  switch( rectset_kernel_slot() ) {
+#ifdef RECTSET_X86
+  case RECTSET_AVX2:
+    return rectset_block_avx2;
+  case RECTSET_SSE2:
+    return rectset_block_sse2;
+#endif
+  default:
+    return rectset_block_scalar;
+  }
+}
+
+// Does box overlap any rect of set
+inline bool check_collision( const SDL_Rect& box, const RectSet& set )
+{
+  RectSetBlockFunc block = rectset_block_func();
+  int ax0 = box.x, ay0 = box.y, ax1 = box.x + box.w, ay1 = box.y + box.h;
+
+  for( int first = 0; first < set.size(); first += RECTSET_BLOCK ) {
+    if( block( set, first, ax0, ay0, ax1, ay1 ) ) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+// Does any rect of a overlap any rect of b
+inline bool check_collision( const RectSet& a, const RectSet& b )
+{
+  RectSetBlockFunc block = rectset_block_func();
+
+  for( int i = 0; i < a.size(); ++i ) {
+    int ax0 = a.x0()[ i ], ay0 = a.y0()[ i ], ax1 = a.x1()[ i ], ay1 = a.y1()[ i ];
+
+    for( int first = 0; first < b.size(); first += RECTSET_BLOCK ) {
+      if( block( b, first, ax0, ay0, ax1, ay1 ) ) {
+	return true;
+      }
+    }
+  }
+
+  return false;
+}
+
+// Appends the index of every rect of set that box overlaps
+inline void find_overlaps( const SDL_Rect& box, const RectSet& set, std::vector<int>& hits )
+{
+  RectSetBlockFunc block = rectset_block_func();
+  int ax0 = box.x, ay0 = box.y, ax1 = box.x + box.w, ay1 = box.y + box.h;
+
+  for( int first = 0; first < set.size(); first += RECTSET_BLOCK ) {
+    unsigned int bits = block( set, first, ax0, ay0, ax1, ay1 );
+
+    while( bits ) {
+      hits.push_back( first + __builtin_ctz( bits ) );
+      bits &= bits - 1;
+    }
+  }
+}
+
+#endif
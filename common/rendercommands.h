@@ -0,0 +1,300 @@
+#ifndef RENDERCOMMANDS_H
+#define RENDERCOMMANDS_H
+
+#include <SDL/SDL.h>
+#include <vector>
+#include "dirtyrects.h"
+#include "spansprite.h"
+
+// Render command buffer.
+// Draws are recorded instead of done right away. At the end of the frame
+// they are sorted by layer and then by source surface, draws that cannot
+// change the picture are dropped, and the rest run in one pass. Layers
+// give the draw order; within a layer, draws of the same surface stay in
+// the order they were made, but draws of different surfaces may swap, so
+// things that overlap and must be drawn in order need separate layers.
+//
+// A draw is dropped when an opaque draw later in the frame covers it, or
+// when it repeats an earlier identical draw that nothing has drawn over
+// since. Blended (SDL_SRCALPHA) draws are never treated as repeats, as
+// drawing them twice is not the same as drawing them once.
+//
+// The recorded commands can be kept and replayed, see bench/rendercommands.
+
+// How far back to look for a repeat of a draw
+const int RENDER_REPEAT_WINDOW = 32;
+
+struct RenderCommand {
+  // Layer in the high 16 bits, source surface number in the low 16, so
+  // layers go from 0 to 65535 and a frame can use 65535 surfaces
+  Uint32 key;
+
+  // NULL source for a fill
+  SDL_Surface* source;
+  SDL_Rect clip;
+  Uint32 color;
+
+  // Screen area the command writes, clipping included
+  SDL_Rect rect;
+};
+
+class RenderQueue {
+private:
+  std::vector<RenderCommand> commands, sorted;
+  std::vector<SDL_Surface*> sources;
+  std::vector<SDL_Rect> opaque;
+  std::vector<char> keep;
+  int width, height;
+  int dropped;
+
+  // Small number per source surface, in order of first use this frame
+  int source_id( SDL_Surface* source ) {
+    for( int s = 0; s < sources.size(); ++s ) {
+      if( sources[ s ] == source ) {
+	return s + 1;
+      }
+    }
+    sources.push_back( source );
+    return sources.size();
+  }
+
+  bool clip_to_screen( SDL_Rect& r ) const {
+    int x0 = r.x < 0 ? 0 : r.x, y0 = r.y < 0 ? 0 : r.y;
+    int x1 = r.x + r.w > width ? width : r.x + r.w;
+    int y1 = r.y + r.h > height ? height : r.y + r.h;
+
+    if( x1 <= x0 || y1 <= y0 ) {
+      return false;
+    }
+
+    r.x = x0; r.y = y0;
+    r.w = x1 - x0; r.h = y1 - y0;
+    return true;
+  }
+
+  static bool overlaps( const SDL_Rect& a, const SDL_Rect& b ) {
+    return !( a.y + a.h <= b.y || a.y >= b.y + b.h || a.x + a.w <= b.x || a.x >= b.x + b.w );
+  }
+
+  static bool contains( const SDL_Rect& outer, const SDL_Rect& inner ) {
+    return inner.x >= outer.x && inner.y >= outer.y &&
+      inner.x + inner.w <= outer.x + outer.w && inner.y + inner.h <= outer.y + outer.h;
+  }
+
+  static bool is_opaque( const RenderCommand& c ) {
+    return c.source == NULL || ( c.source->flags & ( SDL_SRCCOLORKEY | SDL_SRCALPHA ) ) == 0;
+  }
+
+  static bool same_draw( const RenderCommand& a, const RenderCommand& b ) {
+    if( a.source != b.source || a.rect.x != b.rect.x || a.rect.y != b.rect.y ||
+	a.rect.w != b.rect.w || a.rect.h != b.rect.h ) {
+      return false;
+    }
+    if( a.source == NULL ) {
+      return a.color == b.color;
+    }
+    return a.clip.x == b.clip.x && a.clip.y == b.clip.y && ( a.source->flags & SDL_SRCALPHA ) == 0;
+  }
+
+  void push( int layer, const RenderCommand& c ) {
+    RenderCommand command = c;
+    command.key = (Uint32) layer << 16 | ( c.source ? source_id( c.source ) : 0 );
+    commands.push_back( command );
+  }
+
+  // Stable LSD radix sort on the key, a byte at a time, skipping bytes
+  // that are the same in every command
+  void sort_commands() {
+    sorted.resize( commands.size() );
+
+    for( int shift = 0; shift < 32; shift += 8 ) {
+      int count[ 257 ] = { 0 };
+
+      for( int c = 0; c < commands.size(); ++c ) {
+	++count[ ( ( commands[ c ].key >> shift ) & 0xFF ) + 1 ];
+      }
+      if( count[ ( ( commands[ 0 ].key >> shift ) & 0xFF ) + 1 ] == commands.size() ) {
+	continue;
+      }
+      for( int b = 0; b < 256; ++b ) {
+	count[ b + 1 ] += count[ b ];
+      }
+      for( int c = 0; c < commands.size(); ++c ) {
+	sorted[ count[ ( commands[ c ].key >> shift ) & 0xFF ]++ ] = commands[ c ];
+      }
+      commands.swap( sorted );
+    }
+  }
+
+  // Marks the draws that can be left out
+  void cull() {
+    keep.assign( commands.size(), 1 );
+
+    // Covered by an opaque draw made after it
+    opaque.clear();
+    for( int c = commands.size() - 1; c >= 0; --c ) {
+      for( int o = 0; o < opaque.size(); ++o ) {
+	if( contains( opaque[ o ], commands[ c ].rect ) ) {
+	  keep[ c ] = 0;
+	  break;
+	}
+      }
+      if( keep[ c ] && is_opaque( commands[ c ] ) ) {
+	opaque.push_back( commands[ c ].rect );
+      }
+    }
+
+    // Same as an earlier draw that nothing in between touched
+    for( int c = 0; c < commands.size(); ++c ) {
+      if( !keep[ c ] ) {
+	continue;
+      }
+
+      for( int p = c - 1; p >= 0 && p >= c - RENDER_REPEAT_WINDOW; --p ) {
+	if( !keep[ p ] ) {
+	  continue;
+	}
+	if( same_draw( commands[ p ], commands[ c ] ) ) {
+	  keep[ c ] = 0;
+	  break;
+	}
+	if( overlaps( commands[ p ].rect, commands[ c ].rect ) ) {
+	  break;
+	}
+      }
+    }
+
+    for( int c = 0; c < commands.size(); ++c ) {
+      dropped += !keep[ c ];
+    }
+  }
+
+public:
+  RenderQueue( int theWidth, int theHeight ) {
+    width = theWidth;
+    height = theHeight;
+    dropped = 0;
+  }
+
+  // Records a blit like apply_surface, on the given layer
+  void blit( int layer, int x, int y, SDL_Surface* source, SDL_Rect* clip = NULL ) {
+    RenderCommand c;
+
+    c.source = source;
+    c.color = 0;
+    c.clip.x = clip ? clip->x : 0;
+    c.clip.y = clip ? clip->y : 0;
+    c.clip.w = clip ? clip->w : source->w;
+    c.clip.h = clip ? clip->h : source->h;
+
+    c.rect.x = x;
+    c.rect.y = y;
+    c.rect.w = c.clip.w;
+    c.rect.h = c.clip.h;
+
+    // Keep the source rect lined up with what is left on screen
+    SDL_Rect onScreen = c.rect;
+    if( !clip_to_screen( onScreen ) ) {
+      return;
+    }
+    c.clip.x += onScreen.x - x;
+    c.clip.y += onScreen.y - y;
+    c.clip.w = onScreen.w;
+    c.clip.h = onScreen.h;
+    c.rect = onScreen;
+
+    push( layer, c );
+  }
+
+  // Records a solid fill, on the given layer
+  void fill( int layer, const SDL_Rect& rect, Uint32 color ) {
+    RenderCommand c;
+
+    c.source = NULL;
+    c.color = color;
+    c.rect = rect;
+    if( !clip_to_screen( c.rect ) ) {
+      return;
+    }
+    c.clip = c.rect;
+
+    push( layer, c );
+  }
+
+  // Sorts and culls what was recorded, leaves it in get_commands()
+  void prepare() {
+    if( !commands.empty() ) {
+      sort_commands();
+      cull();
+
+      int kept = 0;
+      for( int c = 0; c < commands.size(); ++c ) {
+	if( keep[ c ] ) {
+	  commands[ kept++ ] = commands[ c ];
+	}
+      }
+      commands.resize( kept );
+    }
+  }
+
+  // Draws everything recorded onto screen in one pass, then clears
+  void execute( SDL_Surface* screen ) {
+    prepare();
+    draw( screen );
+  }
+
+  // Draws the commands as they are, for a frame prepare() already ran
+  // on, then clears
+  void draw( SDL_Surface* screen ) {
+    for( int c = 0; c < commands.size(); ++c ) {
+      SDL_Rect from = commands[ c ].clip, to = commands[ c ].rect;
+
+      if( commands[ c ].source ) {
+	span_blit( commands[ c ].source, &from, screen, &to );
+      } else {
+	SDL_FillRect( screen, &to, commands[ c ].color );
+      }
+    }
+
+    clear();
+  }
+
+  // Same, through a dirty rectangle renderer so only changes are presented
+  void execute( DirtyRects& renderer ) {
+    prepare();
+
+    for( int c = 0; c < commands.size(); ++c ) {
+      if( commands[ c ].source ) {
+	SDL_Rect from = commands[ c ].clip;
+	renderer.blit( commands[ c ].rect.x, commands[ c ].rect.y, commands[ c ].source, &from );
+      } else {
+	renderer.fill( commands[ c ].rect, commands[ c ].color );
+      }
+    }
+
+    clear();
+  }
+
+  // Forgets the frame's commands (kept ones included) and sources
+  void clear() {
+    commands.clear();
+    sources.clear();
+  }
+
+  // The recorded commands; in the sorted and culled order after prepare()
+  const std::vector<RenderCommand>& get_commands() const {
+    return commands;
+  }
+
+  // Replaces the recorded commands, e.g. with a frame captured earlier
+  void replay( const std::vector<RenderCommand>& frame ) {
+    commands = frame;
+  }
+
+  // Draws left out since the queue was made
+  int get_dropped() const {
+    return dropped;
+  }
+};
+
+#endif
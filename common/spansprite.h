@@ -0,0 +1,183 @@
+#ifndef SPANSPRITE_H
+#define SPANSPRITE_H
+
+#include <SDL/SDL.h>
+#include <string.h>
+#include <vector>
+#include <unordered_map>
+#include "colorkeyblit.h"
+
+// Opaque span encoding for colorkeyed sprites.
+// span_encode() scans a colorkeyed surface once and keeps, for every row,
+// the runs of pixels that are not the key. span_blit() then draws such a
+// surface one run at a time with memcpy, never looking at the key again
+// and skipping see through runs whole; surfaces that were not encoded
+// (or that colorkey_blit can't handle) go to colorkey_blit.
+//
+// Encoding takes a reference on the surface, so SDL_FreeSurface leaves it
+// alive until span_release() drops the encoding too.
+
+// A run of opaque pixels in a row
+struct Span {
+  Uint16 x, w;
+};
+
+class SpanSprite {
+private:
+  SDL_Surface* surface;
+  Uint32 colorkey;
+
+  // Spans of row y are spans[ rows[ y ] ] to spans[ rows[ y + 1 ] ]
+  std::vector<Span> spans;
+  std::vector<int> rows;
+
+public:
+  SpanSprite( SDL_Surface* theSurface ) {
+    surface = theSurface;
+    colorkey = surface->format->colorkey;
+
+    // Same key test as colorkey_blit
+    Uint32 mask = ~surface->format->Amask;
+    Uint32 key = colorkey & mask;
+
+    rows.push_back( 0 );
+    for( int y = 0; y < surface->h; ++y ) {
+      const Uint32* row = (const Uint32*) ( (const Uint8*) surface->pixels + y * surface->pitch );
+      int x = 0;
+
+      while( x < surface->w ) {
+	while( x < surface->w && ( row[ x ] & mask ) == key ) {
+	  ++x;
+	}
+
+	int start = x;
+	while( x < surface->w && ( row[ x ] & mask ) != key ) {
+	  ++x;
+	}
+
+	if( x > start ) {
+	  Span span = { (Uint16) start, (Uint16) ( x - start ) };
+	  spans.push_back( span );
+	}
+      }
+
+      rows.push_back( spans.size() );
+    }
+  }
+
+  // False once the surface's colorkey is no longer the one encoded
+  bool is_current() const {
+    return ( surface->flags & SDL_SRCCOLORKEY ) && surface->format->colorkey == colorkey;
+  }
+
+  // Draws from, already clipped to both surfaces, at (x, y) of dst
+  void draw( const SDL_Rect& from, SDL_Surface* dst, int x, int y ) const {
+    int x0 = from.x, x1 = from.x + from.w;
+
+    for( int row = 0; row < from.h; ++row ) {
+      const Uint32* in = (const Uint32*) ( (const Uint8*) surface->pixels + ( from.y + row ) * surface->pitch );
+      Uint32* out = (Uint32*) ( (Uint8*) dst->pixels + ( y + row ) * dst->pitch ) + x - x0;
+      int last = rows[ from.y + row + 1 ];
+
+      for( int s = rows[ from.y + row ]; s < last; ++s ) {
+	int start = spans[ s ].x, end = start + spans[ s ].w;
+
+	if( start >= x1 ) {
+	  break;
+	}
+	if( start < x0 ) {
+	  start = x0;
+	}
+	if( end > x1 ) {
+	  end = x1;
+	}
+	if( end > start ) {
+	  memcpy( out + start, in + start, ( end - start ) * 4 );
+	}
+      }
+    }
+  }
+
+  int get_span_count() const {
+    return spans.size();
+  }
+};
+
+inline std::unordered_map<SDL_Surface*, SpanSprite*>& span_sprites()
+{
+  static std::unordered_map<SDL_Surface*, SpanSprite*> sprites;
+  return sprites;
+}
+
+// Encodes a colorkeyed 32 bit surface, does nothing for anything else
+inline void span_encode( SDL_Surface* surface )
+{
+  if( !colorkey_blit_handles( surface, surface ) || span_sprites().count( surface ) ) {
+    return;
+  }
+
+  if( SDL_MUSTLOCK( surface ) && SDL_LockSurface( surface ) < 0 ) {
+    return;
+  }
+  span_sprites()[ surface ] = new SpanSprite( surface );
+  if( SDL_MUSTLOCK( surface ) ) {
+    SDL_UnlockSurface( surface );
+  }
+
+  ++surface->refcount;
+}
+
+// Drops the encoding and its reference on the surface
+inline void span_release( SDL_Surface* surface )
+{
+  std::unordered_map<SDL_Surface*, SpanSprite*>::iterator found = span_sprites().find( surface );
+
+  if( found != span_sprites().end() ) {
+    delete found->second;
+    span_sprites().erase( found );
+    SDL_FreeSurface( surface );
+  }
+}
+
+// Same as SDL_BlitSurface, dstrect gets the area drawn
+inline int span_blit( SDL_Surface* src, SDL_Rect* srcrect, SDL_Surface* dst, SDL_Rect* dstrect )
+{
+  std::unordered_map<SDL_Surface*, SpanSprite*>::iterator found = span_sprites().find( src );
+
+  if( found == span_sprites().end() || !found->second->is_current() || !colorkey_blit_handles( src, dst ) ) {
+    return colorkey_blit( src, srcrect, dst, dstrect );
+  }
+
+  SDL_Rect fullDst, from;
+  if( dstrect == NULL ) {
+    fullDst.x = fullDst.y = 0;
+    dstrect = &fullDst;
+  }
+
+  if( !colorkey_clip( src, srcrect, dst, dstrect, from ) ) {
+    return 0;
+  }
+
+  if( SDL_MUSTLOCK( src ) && SDL_LockSurface( src ) < 0 ) {
+    return -1;
+  }
+  if( SDL_MUSTLOCK( dst ) && SDL_LockSurface( dst ) < 0 ) {
+    if( SDL_MUSTLOCK( src ) ) {
+      SDL_UnlockSurface( src );
+    }
+    return -1;
+  }
+
+  found->second->draw( from, dst, dstrect->x, dstrect->y );
+
+  if( SDL_MUSTLOCK( dst ) ) {
+    SDL_UnlockSurface( dst );
+  }
+  if( SDL_MUSTLOCK( src ) ) {
+    SDL_UnlockSurface( src );
+  }
+
+  return 0;
+}
+
+#endif
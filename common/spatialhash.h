@@ -0,0 +1,246 @@
+#ifndef SPATIALHASH_H
+#define SPATIALHASH_H
+
+#include <SDL/SDL.h>
+#include <vector>
+#include <utility>
+
+// Uniform grid broad phase.
+// Each entity is inserted with the bounds of its box set and bucketed
+// into every cell those bounds touch. Only entities sharing a cell are
+// reported as candidate pairs, so the expensive box-vs-box narrow phase
+// is skipped for everything that is far apart.
+class SpatialHash {
+private:
+  struct Entry {
+    int cx, cy;
+    int id;
+  };
+
+  struct Bounds {
+    int x0, y0, x1, y1;
+  };
+
+  int cellSize;
+  unsigned int bucketMask;
+
+  std::vector<Bounds> bounds;
+  std::vector<Entry> entries;
+
+  // Bucketed (counting sorted) copy of entries, bucketStart[b]..bucketStart[b+1]
+  std::vector<Entry> sorted;
+  std::vector<int> bucketStart;
+  bool built;
+
+  static int floor_div( int v, int d ) {
+    return v >= 0 ? v / d : -((-v + d - 1) / d);
+  }
+
+  unsigned int hash_cell( int cx, int cy ) const {
+    return ( (unsigned int) cx * 73856093u ^ (unsigned int) cy * 19349663u ) & bucketMask;
+  }
+
+  // Counting sort of the entries into their buckets
+  void build() {
+    int buckets = bucketMask + 1;
+
+    bucketStart.assign( buckets + 1, 0 );
+    for( int e = 0; e < entries.size(); ++e ) {
+      ++bucketStart[ hash_cell( entries[ e ].cx, entries[ e ].cy ) + 1 ];
+    }
+    for( int b = 0; b < buckets; ++b ) {
+      bucketStart[ b + 1 ] += bucketStart[ b ];
+    }
+
+    std::vector<int> fill( bucketStart.begin(), bucketStart.end() - 1 );
+    sorted.resize( entries.size() );
+    for( int e = 0; e < entries.size(); ++e ) {
+      sorted[ fill[ hash_cell( entries[ e ].cx, entries[ e ].cy ) ]++ ] = entries[ e ];
+    }
+
+    built = true;
+  }
+
+  bool overlaps( const Bounds& a, const Bounds& b ) const {
+    return !( a.y1 <= b.y0 || a.y0 >= b.y1 || a.x1 <= b.x0 || a.x0 >= b.x1 );
+  }
+
+public:
+  // cell: edge length of a grid cell in pixels, should be about the size
+  // of the biggest entity. buckets: hash table size, rounded up to a
+  // power of two.
+  SpatialHash( int cell, int buckets = 4096 ) {
+    cellSize = cell > 0 ? cell : 1;
+
+    unsigned int size = 1;
+    while( size < (unsigned int) buckets ) {
+      size <<= 1;
+    }
+    bucketMask = size - 1;
+
+    built = false;
+  }
+
+  int cell_size() {
+    return cellSize;
+  }
+
+  // Number of (entity, cell) entries currently stored
+  int entry_count() {
+    return entries.size();
+  }
+
+  void clear() {
+    bounds.clear();
+    entries.clear();
+    built = false;
+  }
+
+  // Inserts a box set placed at (dx, dy) and returns its id (ids are
+  // handed out in order)
+  int insert( const std::vector<SDL_Rect>& boxes, int dx = 0, int dy = 0 ) {
+    Bounds b;
+    b.x0 = b.y0 = 0;
+    b.x1 = b.y1 = 0;
+
+    for( int i = 0; i < boxes.size(); ++i ) {
+      int x0 = boxes[ i ].x + dx, y0 = boxes[ i ].y + dy;
+      int x1 = x0 + boxes[ i ].w, y1 = y0 + boxes[ i ].h;
+
+      if( i == 0 ) {
+	b.x0 = x0; b.y0 = y0; b.x1 = x1; b.y1 = y1;
+      } else {
+	if( x0 < b.x0 ) b.x0 = x0;
+	if( y0 < b.y0 ) b.y0 = y0;
+	if( x1 > b.x1 ) b.x1 = x1;
+	if( y1 > b.y1 ) b.y1 = y1;
+      }
+    }
+
+    int id = bounds.size();
+    bounds.push_back( b );
+
+    // Empty sets never collide, so they take no cells
+    if( b.x1 <= b.x0 || b.y1 <= b.y0 ) {
+      return id;
+    }
+
+    int cx0 = floor_div( b.x0, cellSize ), cx1 = floor_div( b.x1 - 1, cellSize );
+    int cy0 = floor_div( b.y0, cellSize ), cy1 = floor_div( b.y1 - 1, cellSize );
+
+    for( int cy = cy0; cy <= cy1; ++cy ) {
+      for( int cx = cx0; cx <= cx1; ++cx ) {
+	Entry e;
+	e.cx = cx;
+	e.cy = cy;
+	e.id = id;
+	entries.push_back( e );
+      }
+    }
+
+    built = false;
+    return id;
+  }
+
+  // Appends every pair (a < b) whose bounds overlap, each exactly once.
+  // A pair is only reported from the cell holding the top left corner of
+  // the overlap of both bounds, so no dedupe set is needed.
+  void find_pairs( std::vector< std::pair<int, int> >& pairs ) {
+    if( !built ) {
+      build();
+    }
+
+    int buckets = bucketMask + 1;
+
+    for( int bkt = 0; bkt < buckets; ++bkt ) {
+      int first = bucketStart[ bkt ], last = bucketStart[ bkt + 1 ];
+
+      for( int i = first; i < last; ++i ) {
+	const Entry& ei = sorted[ i ];
+
+	for( int j = i + 1; j < last; ++j ) {
+	  const Entry& ej = sorted[ j ];
+
+	  // Different cells that happen to hash to the same bucket
+	  if( ei.cx != ej.cx || ei.cy != ej.cy || ei.id == ej.id ) {
+	    continue;
+	  }
+
+	  const Bounds& a = bounds[ ei.id ];
+	  const Bounds& b = bounds[ ej.id ];
+
+	  if( !overlaps( a, b ) ) {
+	    continue;
+	  }
+
+	  int ox = a.x0 > b.x0 ? a.x0 : b.x0;
+	  int oy = a.y0 > b.y0 ? a.y0 : b.y0;
+
+	  if( floor_div( ox, cellSize ) != ei.cx || floor_div( oy, cellSize ) != ei.cy ) {
+	    continue;
+	  }
+
+	  if( ei.id < ej.id ) {
+	    pairs.push_back( std::make_pair( ei.id, ej.id ) );
+	  } else {
+	    pairs.push_back( std::make_pair( ej.id, ei.id ) );
+	  }
+	}
+      }
+    }
+  }
+
+  // Appends the ids of every entity whose bounds overlap the given box set
+  // placed at (dx, dy)
+  void query( const std::vector<SDL_Rect>& boxes, std::vector<int>& ids, int dx = 0, int dy = 0 ) {
+    if( !built ) {
+      build();
+    }
+
+    std::vector<int> seen;
+
+    for( int i = 0; i < boxes.size(); ++i ) {
+      if( boxes[ i ].w == 0 || boxes[ i ].h == 0 ) {
+	continue;
+      }
+
+      Bounds q;
+      q.x0 = boxes[ i ].x + dx;
+      q.y0 = boxes[ i ].y + dy;
+      q.x1 = q.x0 + boxes[ i ].w;
+      q.y1 = q.y0 + boxes[ i ].h;
+
+      int cx0 = floor_div( q.x0, cellSize ), cx1 = floor_div( q.x1 - 1, cellSize );
+      int cy0 = floor_div( q.y0, cellSize ), cy1 = floor_div( q.y1 - 1, cellSize );
+
+      for( int cy = cy0; cy <= cy1; ++cy ) {
+	for( int cx = cx0; cx <= cx1; ++cx ) {
+	  unsigned int bkt = hash_cell( cx, cy );
+
+	  for( int e = bucketStart[ bkt ]; e < bucketStart[ bkt + 1 ]; ++e ) {
+	    const Entry& en = sorted[ e ];
+
+	    if( en.cx != cx || en.cy != cy || !overlaps( q, bounds[ en.id ] ) ) {
+	      continue;
+	    }
+
+	    bool dup = false;
+	    for( int s = 0; s < seen.size(); ++s ) {
+	      if( seen[ s ] == en.id ) {
+		dup = true;
+		break;
+	      }
+	    }
+
+	    if( !dup ) {
+	      seen.push_back( en.id );
+	      ids.push_back( en.id );
+	    }
+	  }
+	}
+      }
+    }
+  }
+};
+
+#endif
@@ -0,0 +1,211 @@
+#ifndef SWEEPPRUNE_H
+#define SWEEPPRUNE_H
+
+#include <SDL/SDL.h>
+#include <vector>
+#include <set>
+#include <utility>
+#include <unordered_set>
+
+// Sort and sweep (sweep and prune) broad phase with temporal coherence.
+// The min and max sides of every rect are kept sorted on both axes.
+// Between frames things move a little, so the lists are nearly sorted
+// and an insertion sort puts them back in O(n + swaps). Each swap of a
+// min past a max is the only place a pair can start or stop overlapping,
+// so the overlapping pair set is kept up to date from the swaps alone,
+// and update() hands back what changed rather than the whole set.
+//
+// Touching is not overlapping, same as check_collision: at equal values
+// max sides sort before min sides.
+
+class SweepAndPrune {
+private:
+  struct Endpoint {
+    int value;
+    int owner;
+    bool isMax;
+  };
+
+  struct Box {
+    int x0, y0, x1, y1;
+    bool alive;
+  };
+
+  std::vector<Box> boxes;
+  std::vector<int> freeIds;
+  std::vector<Endpoint> axis[ 2 ];
+
+  std::unordered_set<Uint64> pairs;
+  std::set<Uint64> added, removed;
+
+  static Uint64 key( int a, int b ) {
+    if( a > b ) {
+      int t = a; a = b; b = t;
+    }
+    return (Uint64) a << 32 | (Uint32) b;
+  }
+
+  static bool before( const Endpoint& a, const Endpoint& b ) {
+    return a.value < b.value || ( a.value == b.value && a.isMax && !b.isMax );
+  }
+
+  bool overlaps( int a, int b ) const {
+    const Box& p = boxes[ a ];
+    const Box& q = boxes[ b ];
+    return !( p.y1 <= q.y0 || p.y0 >= q.y1 || p.x1 <= q.x0 || p.x0 >= q.x1 );
+  }
+
+  void add_pair( int a, int b ) {
+    Uint64 k = key( a, b );
+
+    if( !pairs.insert( k ).second ) {
+      return;
+    }
+    if( !removed.erase( k ) ) {
+      added.insert( k );
+    }
+  }
+
+  void remove_pair( int a, int b ) {
+    Uint64 k = key( a, b );
+
+    if( !pairs.erase( k ) ) {
+      return;
+    }
+    if( !added.erase( k ) ) {
+      removed.insert( k );
+    }
+  }
+
+  int side( const Endpoint& e, int a ) const {
+    const Box& b = boxes[ e.owner ];
+    if( a == 0 ) {
+      return e.isMax ? b.x1 : b.x0;
+    }
+    return e.isMax ? b.y1 : b.y0;
+  }
+
+  // Insertion sort of one axis, turning swaps into pair changes
+  void sort_axis( int a ) {
+    std::vector<Endpoint>& list = axis[ a ];
+
+    for( int i = 1; i < list.size(); ++i ) {
+      Endpoint moving = list[ i ];
+      int j = i - 1;
+
+      while( j >= 0 && before( moving, list[ j ] ) ) {
+	const Endpoint& passed = list[ j ];
+
+	if( moving.owner != passed.owner ) {
+	  if( !moving.isMax && passed.isMax ) {
+	    // A min moved below a max: may overlap now
+	    if( overlaps( moving.owner, passed.owner ) ) {
+	      add_pair( moving.owner, passed.owner );
+	    }
+	  } else if( moving.isMax && !passed.isMax ) {
+	    // A max moved below a min: apart on this axis
+	    remove_pair( moving.owner, passed.owner );
+	  }
+	}
+
+	list[ j + 1 ] = list[ j ];
+	--j;
+      }
+
+      list[ j + 1 ] = moving;
+    }
+  }
+
+public:
+  // Adds a rect and returns its id. Its pairs show up in the next update().
+  int add( const SDL_Rect& rect ) {
+    int id;
+
+    if( !freeIds.empty() ) {
+      id = freeIds.back();
+      freeIds.pop_back();
+    } else {
+      id = boxes.size();
+      boxes.push_back( Box() );
+    }
+
+    boxes[ id ].alive = true;
+    move( id, rect );
+
+    // Start past everything and let the sort move it in place
+    for( int a = 0; a < 2; ++a ) {
+      Endpoint e;
+      e.owner = id;
+      e.isMax = false;
+      e.value = side( e, a );
+      axis[ a ].push_back( e );
+      e.isMax = true;
+      e.value = side( e, a );
+      axis[ a ].push_back( e );
+    }
+
+    return id;
+  }
+
+  void remove( int id ) {
+    for( int other = 0; other < boxes.size(); ++other ) {
+      if( other != id && boxes[ other ].alive && pairs.count( key( id, other ) ) ) {
+	remove_pair( id, other );
+      }
+    }
+
+    for( int a = 0; a < 2; ++a ) {
+      std::vector<Endpoint>& list = axis[ a ];
+      int kept = 0;
+
+      for( int i = 0; i < list.size(); ++i ) {
+	if( list[ i ].owner != id ) {
+	  list[ kept++ ] = list[ i ];
+	}
+      }
+      list.resize( kept );
+    }
+
+    boxes[ id ].alive = false;
+    freeIds.push_back( id );
+  }
+
+  // Sets a rect's new position, applied at the next update()
+  void move( int id, const SDL_Rect& rect ) {
+    boxes[ id ].x0 = rect.x;
+    boxes[ id ].y0 = rect.y;
+    boxes[ id ].x1 = rect.x + rect.w;
+    boxes[ id ].y1 = rect.y + rect.h;
+  }
+
+  // Re-sorts both axes and appends the pairs that started and stopped
+  // overlapping since the last update, smaller id first, sorted.
+  void update( std::vector< std::pair<int, int> >& started, std::vector< std::pair<int, int> >& stopped ) {
+    for( int a = 0; a < 2; ++a ) {
+      for( int i = 0; i < axis[ a ].size(); ++i ) {
+	axis[ a ][ i ].value = side( axis[ a ][ i ], a );
+      }
+      sort_axis( a );
+    }
+
+    for( std::set<Uint64>::iterator k = added.begin(); k != added.end(); ++k ) {
+      started.push_back( std::make_pair( (int) ( *k >> 32 ), (int) ( *k & 0xFFFFFFFF ) ) );
+    }
+    for( std::set<Uint64>::iterator k = removed.begin(); k != removed.end(); ++k ) {
+      stopped.push_back( std::make_pair( (int) ( *k >> 32 ), (int) ( *k & 0xFFFFFFFF ) ) );
+    }
+
+    added.clear();
+    removed.clear();
+  }
+
+  int pair_count() const {
+    return pairs.size();
+  }
+
+  bool is_overlapping( int a, int b ) const {
+    return pairs.count( key( a, b ) ) != 0;
+  }
+};
+
+#endif
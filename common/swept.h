@@ -0,0 +1,477 @@
+#ifndef SWEPT_H
+#define SWEPT_H
+
+#include <SDL/SDL.h>
+#include <math.h>
+#include <vector>
+#include "circleset.h"
+#include "collision.h"
+
+// Swept (continuous) collision.
+// Instead of applying a whole step and undoing it on overlap, these find
+// the fraction of the step at which a moving shape first touches another
+// one, so fast shapes stop at thin walls instead of tunnelling through
+// them, and slide along whatever they hit. Touching is not a collision,
+// same as check_collision.
+
+// Maximum hits resolved in one move, each one removes a direction
+const int SWEEP_ITERATIONS = 3;
+
+struct SweepHit {
+  bool hit;
+
+  // Fraction of the step at first contact, 0 <= time < 1
+  double time;
+
+  // Unit normal of the surface that was hit, pointing at the mover
+  double nx, ny;
+};
+
+inline SweepHit sweep_miss()
+{
+  SweepHit miss;
+  miss.hit = false;
+  miss.time = 1;
+  miss.nx = miss.ny = 0;
+  return miss;
+}
+
+// Entry and exit times of a moving interval [a0, a1) against [b0, b1)
+inline bool sweep_axis( int a0, int a1, int v, int b0, int b1, double& enter, double& leave )
+{
+  if( v == 0 ) {
+    if( a1 <= b0 || a0 >= b1 ) {
+      return false;
+    }
+    enter = -HUGE_VAL;
+    leave = HUGE_VAL;
+  } else if( v > 0 ) {
+    enter = (double) ( b0 - a1 ) / v;
+    leave = (double) ( b1 - a0 ) / v;
+  } else {
+    enter = (double) ( b1 - a0 ) / v;
+    leave = (double) ( b0 - a1 ) / v;
+  }
+  return true;
+}
+
+// First contact of rect a moving by (vx, vy) with rect b.
+// Rects that already overlap are not reported, so a mover can always
+// get out of one.
+inline SweepHit sweep_aabb( const SDL_Rect& a, int vx, int vy, const SDL_Rect& b )
+{
+  double enterX, leaveX, enterY, leaveY;
+
+  if( !sweep_axis( a.x, a.x + a.w, vx, b.x, b.x + b.w, enterX, leaveX ) ||
+      !sweep_axis( a.y, a.y + a.h, vy, b.y, b.y + b.h, enterY, leaveY ) ) {
+    return sweep_miss();
+  }
+
+  double enter = enterX > enterY ? enterX : enterY;
+  double leave = leaveX < leaveY ? leaveX : leaveY;
+
+  if( enter >= leave || enter < 0 || enter >= 1 ) {
+    return sweep_miss();
+  }
+
+  SweepHit hit;
+  hit.hit = true;
+  hit.time = enter;
+  hit.nx = hit.ny = 0;
+
+  if( enterX > enterY ) {
+    hit.nx = vx > 0 ? -1 : 1;
+  } else {
+    hit.ny = vy > 0 ? -1 : 1;
+  }
+
+  return hit;
+}
+
+// First time in [0, 1) point (px, py) moving by (vx, vy) is closer than
+// r to (cx, cy). Starting inside only counts when moving further in.
+inline SweepHit sweep_point_circle( double px, double py, double vx, double vy, double cx, double cy, double r )
+{
+  double mx = px - cx, my = py - cy;
+  double a = vx * vx + vy * vy;
+  double b = mx * vx + my * vy;
+  double c = mx * mx + my * my - r * r;
+
+  if( c < 0 ) {
+    double len = sqrt( mx * mx + my * my );
+
+    if( b >= 0 || len == 0 ) {
+      return sweep_miss();
+    }
+
+    SweepHit hit;
+    hit.hit = true;
+    hit.time = 0;
+    hit.nx = mx / len;
+    hit.ny = my / len;
+    return hit;
+  }
+
+  if( a == 0 || b >= 0 ) {
+    return sweep_miss();
+  }
+
+  double disc = b * b - a * c;
+  if( disc < 0 ) {
+    return sweep_miss();
+  }
+
+  double t = ( -b - sqrt( disc ) ) / a;
+  if( t < 0 || t >= 1 ) {
+    return sweep_miss();
+  }
+
+  SweepHit hit;
+  hit.hit = true;
+  hit.time = t;
+  hit.nx = ( mx + vx * t ) / r;
+  hit.ny = ( my + vy * t ) / r;
+  return hit;
+}
+
+// First contact of circle (cx, cy, r) moving by (vx, vy) with circle (ox, oy, orad)
+inline SweepHit sweep_circle( int cx, int cy, int r, int vx, int vy, int ox, int oy, int orad )
+{
+  return sweep_point_circle( cx, cy, vx, vy, ox, oy, r + orad );
+}
+
+// First contact of circle (cx, cy, r) moving by (vx, vy) with rect b.
+// The center is swept against b grown by r; hits in the grown corners are
+// redone against a circle of radius r around the real corner.
+inline SweepHit sweep_circle( int cx, int cy, int r, int vx, int vy, const SDL_Rect& b )
+{
+  int x0 = b.x, y0 = b.y, x1 = b.x + b.w, y1 = b.y + b.h;
+
+  // Already touching the rect: only a hit when moving further in
+  int nearX = cx < x0 ? x0 : ( cx > x1 ? x1 : cx );
+  int nearY = cy < y0 ? y0 : ( cy > y1 ? y1 : cy );
+  if( ( cx - nearX ) * ( cx - nearX ) + ( cy - nearY ) * ( cy - nearY ) < r * r ) {
+    return sweep_point_circle( cx, cy, vx, vy, nearX, nearY, r );
+  }
+
+  // The center, a point, against the grown rect
+  double enterX, leaveX, enterY, leaveY;
+
+  if( !sweep_axis( cx, cx, vx, x0 - r, x1 + r, enterX, leaveX ) ||
+      !sweep_axis( cy, cy, vy, y0 - r, y1 + r, enterY, leaveY ) ) {
+    return sweep_miss();
+  }
+
+  double enter = enterX > enterY ? enterX : enterY;
+  double leave = leaveX < leaveY ? leaveX : leaveY;
+
+  if( enter >= leave || enter < 0 || enter >= 1 ) {
+    return sweep_miss();
+  }
+
+  double px = cx + vx * enter, py = cy + vy * enter;
+
+  // Face of the rect
+  if( ( px >= x0 && px <= x1 ) || ( py >= y0 && py <= y1 ) ) {
+    SweepHit hit;
+    hit.hit = true;
+    hit.time = enter;
+    hit.nx = hit.ny = 0;
+
+    if( enterX > enterY ) {
+      hit.nx = vx > 0 ? -1 : 1;
+    } else {
+      hit.ny = vy > 0 ? -1 : 1;
+    }
+    return hit;
+  }
+
+  // Rounded corner
+  return sweep_point_circle( cx, cy, vx, vy, px < x0 ? x0 : x1, py < y0 ? y0 : y1, r );
+}
+
+// Adds walls just outside a width x height screen, so movers stay on it
+// and slide along its edges
+inline void add_border_walls( std::vector<SDL_Rect>& walls, int width, int height )
+{
+  const int thickness = 1000;
+  SDL_Rect edge;
+
+  edge.x = -thickness; edge.y = -thickness; edge.w = thickness; edge.h = height + thickness * 2;
+  walls.push_back( edge );
+  edge.x = width;
+  walls.push_back( edge );
+  edge.x = 0; edge.y = -thickness; edge.w = width; edge.h = thickness;
+  walls.push_back( edge );
+  edge.y = height;
+  walls.push_back( edge );
+}
+
+inline void shift_boxes( std::vector<SDL_Rect>& boxes, int dx, int dy )
+{
+  for( int i = 0; i < boxes.size(); ++i ) {
+    boxes[ i ].x += dx;
+    boxes[ i ].y += dy;
+  }
+}
+
+// Keeps the earlier of first and the hit of box a moving by (vx, vy) with
+// wall b, along with the two boxes, all in world space
+inline void sweep_first( const SDL_Rect& a, int vx, int vy, const SDL_Rect& b, SweepHit& first, SDL_Rect& firstA, SDL_Rect& firstB )
+{
+  SweepHit hit = sweep_aabb( a, vx, vy, b );
+
+  if( hit.hit && hit.time < first.time ) {
+    first = hit;
+    firstA = a;
+    firstB = b;
+  }
+}
+
+// Moves whatever is at (x, y) by (vx, vy), stopping at the first wall in
+// the way and sliding along it with what is left of the step.
+// find( x, y, vx, vy, first, a, b ) does the sweep tests for one step,
+// keeping the first hit, the mover's box a and the wall b it runs into,
+// with sweep_first(). The distance along the hit normal is taken from
+// the integer rect sides, so the boxes end up exactly touching the wall.
+// Returns whether anything was hit.
+template<class FindFirst>
+inline bool slide( int& x, int& y, int vx, int vy, FindFirst find )
+{
+  bool hitAny = false;
+
+  for( int iteration = 0; iteration < SWEEP_ITERATIONS && ( vx || vy ); ++iteration ) {
+    SweepHit first = sweep_miss();
+    SDL_Rect a, b;
+
+    find( x, y, vx, vy, first, a, b );
+
+    if( !first.hit ) {
+      x += vx;
+      y += vy;
+      break;
+    }
+
+    hitAny = true;
+
+    int stepX, stepY;
+
+    if( first.nx != 0 ) {
+      stepX = vx > 0 ? b.x - ( a.x + a.w ) : ( b.x + b.w ) - a.x;
+      stepY = (int) ( first.time * vy );
+    } else {
+      stepX = (int) ( first.time * vx );
+      stepY = vy > 0 ? b.y - ( a.y + a.h ) : ( b.y + b.h ) - a.y;
+    }
+
+    x += stepX;
+    y += stepY;
+
+    // Keep moving along the wall only
+    if( first.nx != 0 ) {
+      vx = 0;
+      vy -= stepY;
+    } else {
+      vy = 0;
+      vx -= stepX;
+    }
+  }
+
+  return hitAny;
+}
+
+// Moves a box set against walls. The boxes are in local space and placed
+// at (x, y); only x and y are updated, the boxes are never written.
+inline bool move_and_slide( const std::vector<SDL_Rect>& boxes, int& x, int& y, int vx, int vy, const std::vector<SDL_Rect>& walls )
+{
+  return slide( x, y, vx, vy, [&]( int x, int y, int vx, int vy, SweepHit& first, SDL_Rect& a, SDL_Rect& b ) {
+      for( int i = 0; i < boxes.size(); ++i ) {
+	SDL_Rect placed = boxes[ i ];
+	placed.x += x;
+	placed.y += y;
+
+	for( int w = 0; w < walls.size(); ++w ) {
+	  sweep_first( placed, vx, vy, walls[ w ], first, a, b );
+	}
+      }
+    } );
+}
+
+// A shape in the way of a move, its boxes in local space and placed at
+// (x, y), same as for the offset check_collision()
+struct PlacedShape {
+  const BoxShape* shape;
+  int x, y;
+};
+
+// Bounds b placed at (x, y) and stretched over a move by (vx, vy), so
+// anything they can run into during the move overlaps them
+inline BoxShape::Bounds swept_bounds( const BoxShape::Bounds& b, int x, int y, int vx, int vy )
+{
+  BoxShape::Bounds swept = { b.x0 + x, b.y0 + y, b.x1 + x, b.y1 + y };
+
+  if( vx < 0 ) swept.x0 += vx; else swept.x1 += vx;
+  if( vy < 0 ) swept.y0 += vy; else swept.y1 += vy;
+
+  return swept;
+}
+
+// Moves a shape placed at (x, y) against other shapes, each at its own
+// offset, and walls in world space. Nothing is copied into world space,
+// a box is only placed for the one test it is in. Other shapes go through
+// the same two levels as check_collision( BoxShape, ... ): the mover's
+// outer box swept over the step against theirs, then its swept strips
+// against their strips, and boxes are only swept inside strips that meet.
+inline bool move_and_slide( const BoxShape& shape, int& x, int& y, int vx, int vy, const std::vector<PlacedShape>& others,
+			    const std::vector<SDL_Rect>& walls )
+{
+  const std::vector<SDL_Rect>& boxes = shape.get_boxes();
+  const std::vector<BoxShape::Strip>& strips = shape.get_strips();
+
+  return slide( x, y, vx, vy, [&]( int x, int y, int vx, int vy, SweepHit& first, SDL_Rect& a, SDL_Rect& b ) {
+      for( int i = 0; i < boxes.size(); ++i ) {
+	SDL_Rect placed = boxes[ i ];
+	placed.x += x;
+	placed.y += y;
+
+	for( int w = 0; w < walls.size(); ++w ) {
+	  sweep_first( placed, vx, vy, walls[ w ], first, a, b );
+	}
+      }
+
+      if( boxes.empty() ) {
+	return;
+      }
+
+      BoxShape::Bounds outer = swept_bounds( shape.bounds(), x, y, vx, vy );
+
+      for( int o = 0; o < others.size(); ++o ) {
+	const BoxShape& other = *others[ o ].shape;
+	int ox = others[ o ].x, oy = others[ o ].y;
+
+	if( other.get_boxes().empty() || !overlaps( outer, other.bounds(), ox, oy ) ) {
+	  continue;
+	}
+
+	const std::vector<BoxShape::Strip>& otherStrips = other.get_strips();
+
+	for( int sa = 0; sa < strips.size(); ++sa ) {
+	  BoxShape::Bounds strip = swept_bounds( strips[ sa ].bounds, x, y, vx, vy );
+
+	  if( !overlaps( strip, other.bounds(), ox, oy ) ) {
+	    continue;
+	  }
+
+	  for( int sb = 0; sb < otherStrips.size(); ++sb ) {
+	    if( !overlaps( strip, otherStrips[ sb ].bounds, ox, oy ) ) {
+	      continue;
+	    }
+
+	    for( int i = strips[ sa ].first; i < strips[ sa ].first + strips[ sa ].count; ++i ) {
+	      SDL_Rect placed = boxes[ i ];
+	      placed.x += x;
+	      placed.y += y;
+
+	      for( int j = otherStrips[ sb ].first; j < otherStrips[ sb ].first + otherStrips[ sb ].count; ++j ) {
+		SDL_Rect wall = other.get_boxes()[ j ];
+		wall.x += ox;
+		wall.y += oy;
+
+		sweep_first( placed, vx, vy, wall, first, a, b );
+	      }
+	    }
+	  }
+	}
+      }
+    } );
+}
+
+// Same for boxes already in world space, they are shifted by the distance
+// moved, which dx, dy also get
+inline bool move_and_slide( std::vector<SDL_Rect>& boxes, int vx, int vy, const std::vector<SDL_Rect>& walls, int& dx, int& dy )
+{
+  dx = dy = 0;
+
+  bool hitAny = move_and_slide( boxes, dx, dy, vx, vy, walls );
+  shift_boxes( boxes, dx, dy );
+
+  return hitAny;
+}
+
+// Does circle (cx, cy, r) overlap any wall or circle
+inline bool circle_overlaps( int cx, int cy, int r, const std::vector<SDL_Rect>& walls, const CircleSet& circles )
+{
+  for( int b = 0; b < walls.size(); ++b ) {
+    int nearX = cx < walls[ b ].x ? walls[ b ].x : ( cx > walls[ b ].x + walls[ b ].w ? walls[ b ].x + walls[ b ].w : cx );
+    int nearY = cy < walls[ b ].y ? walls[ b ].y : ( cy > walls[ b ].y + walls[ b ].h ? walls[ b ].y + walls[ b ].h : cy );
+
+    if( ( cx - nearX ) * ( cx - nearX ) + ( cy - nearY ) * ( cy - nearY ) < r * r ) {
+      return true;
+    }
+  }
+
+  return check_collision( cx, cy, r, circles );
+}
+
+// Moves circle (cx, cy, r) by (vx, vy) against rect walls and other
+// circles, stopping at first contact and sliding along the surface.
+// Positions are rounded towards the start of the step, and backed off a
+// pixel at a time if rounding still leaves them overlapping.
+inline bool move_and_slide( int& cx, int& cy, int r, int vx, int vy, const std::vector<SDL_Rect>& walls, const CircleSet& circles )
+{
+  bool hitAny = false;
+
+  for( int iteration = 0; iteration < SWEEP_ITERATIONS && ( vx || vy ); ++iteration ) {
+    SweepHit first = sweep_miss();
+
+    for( int b = 0; b < walls.size(); ++b ) {
+      SweepHit hit = sweep_circle( cx, cy, r, vx, vy, walls[ b ] );
+      if( hit.hit && hit.time < first.time ) {
+	first = hit;
+      }
+    }
+
+    for( int c = 0; c < circles.size(); ++c ) {
+      SweepHit hit = sweep_circle( cx, cy, r, vx, vy, circles.x()[ c ], circles.y()[ c ], circles.r()[ c ] );
+      if( hit.hit && hit.time < first.time ) {
+	first = hit;
+      }
+    }
+
+    int stepX = (int) ( first.time * vx );
+    int stepY = (int) ( first.time * vy );
+
+    while( ( stepX || stepY ) && circle_overlaps( cx + stepX, cy + stepY, r, walls, circles ) ) {
+      if( abs( stepX ) >= abs( stepY ) ) {
+	stepX -= stepX > 0 ? 1 : -1;
+      } else {
+	stepY -= stepY > 0 ? 1 : -1;
+      }
+    }
+
+    cx += stepX;
+    cy += stepY;
+
+    if( !first.hit ) {
+      break;
+    }
+
+    hitAny = true;
+
+    // What's left of the step, without the part going into the surface
+    double restX = vx - stepX, restY = vy - stepY;
+    double into = restX * first.nx + restY * first.ny;
+
+    if( into < 0 ) {
+      restX -= into * first.nx;
+      restY -= into * first.ny;
+    }
+
+    vx = (int) restX;
+    vy = (int) restY;
+  }
+
+  return hitAny;
+}
+
+#endif
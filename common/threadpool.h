@@ -0,0 +1,194 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <vector>
+#include <deque>
+#include <utility>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+// Work stealing thread pool for data parallel loops.
+// run() cuts [0, count) into chunks and deals them round robin to one
+// queue per worker. Workers take from the back of their own queue and,
+// when it runs dry, steal from the front of the others', so uneven
+// chunks still keep every core busy. The calling thread works too, as
+// the last worker, and run() returns once every chunk is done and every
+// worker has taken its turn, so no worker from one run() is still around
+// to take the chunks of the next.
+
+class ThreadPool {
+private:
+  struct Queue {
+    std::mutex lock;
+    std::deque< std::pair<int, int> > chunks;
+  };
+
+  std::vector<std::thread> threads;
+  std::vector<Queue*> queues;
+
+  std::mutex lock;
+  std::condition_variable wake, done;
+  std::function<void( int, int, int )> body;
+  std::atomic<int> remaining;
+  int generation;
+
+  // Workers in work() now, and workers that woke for this generation
+  int active, joined;
+  bool quit;
+
+  bool next_chunk( int worker, std::pair<int, int>& chunk ) {
+    {
+      std::lock_guard<std::mutex> own( queues[ worker ]->lock );
+      if( !queues[ worker ]->chunks.empty() ) {
+	chunk = queues[ worker ]->chunks.back();
+	queues[ worker ]->chunks.pop_back();
+	return true;
+      }
+    }
+
+    for( int i = 1; i < queues.size(); ++i ) {
+      Queue* victim = queues[ ( worker + i ) % queues.size() ];
+      std::lock_guard<std::mutex> other( victim->lock );
+
+      if( !victim->chunks.empty() ) {
+	chunk = victim->chunks.front();
+	victim->chunks.pop_front();
+	return true;
+      }
+    }
+
+    return false;
+  }
+
+  void work( int worker ) {
+    std::pair<int, int> chunk;
+
+    while( next_chunk( worker, chunk ) ) {
+      body( chunk.first, chunk.second, worker );
+
+      if( --remaining == 0 ) {
+	std::lock_guard<std::mutex> guard( lock );
+	done.notify_all();
+      }
+    }
+  }
+
+  void worker_main( int worker ) {
+    int seen = 0;
+
+    for( ;; ) {
+      std::unique_lock<std::mutex> guard( lock );
+      wake.wait( guard, [&]() { return quit || generation != seen; } );
+      if( quit ) {
+	return;
+      }
+      seen = generation;
+      ++active;
+      ++joined;
+      guard.unlock();
+
+      work( worker );
+
+      guard.lock();
+      if( --active == 0 ) {
+	done.notify_all();
+      }
+    }
+  }
+
+public:
+  // threads: total workers including the caller, 0 for one per core
+  ThreadPool( int count = 0 ) {
+    if( count <= 0 ) {
+      count = std::thread::hardware_concurrency();
+    }
+    if( count <= 0 ) {
+      count = 1;
+    }
+
+    remaining = 0;
+    generation = 0;
+    active = joined = 0;
+    quit = false;
+
+    for( int w = 0; w < count; ++w ) {
+      queues.push_back( new Queue );
+    }
+    for( int w = 0; w < count - 1; ++w ) {
+      threads.push_back( std::thread( &ThreadPool::worker_main, this, w ) );
+    }
+  }
+
+  ~ThreadPool() {
+    {
+      std::lock_guard<std::mutex> guard( lock );
+      quit = true;
+    }
+    wake.notify_all();
+
+    for( int t = 0; t < threads.size(); ++t ) {
+      threads[ t ].join();
+    }
+    for( int q = 0; q < queues.size(); ++q ) {
+      delete queues[ q ];
+    }
+  }
+
+  // Number of workers, callers size per worker buffers with it
+  int size() const {
+    return queues.size();
+  }
+
+  // Calls f( begin, end, worker ) over [0, count) in chunks of chunkSize
+  // and waits for all of them. worker is in [0, size()).
+  void run( int count, int chunkSize, std::function<void( int, int, int )> f ) {
+    if( count <= 0 ) {
+      return;
+    }
+    if( chunkSize <= 0 ) {
+      chunkSize = 1;
+    }
+
+    int chunks = ( count + chunkSize - 1 ) / chunkSize;
+
+    // Nothing to share, skip the wake ups
+    if( chunks == 1 || queues.size() == 1 ) {
+      for( int begin = 0; begin < count; begin += chunkSize ) {
+	f( begin, begin + chunkSize < count ? begin + chunkSize : count, queues.size() - 1 );
+      }
+      return;
+    }
+
+    // Published together, the workers only look once generation moves
+    {
+      std::lock_guard<std::mutex> guard( lock );
+
+      for( int c = 0; c < chunks; ++c ) {
+	int begin = c * chunkSize;
+	int end = begin + chunkSize < count ? begin + chunkSize : count;
+	Queue* queue = queues[ c % queues.size() ];
+
+	std::lock_guard<std::mutex> own( queue->lock );
+	queue->chunks.push_back( std::make_pair( begin, end ) );
+      }
+
+      body = f;
+      remaining = chunks;
+      joined = 0;
+      ++generation;
+    }
+    wake.notify_all();
+
+    work( queues.size() - 1 );
+
+    // A worker that wakes late would otherwise still be in this run when
+    // the next one deals its chunks
+    std::unique_lock<std::mutex> guard( lock );
+    done.wait( guard, [&]() { return remaining == 0 && active == 0 && joined == threads.size(); } );
+  }
+};
+
+#endif
@@ -0,0 +1,478 @@
+#ifndef TILEDIMAGE_H
+#define TILEDIMAGE_H
+
+#include <SDL/SDL.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <list>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "pack.h"
+
+// Tiled images, decoded as they come into view.
+// tools/tile cuts an image into square tiles and run length encodes each
+// one on its own (TiledHeader, one TileIndex per tile, then the tiles).
+// TiledImage maps the file and decodes and converts to display format only
+// the tiles draw() needs, so a world map much larger than the screen
+// costs what is on screen, not what is in the file.
+//
+// Decoded tiles stay in an LRU cache. When a new tile would go over the
+// memory budget, the least recently drawn tiles are freed first.
+//
+// Tiles are 24 bit RGB, rows top to bottom, as a stream of packets: a
+// byte c < 128 followed by c + 1 literal pixels, or c >= 128 followed by
+// one pixel repeated c - 126 times. The colorkey is stored as RGB and set
+// once a tile is in display format, as load_image does.
+
+const Uint32 TILED_MAGIC = 0x544C4453; // "SDLT"
+const Uint32 TILED_VERSION = 1;
+
+const int TILED_DEFAULT_TILE = 256;
+
+// Room for about 4 screens of 640x480 at 32 bits per pixel
+const size_t TILED_DEFAULT_BUDGET = 4 * 640 * 480 * 4;
+
+struct TiledHeader {
+  Uint32 magic, version;
+  Uint32 w, h;
+  Uint32 tileSize, cols, rows;
+
+  // SDL_SRCCOLORKEY and the key as 0xRRGGBB, or 0
+  Uint32 flags, colorkey;
+
+  // Where the cols * rows TileIndex start, row by row
+  Uint32 indexOffset;
+};
+
+struct TileIndex {
+  Uint32 offset, size;
+};
+
+// Appends a tile's w x h RGB pixels, pitch bytes apart, packed
+inline void tile_encode( const Uint8* rgb, int w, int h, int pitch, std::vector<Uint8>& out )
+{
+  std::vector<Uint8> pixels;
+  for( int y = 0; y < h; ++y ) {
+    pixels.insert( pixels.end(), rgb + y * pitch, rgb + y * pitch + w * 3 );
+  }
+
+  int count = w * h;
+  int p = 0;
+  while( p < count ) {
+    int run = 1;
+    while( p + run < count && run < 129 && memcmp( &pixels[ p * 3 ], &pixels[ ( p + run ) * 3 ], 3 ) == 0 ) {
+      ++run;
+    }
+
+    if( run >= 2 ) {
+      out.push_back( run + 126 );
+      out.insert( out.end(), &pixels[ p * 3 ], &pixels[ p * 3 ] + 3 );
+      p += run;
+      continue;
+    }
+
+    // Literals up to the next run of 2 or more
+    int literal = 1;
+    while( p + literal < count && literal < 128 &&
+	   !( p + literal + 1 < count && memcmp( &pixels[ ( p + literal ) * 3 ], &pixels[ ( p + literal + 1 ) * 3 ], 3 ) == 0 ) ) {
+      ++literal;
+    }
+    out.push_back( literal - 1 );
+    out.insert( out.end(), &pixels[ p * 3 ], &pixels[ ( p + literal ) * 3 ] );
+    p += literal;
+  }
+}
+
+// Unpacks count pixels into rgb, false if the data runs out or over
+inline bool tile_decode( const Uint8* data, size_t size, Uint8* rgb, int count )
+{
+  const Uint8* end = data + size;
+  int p = 0;
+
+  while( p < count ) {
+    if( data >= end ) {
+      return false;
+    }
+    int c = *data++;
+
+    if( c < 128 ) {
+      int literal = c + 1;
+      if( p + literal > count || end - data < literal * 3 ) {
+	return false;
+      }
+      memcpy( rgb + p * 3, data, literal * 3 );
+      data += literal * 3;
+      p += literal;
+    } else {
+      int run = c - 126;
+      if( p + run > count || end - data < 3 ) {
+	return false;
+      }
+      for( int r = 0; r < run; ++r ) {
+	memcpy( rgb + ( p + r ) * 3, data, 3 );
+      }
+      data += 3;
+      p += run;
+    }
+  }
+
+  return true;
+}
+
+// Writes image as tiles of tileSize, with load_image's colorkey if
+// colorkey; what tools/tile runs on each image
+inline bool save_tiled( SDL_Surface* image, const std::string& path, int tileSize, bool colorkey )
+{
+  // Bytes R, G, B in memory whatever the byte order
+  SDL_Surface* rgb = SDL_CreateRGBSurface( SDL_SWSURFACE, image->w, image->h, 24,
+					   SDL_BYTEORDER == SDL_LIL_ENDIAN ? 0x0000FF : 0xFF0000, 0x00FF00,
+					   SDL_BYTEORDER == SDL_LIL_ENDIAN ? 0xFF0000 : 0x0000FF, 0 );
+  if( rgb == NULL ) {
+    return false;
+  }
+
+  // Copy every pixel, as SDL_DisplayFormat does: no blending with the
+  // image's alpha, and no skipping a colorkey it came with
+  Uint32 alphaFlags = image->flags & SDL_SRCALPHA;
+  Uint8 alpha = image->format->alpha;
+  Uint32 keyFlags = image->flags & SDL_SRCCOLORKEY;
+  Uint32 key = image->format->colorkey;
+  SDL_SetAlpha( image, 0, SDL_ALPHA_OPAQUE );
+  SDL_SetColorKey( image, 0, 0 );
+  SDL_BlitSurface( image, NULL, rgb, NULL );
+  SDL_SetAlpha( image, alphaFlags, alpha );
+  SDL_SetColorKey( image, keyFlags, key );
+
+  TiledHeader header;
+  memset( &header, 0, sizeof( header ) );
+  header.magic = TILED_MAGIC;
+  header.version = TILED_VERSION;
+  header.w = image->w;
+  header.h = image->h;
+  header.tileSize = tileSize;
+  header.cols = ( image->w + tileSize - 1 ) / tileSize;
+  header.rows = ( image->h + tileSize - 1 ) / tileSize;
+  if( colorkey ) {
+    header.flags = SDL_SRCCOLORKEY;
+    header.colorkey = ( 200 << 16 ) | ( 191 << 8 ) | 231;
+  }
+  header.indexOffset = sizeof( header );
+
+  std::vector<TileIndex> index( header.cols * header.rows );
+  std::vector<Uint8> tiles;
+  Uint32 start = header.indexOffset + index.size() * sizeof( TileIndex );
+
+  for( int row = 0; row < header.rows; ++row ) {
+    for( int col = 0; col < header.cols; ++col ) {
+      int x = col * tileSize, y = row * tileSize;
+      int w = image->w - x < tileSize ? image->w - x : tileSize;
+      int h = image->h - y < tileSize ? image->h - y : tileSize;
+      TileIndex& tile = index[ row * header.cols + col ];
+
+      tile.offset = start + tiles.size();
+      tile_encode( (const Uint8*) rgb->pixels + y * rgb->pitch + x * 3, w, h, rgb->pitch, tiles );
+      tile.size = start + tiles.size() - tile.offset;
+    }
+  }
+  SDL_FreeSurface( rgb );
+
+  FILE* out = fopen( path.c_str(), "wb" );
+  if( out == NULL ) {
+    return false;
+  }
+  fwrite( &header, sizeof( header ), 1, out );
+  fwrite( index.data(), sizeof( TileIndex ), index.size(), out );
+  fwrite( tiles.data(), 1, tiles.size(), out );
+
+  bool written = !ferror( out );
+  return fclose( out ) == 0 && written;
+}
+
+class TiledImage {
+private:
+  struct Slot {
+    SDL_Surface* surface;
+    std::list<int>::iterator used;
+  };
+
+  const Uint8* data;
+  size_t size;
+  void* mapped;
+  const TiledHeader* header;
+  const TileIndex* index;
+
+  std::vector<Slot> slots;
+
+  // Decoded tiles, most recently drawn first
+  std::list<int> lru;
+
+  std::vector<Uint8> scratch;
+  size_t budget, liveBytes;
+  int decodes, hits, evictions;
+
+  bool check() const {
+    if( size < sizeof( TiledHeader ) || header->magic != TILED_MAGIC || header->version != TILED_VERSION ||
+	header->tileSize == 0 || header->cols != ( header->w + header->tileSize - 1 ) / header->tileSize ||
+	header->rows != ( header->h + header->tileSize - 1 ) / header->tileSize ) {
+      return false;
+    }
+    if( (size_t) header->indexOffset + (size_t) header->cols * header->rows * sizeof( TileIndex ) > size ) {
+      return false;
+    }
+
+    const TileIndex* tiles = (const TileIndex*) ( data + header->indexOffset );
+    for( Uint32 t = 0; t < header->cols * header->rows; ++t ) {
+      if( (size_t) tiles[ t ].offset + tiles[ t ].size > size ) {
+	return false;
+      }
+    }
+    return true;
+  }
+
+  static size_t tile_bytes( SDL_Surface* surface ) {
+    return (size_t) surface->pitch * surface->h;
+  }
+
+  void evict( int t ) {
+    liveBytes -= tile_bytes( slots[ t ].surface );
+    SDL_FreeSurface( slots[ t ].surface );
+    slots[ t ].surface = NULL;
+    lru.erase( slots[ t ].used );
+    ++evictions;
+  }
+
+  // Decodes tile t and converts it to display format
+  SDL_Surface* decode( int t ) {
+    int col = t % header->cols, row = t / header->cols;
+    int w = header->w - col * header->tileSize < header->tileSize ? header->w - col * header->tileSize : header->tileSize;
+    int h = header->h - row * header->tileSize < header->tileSize ? header->h - row * header->tileSize : header->tileSize;
+
+    scratch.resize( w * h * 3 );
+    if( !tile_decode( data + index[ t ].offset, index[ t ].size, scratch.data(), w * h ) ) {
+      return NULL;
+    }
+
+    SDL_Surface* rgb = SDL_CreateRGBSurfaceFrom( scratch.data(), w, h, 24, w * 3,
+						 SDL_BYTEORDER == SDL_LIL_ENDIAN ? 0x0000FF : 0xFF0000, 0x00FF00,
+						 SDL_BYTEORDER == SDL_LIL_ENDIAN ? 0xFF0000 : 0x0000FF, 0 );
+    if( rgb == NULL ) {
+      return NULL;
+    }
+    SDL_Surface* tile = SDL_DisplayFormat( rgb );
+    SDL_FreeSurface( rgb );
+
+    if( tile != NULL && ( header->flags & SDL_SRCCOLORKEY ) ) {
+      Uint32 key = header->colorkey;
+      SDL_SetColorKey( tile, SDL_SRCCOLORKEY, SDL_MapRGB( tile->format, key >> 16, ( key >> 8 ) & 0xFF, key & 0xFF ) );
+    }
+
+    return tile;
+  }
+
+public:
+  // budget: bytes of decoded tiles to keep, 0 keeps none past their draw
+  TiledImage( size_t theBudget = TILED_DEFAULT_BUDGET ) {
+    data = NULL;
+    size = 0;
+    mapped = NULL;
+    header = NULL;
+    index = NULL;
+    budget = theBudget;
+    liveBytes = 0;
+    decodes = hits = evictions = 0;
+  }
+
+  ~TiledImage() {
+    close();
+  }
+
+  // Maps the tiles from the asset pack or else the file at path, false if
+  // there are none. Nothing is decoded yet.
+  bool open( const std::string& path ) {
+    close();
+
+    size_t packed = 0;
+    data = (const Uint8*) asset_pack().find( path, packed );
+    size = packed;
+
+    if( data == NULL ) {
+      int file = ::open( path.c_str(), O_RDONLY );
+      if( file < 0 ) {
+	return false;
+      }
+
+      struct stat info;
+      if( fstat( file, &info ) < 0 || info.st_size == 0 ) {
+	::close( file );
+	return false;
+      }
+
+      mapped = mmap( NULL, info.st_size, PROT_READ, MAP_PRIVATE, file, 0 );
+      ::close( file );
+      if( mapped == MAP_FAILED ) {
+	mapped = NULL;
+	return false;
+      }
+      data = (const Uint8*) mapped;
+      size = info.st_size;
+    }
+
+    header = (const TiledHeader*) data;
+    if( !check() ) {
+      close();
+      return false;
+    }
+    index = (const TileIndex*) ( data + header->indexOffset );
+
+    Slot empty;
+    empty.surface = NULL;
+    slots.assign( header->cols * header->rows, empty );
+
+    return true;
+  }
+
+  // Frees every decoded tile and unmaps the file
+  void close() {
+    for( std::list<int>::iterator t = lru.begin(); t != lru.end(); ++t ) {
+      SDL_FreeSurface( slots[ *t ].surface );
+    }
+    lru.clear();
+    slots.clear();
+    liveBytes = 0;
+
+    if( mapped != NULL ) {
+      munmap( mapped, size );
+    }
+    data = NULL;
+    size = 0;
+    mapped = NULL;
+    header = NULL;
+    index = NULL;
+  }
+
+  bool is_open() const {
+    return header != NULL;
+  }
+
+  int get_width() const {
+    return header ? header->w : 0;
+  }
+
+  int get_height() const {
+    return header ? header->h : 0;
+  }
+
+  int get_tile_size() const {
+    return header ? header->tileSize : 0;
+  }
+
+  // Tile col, row in display format, decoded now if it is not cached;
+  // good until the next call. NULL if it is out of the image or corrupt.
+  SDL_Surface* get_tile( int col, int row ) {
+    if( header == NULL || col < 0 || row < 0 || col >= header->cols || row >= header->rows ) {
+      return NULL;
+    }
+
+    int t = row * header->cols + col;
+    if( slots[ t ].surface != NULL ) {
+      lru.splice( lru.begin(), lru, slots[ t ].used );
+      ++hits;
+      return slots[ t ].surface;
+    }
+
+    SDL_Surface* tile = decode( t );
+    if( tile == NULL ) {
+      return NULL;
+    }
+    ++decodes;
+
+    // Over budget the oldest go, the new tile stays even if it alone is
+    while( !lru.empty() && liveBytes + tile_bytes( tile ) > budget ) {
+      evict( lru.back() );
+    }
+
+    lru.push_front( t );
+    slots[ t ].surface = tile;
+    slots[ t ].used = lru.begin();
+    liveBytes += tile_bytes( tile );
+
+    return tile;
+  }
+
+  // Draws the part of the image inside view (image coordinates) at x, y
+  // on dst, decoding only the tiles it touches
+  void draw( const SDL_Rect& view, SDL_Surface* dst, int x, int y ) {
+    if( header == NULL ) {
+      return;
+    }
+
+    int tileSize = header->tileSize;
+    int left = view.x > 0 ? view.x : 0;
+    int top = view.y > 0 ? view.y : 0;
+    int right = view.x + view.w < (int) header->w ? view.x + view.w : header->w;
+    int bottom = view.y + view.h < (int) header->h ? view.y + view.h : header->h;
+
+    for( int row = top / tileSize; row * tileSize < bottom; ++row ) {
+      for( int col = left / tileSize; col * tileSize < right; ++col ) {
+	SDL_Surface* tile = get_tile( col, row );
+	if( tile == NULL ) {
+	  continue;
+	}
+
+	// The part of the tile in view, placed where it falls on dst
+	int tileX = col * tileSize, tileY = row * tileSize;
+	int fromX = left > tileX ? left - tileX : 0;
+	int fromY = top > tileY ? top - tileY : 0;
+	int toX = right - tileX < tile->w ? right - tileX : tile->w;
+	int toY = bottom - tileY < tile->h ? bottom - tileY : tile->h;
+
+	SDL_Rect from, to;
+	from.x = fromX;
+	from.y = fromY;
+	from.w = toX - fromX;
+	from.h = toY - fromY;
+	to.x = x + tileX + fromX - view.x;
+	to.y = y + tileY + fromY - view.y;
+	SDL_BlitSurface( tile, &from, dst, &to );
+      }
+    }
+  }
+
+  void set_budget( size_t theBudget ) {
+    budget = theBudget;
+    while( !lru.empty() && liveBytes > budget ) {
+      evict( lru.back() );
+    }
+  }
+
+  size_t get_budget() const {
+    return budget;
+  }
+
+  size_t get_live_bytes() const {
+    return liveBytes;
+  }
+
+  int get_live_tiles() const {
+    return lru.size();
+  }
+
+  // Tiles decoded, found in the cache, and freed to stay in budget
+  int get_decodes() const {
+    return decodes;
+  }
+
+  int get_hits() const {
+    return hits;
+  }
+
+  int get_evictions() const {
+    return evictions;
+  }
+};
+
+#endif
@@ -0,0 +1,262 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <limits.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+
+// Packs sprite sheets into one texture atlas and prints a header with
+// the clip of every sprite in it.
+// Each sheet is cut into a grid of cols x rows cells, read left to right
+// and top to bottom; every cell is trimmed to its opaque pixels and the
+// trimmed sprites are packed in shelves, tallest first, at the width
+// that gives the smallest atlas. The atlas is saved as a BMP filled with
+// the colorkey where nothing was packed.
+//
+// usage: atlas <NAME> <atlas.bmp> <sheet>:<cols>x<rows>...
+// writes NAME_ATLAS, NAME_SPRITE_COUNT and NAME_SPRITES[] to stdout, in
+// the order of the sheets and cells given
+
+#define FAIL_IMG(msg)						\
+  fprintf(stderr, msg "IMG Error: %s\n", IMG_GetError());	\
+  exit(-1)
+
+// Same colorkey load_image sets in the examples
+const Uint8 KEY_R = 200, KEY_G = 191, KEY_B = 231;
+
+struct Sprite {
+  SDL_Surface* sheet;
+  std::string file;
+  SDL_Rect cell;
+  SDL_Rect trimmed;
+  int atlasX, atlasY;
+};
+
+Uint32 get_pixel( SDL_Surface* image, int x, int y )
+{
+  return ( (Uint32*) ( (Uint8*) image->pixels + y * image->pitch ) )[ x ];
+}
+
+bool is_opaque( SDL_Surface* image, int x, int y )
+{
+  Uint8 r, g, b, a;
+
+  SDL_GetRGBA( get_pixel( image, x, y ), image->format, &r, &g, &b, &a );
+
+  if( a == 0 ) {
+    return false;
+  }
+
+  return !( r == KEY_R && g == KEY_G && b == KEY_B );
+}
+
+// Bounds of the opaque pixels of cell, empty if there are none
+SDL_Rect trim( SDL_Surface* image, const SDL_Rect& cell )
+{
+  int x0 = cell.x + cell.w, y0 = cell.y + cell.h, x1 = cell.x, y1 = cell.y;
+
+  for( int y = cell.y; y < cell.y + cell.h; ++y ) {
+    for( int x = cell.x; x < cell.x + cell.w; ++x ) {
+      if( is_opaque( image, x, y ) ) {
+	if( x < x0 ) x0 = x;
+	if( y < y0 ) y0 = y;
+	if( x + 1 > x1 ) x1 = x + 1;
+	if( y + 1 > y1 ) y1 = y + 1;
+      }
+    }
+  }
+
+  SDL_Rect r;
+  r.x = x1 > x0 ? x0 : cell.x;
+  r.y = y1 > y0 ? y0 : cell.y;
+  r.w = x1 > x0 ? x1 - x0 : 0;
+  r.h = y1 > y0 ? y1 - y0 : 0;
+
+  return r;
+}
+
+bool taller( const Sprite* a, const Sprite* b )
+{
+  return a->trimmed.h > b->trimmed.h;
+}
+
+// Shelf packing into width columns, returns the height used
+int pack( std::vector<Sprite>& sprites, int width )
+{
+  std::vector<Sprite*> order;
+  for( int s = 0; s < sprites.size(); ++s ) {
+    order.push_back( &sprites[ s ] );
+  }
+  std::stable_sort( order.begin(), order.end(), taller );
+
+  int x = 0, y = 0, shelf = 0;
+
+  for( int s = 0; s < order.size(); ++s ) {
+    Sprite* sprite = order[ s ];
+
+    if( x + sprite->trimmed.w > width ) {
+      x = 0;
+      y += shelf;
+      shelf = 0;
+    }
+
+    sprite->atlasX = x;
+    sprite->atlasY = y;
+    x += sprite->trimmed.w;
+    if( sprite->trimmed.h > shelf ) {
+      shelf = sprite->trimmed.h;
+    }
+  }
+
+  return y + shelf;
+}
+
+int main( int argc, char** argv )
+{
+  if( argc < 4 ) {
+    fprintf( stderr, "usage: %s <NAME> <atlas.bmp> <sheet>:<cols>x<rows>...\n", argv[ 0 ] );
+    return 1;
+  }
+
+  std::string name = argv[ 1 ];
+  std::string output = argv[ 2 ];
+  std::vector<Sprite> sprites;
+  std::vector<SDL_Surface*> sheets;
+
+  // Work on a known 32 bit layout whatever the files had
+  SDL_Surface* layout = SDL_CreateRGBSurface( SDL_SWSURFACE, 1, 1, 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 );
+
+  for( int a = 3; a < argc; ++a ) {
+    std::string arg = argv[ a ];
+    size_t colon = arg.rfind( ':' );
+    int cols = 0, rows = 0;
+
+    if( colon == std::string::npos || sscanf( arg.c_str() + colon + 1, "%dx%d", &cols, &rows ) != 2 || cols <= 0 || rows <= 0 ) {
+      fprintf( stderr, "bad sheet '%s', expected <sheet>:<cols>x<rows>\n", argv[ a ] );
+      return 1;
+    }
+
+    std::string file = arg.substr( 0, colon );
+    SDL_Surface* loaded = IMG_Load( file.c_str() );
+    if( loaded == NULL ) {
+      FAIL_IMG("Error loading image.\n");
+    }
+
+    SDL_Surface* sheet = SDL_ConvertSurface( loaded, layout->format, SDL_SWSURFACE );
+    if( sheet == NULL ) {
+      FAIL_IMG("Error converting image.\n");
+    }
+    SDL_FreeSurface( loaded );
+    sheets.push_back( sheet );
+
+    for( int r = 0; r < rows; ++r ) {
+      for( int c = 0; c < cols; ++c ) {
+	Sprite sprite;
+
+	sprite.sheet = sheet;
+	sprite.file = file;
+	sprite.cell.x = c * sheet->w / cols;
+	sprite.cell.y = r * sheet->h / rows;
+	sprite.cell.w = ( c + 1 ) * sheet->w / cols - sprite.cell.x;
+	sprite.cell.h = ( r + 1 ) * sheet->h / rows - sprite.cell.y;
+	sprite.trimmed = trim( sheet, sprite.cell );
+
+	sprites.push_back( sprite );
+      }
+    }
+  }
+  SDL_FreeSurface( layout );
+
+  // Try every width from the widest sprite up to twice the square root
+  // of the total area and keep the one giving the smallest atlas, the
+  // squarest one of those
+  int area = 0, widest = 1;
+  for( int s = 0; s < sprites.size(); ++s ) {
+    area += sprites[ s ].trimmed.w * sprites[ s ].trimmed.h;
+    widest = std::max( widest, (int) sprites[ s ].trimmed.w );
+  }
+  int best = widest, bestArea = INT_MAX, bestSide = INT_MAX;
+  for( int w = widest; w == widest || w * w <= 4 * area; ++w ) {
+    int h = pack( sprites, w ), used = 1;
+
+    for( int s = 0; s < sprites.size(); ++s ) {
+      used = std::max( used, sprites[ s ].atlasX + sprites[ s ].trimmed.w );
+    }
+    if( used * h < bestArea || ( used * h == bestArea && std::max( used, h ) < bestSide ) ) {
+      best = w;
+      bestArea = used * h;
+      bestSide = std::max( used, h );
+    }
+  }
+
+  int height = std::max( pack( sprites, best ), 1 );
+  int width = 1;
+  for( int s = 0; s < sprites.size(); ++s ) {
+    width = std::max( width, sprites[ s ].atlasX + sprites[ s ].trimmed.w );
+  }
+
+  SDL_Surface* atlas = SDL_CreateRGBSurface( SDL_SWSURFACE, width, height, 32, 0x00FF0000, 0x0000FF00, 0x000000FF, 0 );
+  Uint32 colorkey = SDL_MapRGB( atlas->format, KEY_R, KEY_G, KEY_B );
+  SDL_FillRect( atlas, NULL, colorkey );
+
+  // Copy by hand, so see through pixels become the colorkey
+  for( int s = 0; s < sprites.size(); ++s ) {
+    Sprite& sprite = sprites[ s ];
+
+    for( int y = 0; y < sprite.trimmed.h; ++y ) {
+      Uint32* row = (Uint32*) ( (Uint8*) atlas->pixels + ( sprite.atlasY + y ) * atlas->pitch );
+
+      for( int x = 0; x < sprite.trimmed.w; ++x ) {
+	int sx = sprite.trimmed.x + x, sy = sprite.trimmed.y + y;
+	Uint8 r, g, b, a;
+
+	if( is_opaque( sprite.sheet, sx, sy ) ) {
+	  SDL_GetRGBA( get_pixel( sprite.sheet, sx, sy ), sprite.sheet->format, &r, &g, &b, &a );
+	  row[ sprite.atlasX + x ] = SDL_MapRGB( atlas->format, r, g, b );
+	}
+      }
+    }
+  }
+
+  if( SDL_SaveBMP( atlas, output.c_str() ) != 0 ) {
+    fprintf( stderr, "Error saving %s: %s\n", output.c_str(), SDL_GetError() );
+    return 1;
+  }
+
+  // The examples load the atlas from their own directory
+  std::string image = output.substr( output.rfind( '/' ) + 1 );
+  std::string files;
+  for( int a = 3; a < argc; ++a ) {
+    std::string arg = argv[ a ];
+    files += ( a > 3 ? ", " : "" ) + arg.substr( 0, arg.rfind( ':' ) );
+  }
+
+  printf( "// Generated by tools/atlas from %s, do not edit.\n", files.c_str() );
+  printf( "#ifndef %s_ATLAS_H\n", name.c_str() );
+  printf( "#define %s_ATLAS_H\n\n", name.c_str() );
+  printf( "#include \"../common/atlas.h\"\n\n" );
+  printf( "constexpr const char* %s_ATLAS = \"%s\";\n\n", name.c_str(), image.c_str() );
+  printf( "constexpr int %s_SPRITE_COUNT = %d;\n\n", name.c_str(), (int) sprites.size() );
+  printf( "// x, y, w, h in the atlas; offset and size of the original cell\n" );
+  printf( "constexpr AtlasSprite %s_SPRITES[ %s_SPRITE_COUNT ] = {\n", name.c_str(), name.c_str() );
+
+  for( int s = 0; s < sprites.size(); ++s ) {
+    const Sprite& sprite = sprites[ s ];
+
+    printf( "  { %4d, %4d, %4d, %4d, %4d, %4d, %4d, %4d },\n",
+	    sprite.atlasX, sprite.atlasY, sprite.trimmed.w, sprite.trimmed.h,
+	    sprite.trimmed.x - sprite.cell.x, sprite.trimmed.y - sprite.cell.y, sprite.cell.w, sprite.cell.h );
+  }
+
+  printf( "};\n\n" );
+  printf( "#endif\n" );
+
+  SDL_FreeSurface( atlas );
+  for( int s = 0; s < sheets.size(); ++s ) {
+    SDL_FreeSurface( sheets[ s ] );
+  }
+
+  return 0;
+}
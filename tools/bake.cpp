@@ -0,0 +1,60 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "../common/blob.h"
+
+// Bakes an image into a blob for load_blob: converted to the display
+// format exactly as load_image does it (SDL_DisplayFormat, then the
+// colorkey), saved as a BlobHeader and the pixel rows.
+// The display is SDL's dummy driver at 32 bits per pixel, whose format is
+// the usual one of 32 bit X11 and Windows desktops; load_blob refuses the
+// blob anywhere else.
+//
+// usage: bake <image> <out.blob>
+
+#define FAIL_IMG(msg)						\
+  fprintf(stderr, msg "IMG Error: %s\n", IMG_GetError());	\
+  exit(-1)
+
+// Same colorkey load_image sets in the examples
+const Uint8 KEY_R = 200, KEY_G = 191, KEY_B = 231;
+
+const int BAKE_BPP = 32;
+
+int main( int argc, char** argv )
+{
+  if( argc != 3 ) {
+    fprintf( stderr, "usage: %s <image> <out.blob>\n", argv[ 0 ] );
+    return 1;
+  }
+
+  setenv( "SDL_VIDEODRIVER", "dummy", 1 );
+  if( SDL_Init( SDL_INIT_VIDEO ) < 0 || SDL_SetVideoMode( 1, 1, BAKE_BPP, SDL_SWSURFACE ) == NULL ) {
+    fprintf( stderr, "Error setting video mode: %s\n", SDL_GetError() );
+    return 1;
+  }
+
+  SDL_Surface* loaded = IMG_Load( argv[ 1 ] );
+  if( loaded == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
+
+  SDL_Surface* image = SDL_DisplayFormat( loaded );
+  if( image == NULL ) {
+    FAIL_IMG("Error optimizing image\n");
+  }
+  SDL_FreeSurface( loaded );
+
+  SDL_SetColorKey( image, SDL_SRCCOLORKEY, SDL_MapRGB( image->format, KEY_R, KEY_G, KEY_B ) );
+
+  if( !save_blob( image, argv[ 2 ] ) ) {
+    fprintf( stderr, "Error writing %s\n", argv[ 2 ] );
+    return 1;
+  }
+
+  SDL_FreeSurface( image );
+  SDL_Quit();
+
+  return 0;
+}
@@ -0,0 +1,148 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string>
+#include <vector>
+
+// Scans a sprite and prints a header with its collision boxes.
+// Every row is split into runs of opaque pixels, and identical adjacent
+// rows are merged into one taller box per run.
+//
+// usage: boxgen <image> <NAME>
+// writes NAME_BOX_COUNT and NAME_BOXES[] to stdout
+
+#define FAIL_IMG(msg)						\
+  fprintf(stderr, msg "IMG Error: %s\n", IMG_GetError());	\
+  exit(-1)
+
+struct Run {
+  int x, w;
+};
+
+// Same colorkey load_image sets in the examples
+const Uint8 KEY_R = 200, KEY_G = 191, KEY_B = 231;
+
+bool is_opaque( SDL_Surface* image, int x, int y )
+{
+  Uint32 pixel = ( (Uint32*) ( (Uint8*) image->pixels + y * image->pitch ) )[ x ];
+  Uint8 r, g, b, a;
+
+  SDL_GetRGBA( pixel, image->format, &r, &g, &b, &a );
+
+  if( a == 0 ) {
+    return false;
+  }
+
+  return !( r == KEY_R && g == KEY_G && b == KEY_B );
+}
+
+std::vector<Run> row_runs( SDL_Surface* image, int y )
+{
+  std::vector<Run> runs;
+
+  for( int x = 0; x < image->w; ) {
+    if( !is_opaque( image, x, y ) ) {
+      ++x;
+      continue;
+    }
+
+    Run run;
+    run.x = x;
+    while( x < image->w && is_opaque( image, x, y ) ) {
+      ++x;
+    }
+    run.w = x - run.x;
+
+    runs.push_back( run );
+  }
+
+  return runs;
+}
+
+bool same_runs( std::vector<Run>& a, std::vector<Run>& b )
+{
+  if( a.size() != b.size() ) {
+    return false;
+  }
+
+  for( int i = 0; i < a.size(); ++i ) {
+    if( a[ i ].x != b[ i ].x || a[ i ].w != b[ i ].w ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main( int argc, char** argv )
+{
+  if( argc != 3 ) {
+    fprintf( stderr, "usage: %s <image> <NAME>\n", argv[ 0 ] );
+    return 1;
+  }
+
+  std::string name = argv[ 2 ];
+
+  SDL_Surface* loaded = IMG_Load( argv[ 1 ] );
+  if( loaded == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
+
+  // Work on a known 32 bit layout whatever the file had
+  SDL_Surface* layout = SDL_CreateRGBSurface( SDL_SWSURFACE, 1, 1, 32, 0x000000FF, 0x0000FF00, 0x00FF0000, 0xFF000000 );
+  SDL_Surface* image = SDL_ConvertSurface( loaded, layout->format, SDL_SWSURFACE );
+  if( image == NULL ) {
+    FAIL_IMG("Error converting image.\n");
+  }
+  SDL_FreeSurface( layout );
+  SDL_FreeSurface( loaded );
+
+  std::vector<SDL_Rect> boxes;
+  std::vector<Run> previous;
+  int first = 0;
+
+  for( int y = 0; y <= image->h; ++y ) {
+    std::vector<Run> runs;
+
+    if( y < image->h ) {
+      runs = row_runs( image, y );
+
+      if( y > 0 && same_runs( runs, previous ) ) {
+	continue;
+      }
+    }
+
+    // Close the band of identical rows that ended at y
+    for( int r = 0; r < previous.size(); ++r ) {
+      SDL_Rect box;
+      box.x = previous[ r ].x;
+      box.y = first;
+      box.w = previous[ r ].w;
+      box.h = y - first;
+
+      boxes.push_back( box );
+    }
+
+    previous = runs;
+    first = y;
+  }
+
+  printf( "// Generated by tools/boxgen from %s, do not edit.\n", argv[ 1 ] );
+  printf( "#ifndef %s_BOXES_H\n", name.c_str() );
+  printf( "#define %s_BOXES_H\n\n", name.c_str() );
+  printf( "#include \"../common/boxtable.h\"\n\n" );
+  printf( "constexpr int %s_BOX_COUNT = %d;\n\n", name.c_str(), (int) boxes.size() );
+  printf( "constexpr BoxTableEntry %s_BOXES[ %s_BOX_COUNT ] = {\n", name.c_str(), name.c_str() );
+
+  for( int b = 0; b < boxes.size(); ++b ) {
+    printf( "  { %3d, %3d, %3d, %3d },\n", boxes[ b ].x, boxes[ b ].y, boxes[ b ].w, boxes[ b ].h );
+  }
+
+  printf( "};\n\n" );
+  printf( "#endif\n" );
+
+  SDL_FreeSurface( image );
+
+  return 0;
+}
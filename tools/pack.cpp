@@ -0,0 +1,206 @@
+#include <SDL/SDL.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include "../common/pack.h"
+
+// Packs files into an asset pack for AssetPack, each under its file name
+// without the directory, and builds the pack's minimal perfect hash.
+// Two paths with the same file name are an error, one would hide the
+// other.
+// Keys go into buckets of about PACK_BUCKET_SIZE by their hash with seed
+// 0; then, biggest bucket first, every bucket gets the first seed that
+// sends all of its keys to entries no other key has taken.
+//
+// usage: pack <out.pack> <file>...
+
+const int PACK_BUCKET_SIZE = 4;
+
+// Way more than needed, a bucket of 4 finds a seed in a few hundred tries
+const Uint32 PACK_MAX_SEED = 1 << 24;
+
+struct Asset {
+  std::string path;
+  std::string name;
+  std::vector<Uint8> bytes;
+};
+
+bool read_file( const char* path, std::vector<Uint8>& bytes )
+{
+  FILE* in = fopen( path, "rb" );
+  if( in == NULL ) {
+    return false;
+  }
+
+  Uint8 buffer[ 65536 ];
+  size_t got;
+  while( ( got = fread( buffer, 1, sizeof( buffer ), in ) ) > 0 ) {
+    bytes.insert( bytes.end(), buffer, buffer + got );
+  }
+
+  bool ok = !ferror( in );
+  fclose( in );
+  return ok;
+}
+
+Uint32 align( Uint32 offset, Uint32 alignment )
+{
+  return ( offset + alignment - 1 ) / alignment * alignment;
+}
+
+// Seeds for every bucket and the entry of every asset; false if some
+// bucket found no seed, which only duplicate names should cause
+bool build_hash( const std::vector<Asset>& assets, std::vector<Uint32>& seeds, std::vector<int>& slots )
+{
+  Uint32 count = assets.size();
+  Uint32 buckets = ( count + PACK_BUCKET_SIZE - 1 ) / PACK_BUCKET_SIZE;
+  std::vector< std::vector<int> > members( buckets );
+
+  for( int a = 0; a < assets.size(); ++a ) {
+    const std::string& name = assets[ a ].name;
+    members[ pack_hash( name.data(), name.size(), 0 ) % buckets ].push_back( a );
+  }
+
+  std::vector<int> order( buckets );
+  for( int b = 0; b < buckets; ++b ) {
+    order[ b ] = b;
+  }
+  std::stable_sort( order.begin(), order.end(), [&]( int l, int r ) { return members[ l ].size() > members[ r ].size(); } );
+
+  seeds.assign( buckets, 0 );
+  slots.assign( count, -1 );
+  std::vector<bool> taken( count, false );
+
+  for( int o = 0; o < buckets; ++o ) {
+    const std::vector<int>& bucket = members[ order[ o ] ];
+    if( bucket.empty() ) {
+      break;
+    }
+
+    bool placed = false;
+    for( Uint32 seed = 1; seed < PACK_MAX_SEED && !placed; ++seed ) {
+      std::vector<Uint32> tried;
+
+      placed = true;
+      for( int m = 0; m < bucket.size() && placed; ++m ) {
+	const std::string& name = assets[ bucket[ m ] ].name;
+	Uint32 slot = pack_hash( name.data(), name.size(), seed ) % count;
+
+	if( taken[ slot ] || std::find( tried.begin(), tried.end(), slot ) != tried.end() ) {
+	  placed = false;
+	}
+	tried.push_back( slot );
+      }
+
+      if( placed ) {
+	seeds[ order[ o ] ] = seed;
+	for( int m = 0; m < bucket.size(); ++m ) {
+	  taken[ tried[ m ] ] = true;
+	  slots[ bucket[ m ] ] = tried[ m ];
+	}
+      }
+    }
+
+    if( !placed ) {
+      return false;
+    }
+  }
+
+  return true;
+}
+
+int main( int argc, char** argv )
+{
+  if( argc < 2 ) {
+    fprintf( stderr, "usage: %s <out.pack> <file>...\n", argv[ 0 ] );
+    return 1;
+  }
+
+  std::vector<Asset> assets;
+  for( int a = 2; a < argc; ++a ) {
+    Asset asset;
+    const char* slash = strrchr( argv[ a ], '/' );
+
+    asset.path = argv[ a ];
+    asset.name = slash ? slash + 1 : argv[ a ];
+    for( int other = 0; other < assets.size(); ++other ) {
+      if( assets[ other ].name == asset.name ) {
+	fprintf( stderr, "%s and %s would both be %s in the pack\n", assets[ other ].path.c_str(),
+		 asset.path.c_str(), asset.name.c_str() );
+	return 1;
+      }
+    }
+    if( !read_file( argv[ a ], asset.bytes ) ) {
+      fprintf( stderr, "Error reading %s\n", argv[ a ] );
+      return 1;
+    }
+    assets.push_back( asset );
+  }
+
+  std::vector<Uint32> seeds;
+  std::vector<int> slots;
+  if( !assets.empty() && !build_hash( assets, seeds, slots ) ) {
+    fprintf( stderr, "Error building the perfect hash\n" );
+    return 1;
+  }
+
+  PackHeader header;
+  memset( &header, 0, sizeof( header ) );
+  header.magic = PACK_MAGIC;
+  header.version = PACK_VERSION;
+  header.count = assets.size();
+  header.buckets = seeds.size();
+  header.seedsOffset = sizeof( header );
+  header.entriesOffset = align( header.seedsOffset + seeds.size() * sizeof( Uint32 ), sizeof( PackEntry ) );
+  header.namesOffset = header.entriesOffset + assets.size() * sizeof( PackEntry );
+
+  std::vector<PackEntry> entries( assets.size() );
+  Uint32 offset = header.namesOffset;
+  for( int a = 0; a < assets.size(); ++a ) {
+    PackEntry& entry = entries[ slots[ a ] ];
+    entry.nameOffset = offset;
+    entry.nameLength = assets[ a ].name.size();
+    offset += entry.nameLength;
+  }
+  for( int a = 0; a < assets.size(); ++a ) {
+    PackEntry& entry = entries[ slots[ a ] ];
+    offset = align( offset, PACK_ALIGN );
+    entry.offset = offset;
+    entry.size = assets[ a ].bytes.size();
+    offset += entry.size;
+  }
+  header.size = offset;
+
+  std::vector<Uint8> pack( header.size, 0 );
+  memcpy( pack.data(), &header, sizeof( header ) );
+  if( !seeds.empty() ) {
+    memcpy( pack.data() + header.seedsOffset, seeds.data(), seeds.size() * sizeof( Uint32 ) );
+    memcpy( pack.data() + header.entriesOffset, entries.data(), entries.size() * sizeof( PackEntry ) );
+  }
+  for( int a = 0; a < assets.size(); ++a ) {
+    const PackEntry& entry = entries[ slots[ a ] ];
+    memcpy( pack.data() + entry.nameOffset, assets[ a ].name.data(), entry.nameLength );
+    if( entry.size > 0 ) {
+      memcpy( pack.data() + entry.offset, assets[ a ].bytes.data(), entry.size );
+    }
+  }
+
+  // Buffered data may only fail to reach the disk at fclose; a pack that
+  // was cut short is removed so make does not take it as up to date
+  FILE* out = fopen( argv[ 1 ], "wb" );
+  if( out == NULL ) {
+    fprintf( stderr, "Error writing %s\n", argv[ 1 ] );
+    return 1;
+  }
+  bool written = fwrite( pack.data(), 1, pack.size(), out ) == pack.size();
+  if( fclose( out ) != 0 || !written ) {
+    fprintf( stderr, "Error writing %s\n", argv[ 1 ] );
+    remove( argv[ 1 ] );
+    return 1;
+  }
+
+  return 0;
+}
@@ -0,0 +1,45 @@
+#include <SDL/SDL.h>
+#include <SDL/SDL_image.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "../common/tiledimage.h"
+
+// Cuts an image into tiles for TiledImage: tileSize square tiles (the
+// last column and row may be smaller), each run length encoded on its
+// own, with load_image's colorkey. Nothing here depends on the display,
+// the tiles are converted when they are drawn.
+//
+// usage: tile <image> <out.tiles> [tileSize]
+
+#define FAIL_IMG(msg)						\
+  fprintf(stderr, msg "IMG Error: %s\n", IMG_GetError());	\
+  exit(-1)
+
+int main( int argc, char** argv )
+{
+  if( argc != 3 && argc != 4 ) {
+    fprintf( stderr, "usage: %s <image> <out.tiles> [tileSize]\n", argv[ 0 ] );
+    return 1;
+  }
+
+  int tileSize = argc == 4 ? atoi( argv[ 3 ] ) : TILED_DEFAULT_TILE;
+  if( tileSize <= 0 ) {
+    fprintf( stderr, "Bad tile size %s\n", argv[ 3 ] );
+    return 1;
+  }
+
+  SDL_Surface* image = IMG_Load( argv[ 1 ] );
+  if( image == NULL ) {
+    FAIL_IMG("Error loading image.\n");
+  }
+
+  if( !save_tiled( image, argv[ 2 ], tileSize, true ) ) {
+    fprintf( stderr, "Error writing %s\n", argv[ 2 ] );
+    return 1;
+  }
+
+  SDL_FreeSurface( image );
+  SDL_Quit();
+
+  return 0;
+}